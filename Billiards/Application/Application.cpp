@@ -4,8 +4,11 @@
 #include <GLFW/glfw3.h>
 
 #include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
 
 #include "Window.h" // Needs full Window definition
+#include "Primitives.h"
+#include "ModelLoader.h"
 
 #include <imgui.h>
 #include <backends/imgui_impl_glfw.h>
@@ -14,7 +17,21 @@
 #include <iostream>
 #include <stdexcept>
 #include <chrono> // For delta time
+#include <string>
+#include <algorithm>
+#include <thread>
 
+namespace
+{
+	// overhead light centred on the table, its shadow frustum covers the bed and the rails
+	const glm::vec3 c_TABLE_LIGHT_POSITION(0.0f, 0.0f, 1.5f);
+	constexpr float c_TABLE_LIGHT_FOV = 100.0f; // degrees
+	constexpr float c_TABLE_LIGHT_NEAR = 0.1f;
+	constexpr float c_TABLE_LIGHT_FAR = 5.0f;
+
+	// a game the planner can not finish in this many shots is stopped
+	constexpr int c_MAX_PLANNED_SHOTS = 100;
+}
 
 // static callback for dynamic window scale
 void Application::WindowContentScaleCallback(GLFWwindow* window, float xscale, float yscale)
@@ -32,11 +49,16 @@ void Application::WindowContentScaleCallback(GLFWwindow* window, float xscale, f
 }
 
 Application::Application(int windowWidth, int windowHeight, const char* windowTitle)
-	: m_dpiScale(1.0f), m_showDemoWindow(false), m_isRunning(false)
+	: Application(ApplicationConfig{ windowWidth, windowHeight, windowTitle })
+{
+}
+
+Application::Application(const ApplicationConfig& config)
+	: m_config(config), m_dpiScale(1.0f), m_showDemoWindow(false), m_isRunning(false)
 {
 	try
 	{
-		InitializeSubsystems(windowWidth, windowHeight, windowTitle);
+		InitializeSubsystems(config.windowWidth, config.windowHeight, config.windowTitle);
 		m_isRunning = true;
 	}
 	catch (const std::exception& e) {
@@ -60,85 +82,205 @@ void Application::InitializeSubsystems(int windowWidth, int windowHeight, const
 	{
 		std::cout << "Initializing Application subsystems..." << std::endl;
 
-		// 1. Initialize GLFW
-		glfwSetErrorCallback(Window::GlfwErrorCallback);
-		if (!glfwInit()) {
-			throw std::runtime_error("Failed to initialize GLFW");
-		}
-		std::cout << "GLFW initialized successfully." << std::endl;
+		// headless runs never touch GLFW, GL or ImGui, so startup is just the physics world
+		if (m_config.mode != RunMode::Headless)
+			InitializeGraphics(windowWidth, windowHeight, windowTitle);
 
-		// 2. Get DPI so window and ImGui scale is correct across different resolutions
-		GLFWmonitor* primaryMonitor = glfwGetPrimaryMonitor();
-		if (primaryMonitor)
-		{
-			float xscale, yscale;
-			glfwGetMonitorContentScale(primaryMonitor, &xscale, &yscale);
-			m_dpiScale = (xscale + yscale) / 2.0f; // take average
-			std::cout << "DPI Scale: " << m_dpiScale << std::endl;
-		}
-		else
-		{
-			std::cerr << "Warning: Failed to get primary monitor for DPI scale." << std::endl;
-		}
+		// 5. Initialize physics
+		InitializePhysics();
+
+		// timer queries need the context, headless runs only time the CPU
+		m_profiler = std::make_unique<Profiler>(m_config.mode != RunMode::Headless);
+
+		std::cout << "Subsystems initialized." << std::endl;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Window Initialization Error: " << e.what() << std::endl;
+		if (m_config.mode != RunMode::Headless && glfwInitState())
+			glfwTerminate(); // clean up GLFW if it was initialized
+		throw; // pass the exception up to main
+	}
 
-		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+}
 
-		int width = static_cast<int>(windowWidth * m_dpiScale);
-		int height = static_cast<int>(windowHeight * m_dpiScale);
+void Application::InitializeGraphics(int windowWidth, int windowHeight, const char* windowTitle)
+{
+	const bool windowed = m_config.mode == RunMode::Windowed;
 
-		m_window = std::make_unique<Window>(width, height, windowTitle);
+	// 1. Initialize GLFW
+	glfwSetErrorCallback(Window::GlfwErrorCallback);
+	if (!glfwInit()) {
+		throw std::runtime_error("Failed to initialize GLFW");
+	}
+	std::cout << "GLFW initialized successfully." << std::endl;
 
-		// link the application's window instance to the GLFW window
-		glfwSetWindowUserPointer(m_window->GetNativeHandle(), this);
-		glfwSetWindowContentScaleCallback(m_window->GetNativeHandle(), WindowContentScaleCallback);
+	// 2. Get DPI so window and ImGui scale is correct across different resolutions
+	// offscreen frames are captured at exactly the requested size
+	GLFWmonitor* primaryMonitor = windowed ? glfwGetPrimaryMonitor() : nullptr;
+	if (primaryMonitor)
+	{
+		float xscale, yscale;
+		glfwGetMonitorContentScale(primaryMonitor, &xscale, &yscale);
+		m_dpiScale = (xscale + yscale) / 2.0f; // take average
+		std::cout << "DPI Scale: " << m_dpiScale << std::endl;
+	}
+	else if (windowed)
+	{
+		std::cerr << "Warning: Failed to get primary monitor for DPI scale." << std::endl;
+	}
 
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	// offscreen mode still needs a context, a hidden window is the portable way to get one
+	glfwWindowHint(GLFW_VISIBLE, windowed ? GLFW_TRUE : GLFW_FALSE);
 
-		// 2. Initialize OpenGL using GLAD
-		if (!gladLoadGL((GLADloadfunc)glfwGetProcAddress))
-		{
-			throw std::runtime_error("Failed to initialize GLAD");
-		}
-		std::cout << "GLAD initialized successfully." << std::endl;
-		glEnable(GL_DEPTH_TEST); // enable depth testing for 3D rendering
+	int width = static_cast<int>(windowWidth * m_dpiScale);
+	int height = static_cast<int>(windowHeight * m_dpiScale);
 
-		// 3. Initialize ImGui
+	m_window = std::make_unique<Window>(width, height, windowTitle);
+
+	// link the application's window instance to the GLFW window
+	glfwSetWindowUserPointer(m_window->GetNativeHandle(), this);
+	glfwSetWindowContentScaleCallback(m_window->GetNativeHandle(), WindowContentScaleCallback);
+
+
+	// 2. Initialize OpenGL using GLAD
+	if (!gladLoadGL((GLADloadfunc)glfwGetProcAddress))
+	{
+		throw std::runtime_error("Failed to initialize GLAD");
+	}
+	std::cout << "GLAD initialized successfully." << std::endl;
+	glEnable(GL_DEPTH_TEST); // enable depth testing for 3D rendering
+
+	// every mesh created from here on suballocates its buffers from the arena
+	GeometryArena::Initialize();
+
+	// 3. Initialize ImGui, or the framebuffer frames are rendered into
+	if (windowed)
 		InitImGui();
+	else
+		m_renderTarget = std::make_unique<RenderTarget>(width, height);
 
-		// 4. Initialize Shaders
-		InitializeShaders();
-	
-		// --- Temporary OpenGL Object Creation (Remove the old m_ShaderProgram, m_Vao, m_Vbo setup for the triangle) ---
-		InitializeModel();
-		// --- End of temporary OpenGL object creation ---
+	// 4. Initialize Shaders and the per-frame uniform buffer they share
+	InitializeShaders();
+	m_frameUniforms = std::make_unique<UniformBuffer>(sizeof(FrameUniforms), c_FRAME_UNIFORM_BINDING);
+	m_shadowMap = std::make_unique<ShadowMap>();
 
-		std::cout << "Subsystems initialized." << std::endl;
+	m_camera = std::make_unique<Camera>(static_cast<float>(width), static_cast<float>(height), 0.1f, 100.0f);
+	m_camera->SetPosition(glm::vec3(0.0f, 0.0f, 3.0f));
+
+	// asset files are only queued here, they are uploaded a few at a time from RenderScene
+	m_assets = std::make_unique<AssetManager>();
+	if (m_config.tableModel)
+		m_tableModel = m_assets->LoadModel(m_config.tableModel);
+
+	// --- Temporary OpenGL Object Creation (Remove the old m_ShaderProgram, m_Vao, m_Vbo setup for the triangle) ---
+	InitializeModel();
+	// --- End of temporary OpenGL object creation ---
+
+	InitializeBalls();
+}
+
+void Application::InitializePhysics()
+{
+	if (m_config.replayPath)
+	{
+		// the world starts from the log's first keyframe, with the step it was recorded with
+		m_shotLog = std::make_unique<ShotLog>();
+		if (!m_shotLog->Load(m_config.replayPath))
+			throw std::runtime_error(std::string("Failed to read shot log: ") + m_config.replayPath);
+		m_config.deterministic = true;
+		m_physics = std::make_unique<PhysicsWorld>(m_shotLog->GetFixedStep());
+		m_replay = std::make_unique<ShotReplay>(*m_shotLog, *m_physics);
+		m_physics->SaveSnapshot(m_renderState);
+		return;
 	}
-	catch (const std::exception& e)
+
+	m_physics = std::make_unique<PhysicsWorld>();
+	m_config.deterministic = m_config.deterministic || m_config.recordPath;
+	m_physics->SetDeterministic(m_config.deterministic);
+	m_physics->RackBalls();
+
+	if (m_config.recordPath)
 	{
-		std::cerr << "Window Initialization Error: " << e.what() << std::endl;
-		if (glfwInitState())
-			glfwTerminate(); // clean up GLFW if it was initialized
-		throw; // pass the exception up to main
+		m_shotLog = std::make_unique<ShotLog>();
+		m_shotLog->Begin(*m_physics);
+		m_recording = true;
 	}
 
+	if (m_config.breakSpeed > 0.0f)
+	{
+		CueShot shot;
+		shot.speed = m_config.breakSpeed;
+		StrikeBall(0, shot);
+	}
+	m_physics->SaveSnapshot(m_renderState);
+
+	// in the window the planner can be started from ImGui, the render and simulation threads keep a core each
+	if (m_config.autoPlay || m_config.mode == RunMode::Windowed)
+	{
+		const unsigned plannerThreads = m_config.mode == RunMode::Windowed
+			? std::max(std::thread::hardware_concurrency(), 3u) - 2 : 0;
+		m_planner = std::make_unique<ShotPlanner>(plannerThreads);
+		m_autoPlay = m_config.autoPlay;
+	}
+
+	// nothing streams the table model in without a window, so its cushions are read right away
+	if (m_config.mode == RunMode::Headless && m_config.tableModel)
+	{
+		auto rails = std::make_shared<RailGeometry>();
+		ApplyRailGeometry(ModelLoader::LoadRailGeometry(m_config.tableModel, *rails) ? rails : nullptr);
+	}
+}
+
+void Application::ApplyRailGeometry(std::shared_ptr<const RailGeometry> rails) {
+	m_railsLoaded = true;
+	if (!rails)
+	{
+		std::cout << "No cushions at ball height in " << m_config.tableModel << ", keeping the box cushions.\n";
+		return;
+	}
+	std::cout << "Cushions of " << m_config.tableModel << ": " << rails->GetSegmentCount() << " segments and "
+		<< rails->GetArcCount() << " arcs.\n";
+
+	// a shot log only carries strikes, so a replay has to run against the same cushions it was recorded with
+	if (m_config.deterministic)
+	{
+		std::cout << "Deterministic physics keeps the box cushions.\n";
+		return;
+	}
+
+	m_rails = rails;
+	ApplyToPhysics([rails](PhysicsWorld& world) { world.SetRailGeometry(rails); });
+	if (m_planner)
+		m_planner->SetRailGeometry(rails);
 }
 
 void Application::ShutdownSubsystems() {
+	m_simulation.reset(); // joins, nothing else may touch the world while it runs
+	m_planner.reset(); // waits for a running search
+
 	if (m_isRunning || m_window) { // make sure shutdown happens if instance was created
 		std::cout << "Shutting down application subsystems..." << std::endl;
-		ShutdownImGui();
+		if (m_imGuiInitialized)
+			ShutdownImGui();
 	}
 
 	m_ModelShader.reset();
-
-	 // --- Cleanup OpenGL Objects (Move to class destructors later)  ---
-	// glDeleteProgram(m_ShaderProgram); // Old one, remove
-	if (m_ModelVAO != 0) glDeleteVertexArrays(1, &m_ModelVAO);
-	if (m_ModelVBO != 0) glDeleteBuffers(1, &m_ModelVBO);
-	if (m_ModelEBO != 0) glDeleteBuffers(1, &m_ModelEBO); // If you add EBO
-	// --- End of OpenGL object cleanup ---
+	m_profiler.reset(); // owns queries, before the context goes
+	m_shadowShader.reset();
+	m_shadowMap.reset();
+	m_frameUniforms.reset();
+	m_ballInstances.reset();
+	m_ballModel.reset();
+	m_triangleModel.reset();
+	m_assets.reset();
+	m_renderTarget.reset();
+	m_renderQueue.Shutdown();
+	m_shadowQueue.Shutdown();
+	GeometryArena::Shutdown(); // after everything that owns meshes
 
 	// m_window will destruct itself and terminate GLFW
 
@@ -153,38 +295,76 @@ void Application::InitializeShaders()
 {
 	try {
 		m_ModelShader = std::make_unique<Shader>("shaders/model.vert", "shaders/model.frag");
+		if (!m_ModelShader->BindUniformBlock("FrameData", c_FRAME_UNIFORM_BINDING))
+			std::cerr << "Model shader has no FrameData uniform block." << std::endl;
+		m_modelUniforms.ballColors = m_ModelShader->GetUniformLocation("ballColors");
+		m_modelShaderId = m_renderQueue.AddShader(*m_ModelShader);
+		m_ModelShader->Use();
+		m_ModelShader->SetInt(m_ModelShader->GetUniformLocation("shadowMap"), static_cast<int>(c_SHADOW_MAP_UNIT));
 		std::cout << "Model shader loaded successfully." << std::endl;
 	}
 	catch (const std::exception& e) {
 		std::cerr << "Failed to load model shader: " << e.what() << std::endl;
 		// Handle error, perhaps rethrow or set a bad state
 	}
+
+	try {
+		m_shadowShader = std::make_unique<Shader>("shaders/shadow.vert", "shaders/shadow.frag");
+		if (!m_shadowShader->BindUniformBlock("FrameData", c_FRAME_UNIFORM_BINDING))
+			std::cerr << "Shadow shader has no FrameData uniform block." << std::endl;
+		m_shadowShaderId = m_shadowQueue.AddShader(*m_shadowShader);
+		m_shadowMaterial = m_shadowQueue.AddMaterial({}); // depth only, the values are never read
+		std::cout << "Shadow shader loaded successfully." << std::endl;
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Failed to load shadow shader, shadows are disabled: " << e.what() << std::endl;
+		m_shadowShader.reset();
+	}
 }
 
 void Application::InitializeModel()
 {
-	float vertices[] = {
-		// positions         // normals (dummy for now) // texCoords (dummy)
-		-0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f,
-		 0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  1.0f, 0.0f,
-		 0.0f,  0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  0.5f, 1.0f
+	const Vertex vertices[] = {
+		// position                     // texCoord             // normal
+		{ { -0.5f, -0.5f, 0.0f },  { 0.0f, 0.0f },  { 0.0f, 0.0f, 1.0f } },
+		{ {  0.5f, -0.5f, 0.0f },  { 1.0f, 0.0f },  { 0.0f, 0.0f, 1.0f } },
+		{ {  0.0f,  0.5f, 0.0f },  { 0.5f, 1.0f },  { 0.0f, 0.0f, 1.0f } },
 	};
-	glGenVertexArrays(1, &m_ModelVAO);
-	glGenBuffers(1, &m_ModelVBO);
-	glBindVertexArray(m_ModelVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_ModelVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-	// Position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// Normal attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	// TexCoord attribute
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glBindVertexArray(0);
-	m_ModelIndexCount = 3; // Not using EBO for this simple triangle array draw
+	const GLsizei indices[] = { 0, 1, 2 };
+
+	std::vector<Mesh> meshes;
+	meshes.emplace_back(vertices, indices, 3, 3);
+	m_triangleModel = std::make_unique<Model>(std::move(meshes), "");
+
+	// per-draw uniforms of everything the scene draws
+	m_materials.triangle = m_renderQueue.AddMaterial({ glm::vec3(1.0f, 0.5f, 0.31f), true }); // coral
+	m_materials.table = m_renderQueue.AddMaterial({ glm::vec3(0.05f, 0.35f, 0.15f), true }); // felt green
+	m_materials.balls = m_renderQueue.AddMaterial({ glm::vec3(1.0f), true }); // colours come from ballColors
+
+	// the table file is the environment, large enough that hidden parts of it are worth a query
+	m_tableOcclusionTest = m_renderQueue.AddOcclusionTest();
+}
+
+void Application::InitializeBalls()
+{
+	std::vector<Mesh> meshes;
+	meshes.push_back(Primitives::CreateSphere(c_BALL_RADIUS, 16, 24));
+	m_ballModel = std::make_unique<Model>(std::move(meshes), "");
+	m_ballInstances = std::make_unique<InstanceBuffer>(c_BALL_COUNT);
+	std::cout << "Ball instance buffer " << (m_ballInstances->IsPersistent() ? "persistently mapped." : "mapped per frame.") << std::endl;
+
+	// cue ball, solids 1-7, eight ball, stripes 9-15 drawn in their base colour
+	static const glm::vec3 s_ballColors[c_BALL_COUNT] = {
+		{ 0.95f, 0.95f, 0.90f }, { 0.95f, 0.80f, 0.10f }, { 0.10f, 0.20f, 0.80f }, { 0.85f, 0.10f, 0.10f },
+		{ 0.40f, 0.10f, 0.55f }, { 0.95f, 0.45f, 0.05f }, { 0.05f, 0.50f, 0.20f }, { 0.50f, 0.10f, 0.10f },
+		{ 0.05f, 0.05f, 0.05f }, { 0.95f, 0.80f, 0.10f }, { 0.10f, 0.20f, 0.80f }, { 0.85f, 0.10f, 0.10f },
+		{ 0.40f, 0.10f, 0.55f }, { 0.95f, 0.45f, 0.05f }, { 0.05f, 0.50f, 0.20f }, { 0.50f, 0.10f, 0.10f },
+	};
+	if (m_ModelShader)
+	{
+		m_ModelShader->Use();
+		m_ModelShader->SetVec3Array(m_modelUniforms.ballColors, s_ballColors, c_BALL_COUNT);
+	}
 }
 
 void Application::InitImGui() {
@@ -205,6 +385,7 @@ void Application::InitImGui() {
 
 	ImGui_ImplGlfw_InitForOpenGL(m_window->GetNativeHandle(), true);
 	ImGui_ImplOpenGL3_Init("#version 330 core");
+	m_imGuiInitialized = true;
 	std::cout << "ImGui initialized." << std::endl;
 }
 
@@ -212,6 +393,7 @@ void Application::ShutdownImGui() {
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
+	m_imGuiInitialized = false;
 }
 
 void Application::BeginImGuiFrame() {
@@ -221,6 +403,7 @@ void Application::BeginImGuiFrame() {
 }
 
 void Application::RenderImGui() {
+	Profiler::GpuScope gpuScope(m_profiler.get(), "ImGui");
 	ImGui::Render();
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
@@ -231,53 +414,157 @@ void Application::RenderImGui() {
 
 
 void Application::ProcessInput(float deltaTime) {
+	if (!m_window)
+		return; // headless, nothing to read input from
+
 	if (glfwGetKey(m_window->GetNativeHandle(), GLFW_KEY_ESCAPE) == GLFW_PRESS) {
 		glfwSetWindowShouldClose(m_window->GetNativeHandle(), true);
 	}
 	// Add other input processing here (e.g., for camera, player, etc.)
 }
 
+void Application::ApplyToPhysics(SimulationThread::Command command) {
+	if (m_simulation)
+		m_simulation->Submit(std::move(command));
+	else if (m_physics)
+		command(*m_physics);
+}
+
+void Application::StrikeBall(int ball, const CueShot& shot) {
+	if (m_replay)
+		return; // the log decides what happens
+	ApplyToPhysics([this, ball, shot](PhysicsWorld& world) {
+		if (m_recording)
+			m_shotLog->RecordStrike(world, ball, shot);
+		world.Strike(ball, shot);
+	});
+}
+
 void Application::Update(float deltaTime) {
-	// Update simulation logic, physics, etc.
+	if (m_replay)
+	{
+		m_replay->AdvanceTime(deltaTime * m_replaySpeed);
+		m_physics->SaveSnapshot(m_renderState);
+	}
+	else if (m_simulation)
+	{
+		// the simulation ticks on its own, the frame only picks up where it is
+		m_simulation->Interpolate(deltaTime, m_renderState);
+	}
+	else if (m_physics)
+	{
+		// physics runs in fixed substeps, the world accumulates the frame time itself
+		m_physics->Update(deltaTime);
+		if (m_recording)
+			m_shotLog->RecordTick(*m_physics);
+		m_physics->SaveSnapshot(m_renderState);
+	}
+
+	// the cushions are read or baked on the loader thread with the table model and handed over once it is in
+	if (!m_railsLoaded && m_assets && m_tableModel.IsValid() && m_assets->GetState(m_tableModel) == AssetState::Ready)
+		ApplyRailGeometry(m_assets->GetRailGeometry(m_tableModel));
+
+	UpdateShotPlanner();
+
+	// spin is turned by the simulated time between the drawn snapshots, not the frame time, so it follows the
+	// replay speed and the interpolated render clock and stops with the balls. Going back, as a seek can, turns nothing
+	const float simulatedTime = std::max(0.0f, m_renderState.time - m_ballTransformTime);
+	m_ballTransformTime = m_renderState.time;
+	if (m_ballModel)
+		m_ballTransforms.Update(m_renderState, simulatedTime);
 }
 
-void Application::Render() {
-	glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Add GL_DEPTH_BUFFER_BIT if doing 3D
+void Application::UpdateShotPlanner() {
+	if (!m_planner)
+		return;
 
-	// --- Your OpenGL scene rendering would go here ---
-	// For now, we're just clearing the screen.
-	// The triangle/model drawing will be added back here later.
+	ShotPlan plan;
+	if (m_planner->Poll(plan))
+	{
+		m_lastPlan = plan;
+		m_hasPlan = true;
+		if (m_autoPlay)
+			PlayPlannedShot(plan);
+	}
+	if (!m_autoPlay || m_planner->IsSearching())
+		return;
 
+	TableState table;
+	if (!GetRestingTable(table))
+		return;
 
-	if(m_ModelShader && m_ModelVAO != 0) {
-		m_ModelShader->Use();
+	const std::uint16_t pocketed = table.GetPocketedMask();
+	const std::uint16_t objectBalls = static_cast<std::uint16_t>(((1u << table.ballCount) - 1) & ~1u);
+	const bool cleared = (pocketed & objectBalls) == objectBalls;
+	if (cleared || (pocketed & 1u) || m_plannedShots >= c_MAX_PLANNED_SHOTS)
+	{
+		int pottedCount = 0;
+		for (int i = 1; i < table.ballCount; i++)
+			pottedCount += (pocketed >> i) & 1;
+		std::cout << "Planner " << (cleared ? "cleared the table" : (pocketed & 1u) ? "lost the cue ball" : "gave up")
+			<< " after " << m_plannedShots << " shots, " << pottedCount << " of " << table.ballCount - 1
+			<< " balls pocketed." << std::endl;
+		m_autoPlay = false;
+		return;
+	}
 
-		glm::mat4 projection = glm::perspective(glm::radians(m_camera->GetZoom()),
-			(float)m_window->GetWidth() / (float)m_window->GetHeight(),
-			0.1f, 100.0f);
-		glm::mat4 view = m_camera->GetViewMatrix();
-		m_ModelShader->SetMat4("projection", projection);
-		m_ModelShader->SetMat4("view", view);
+	// without a window nothing waits on frames, searching right here keeps the run reproducible
+	if (m_config.mode == RunMode::Windowed)
+		m_planner->Start(table);
+	else
+		PlayPlannedShot(m_planner->Plan(table));
+}
 
-		glm::mat4 model = glm::mat4(1.0f);
-		// model = glm::rotate(model, (float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f)); // Optional: test rotation
-		m_ModelShader->SetMat4("model", model);
+void Application::PlayPlannedShot(const ShotPlan& plan) {
+	m_lastPlan = plan;
+	m_hasPlan = false; // played, a new search is needed for the next one
+	if (m_simulation)
+	{
+		m_plannedShotPending = true;
+		m_pendingCommandCount = m_simulation->GetLatest().commandCount;
+	}
+	StrikeBall(0, plan.shot);
+	++m_plannedShots;
+	std::cout << "Planned shot " << m_plannedShots << ": " << plan.evaluated << " shots searched in " << plan.searchTime
+		<< " s (" << plan.evaluated / std::max(plan.searchTime, 1e-6f) << " shots/s), expected score " << plan.score
+		<< ", pots in " << plan.potChance * 100.0f << "% of noisy tries." << std::endl;
+}
 
-		// Set lighting/material uniforms for the new shader
-		m_ModelShader->SetVec3("objectColor", 1.0f, 0.5f, 0.31f); // e.g., coral
-		m_ModelShader->SetVec3("lightColor", 1.0f, 1.0f, 1.0f);
-		m_ModelShader->SetVec3("lightPos_World", 1.2f, 1.0f, 2.0f);
-		m_ModelShader->SetVec3("viewPos_World", m_camera->GetPosition());
+bool Application::GetRestingTable(TableState& table) {
+	if (m_replay)
+		return false;
 
-		glBindVertexArray(m_ModelVAO);
-		// If using EBO: glDrawElements(GL_TRIANGLES, m_ModelIndexCount, GL_UNSIGNED_INT, 0);
-		glDrawArrays(GL_TRIANGLES, 0, 3); // For the simple triangle VBO
-		glBindVertexArray(0);
+	if (m_simulation)
+	{
+		// the strike runs before the simulation's next tick, every snapshot until then still shows the old table
+		const PhysicsSnapshot& latest = m_simulation->GetLatest();
+		if (m_plannedShotPending && latest.commandCount == m_pendingCommandCount)
+			return false;
+		m_plannedShotPending = false;
+		if (!latest.atRest)
+			return false;
+
+		table.ballCount = latest.ballCount;
+		std::copy(latest.posX, latest.posX + latest.ballCount, table.posX);
+		std::copy(latest.posY, latest.posY + latest.ballCount, table.posY);
+		std::copy(latest.state, latest.state + latest.ballCount, table.state);
+		return true;
 	}
 
+	if (!m_physics || !m_physics->IsAtRest())
+		return false;
+	m_physics->SaveState(table);
+	return true;
+}
+
+void Application::Render() {
+	{
+		Profiler::CpuScope scope(m_profiler.get(), "Scene");
+		RenderScene();
+	}
 
 	// --- Render ImGui UI ---
+	Profiler::CpuScope imGuiScope(m_profiler.get(), "ImGui");
 	BeginImGuiFrame();
 
 	if (m_showDemoWindow) {
@@ -286,38 +573,418 @@ void Application::Render() {
 	ImGui::Begin("My Application Controls");
 	ImGui::Text("Hello from Application class!");
 	ImGui::Checkbox("Show ImGui Demo Window", &m_showDemoWindow);
+	ImGui::Checkbox("Show profiler", &m_showProfiler);
+	if (m_physics)
+	{
+		bool eventDriven = m_renderState.solverMode == SolverMode::EventDriven;
+		if (m_config.deterministic)
+			ImGui::Text("Deterministic physics%s", m_recording ? ", recording" : "");
+		else if (ImGui::Checkbox("Event-driven physics", &eventDriven))
+		{
+			const SolverMode mode = eventDriven ? SolverMode::EventDriven : SolverMode::FixedStep;
+			ApplyToPhysics([mode](PhysicsWorld& world) { world.SetSolverMode(mode); });
+		}
+		ImGui::Text("Collision kernel: %s", CollisionKernel::GetPathName(m_renderState.kernelPath));
+		if (m_rails)
+			ImGui::Text("Cushions: %d segments, %d arcs from the table model", m_rails->GetSegmentCount(), m_rails->GetArcCount());
+		else
+			ImGui::Text("Cushions: box");
+		if (m_renderState.solverMode == SolverMode::FixedStep)
+			ImGui::Text("Awake: %d balls in %d islands", m_renderState.awakeCount, m_renderState.islandCount);
+		if (m_simulation)
+		{
+			const PhysicsSnapshot& latest = m_simulation->GetLatest();
+			ImGui::Text("Physics thread: %.0f Hz, tick %llu took %.3f ms", m_simulation->GetTickRate(),
+				static_cast<unsigned long long>(latest.tick), latest.stepTime);
+		}
+	}
+	if (m_replay)
+	{
+		// seconds are easier to scrub than steps
+		const float fixedStep = m_physics->GetFixedStep();
+		const float duration = static_cast<float>(m_replay->GetLastStep() - m_replay->GetFirstStep()) * fixedStep;
+		float position = static_cast<float>(m_replay->GetStep() - m_replay->GetFirstStep()) * fixedStep;
+		if (ImGui::SliderFloat("Replay", &position, 0.0f, duration, "%.2f s"))
+			m_replay->Seek(m_replay->GetFirstStep() + static_cast<std::uint64_t>(position / fixedStep));
+		ImGui::SliderFloat("Replay speed", &m_replaySpeed, 0.0f, 8.0f, "%.2fx");
+		ImGui::Text("Keyframes verified: %d, mismatches: %d", m_replay->GetVerifiedKeyframes(), m_replay->GetMismatchCount());
+	}
+	if (m_planner)
+	{
+		ImGui::Checkbox("Planner plays", &m_autoPlay);
+		TableState table;
+		if (m_planner->IsSearching())
+			ImGui::Text("Searching shots on %d threads...", m_planner->GetWorkerCount());
+		else if (!m_autoPlay && GetRestingTable(table))
+		{
+			if (ImGui::Button("Plan shot"))
+				m_planner->Start(table);
+			if (m_hasPlan)
+			{
+				ImGui::SameLine();
+				if (ImGui::Button("Play planned shot"))
+					PlayPlannedShot(m_lastPlan);
+			}
+		}
+		if (m_lastPlan.evaluated > 0)
+		{
+			ImGui::Text("Plan: angle %.3f rad, %.2f m/s, spin %.2f side %.2f top", m_lastPlan.shot.angle,
+				m_lastPlan.shot.speed, m_lastPlan.shot.sideSpin, m_lastPlan.shot.topSpin);
+			ImGui::Text("Expected score %.2f, pots in %.0f%% of noisy tries, %d shots in %.2f s (%.0f shots/s)",
+				m_lastPlan.score, m_lastPlan.potChance * 100.0f, m_lastPlan.evaluated, m_lastPlan.searchTime,
+				m_lastPlan.evaluated / std::max(m_lastPlan.searchTime, 1e-6f));
+		}
+	}
+	if (m_assets)
+		ImGui::Text("Assets streaming: %d", m_assets->GetPendingCount());
+	const RenderQueue::Stats& renderStats = m_renderQueue.GetStats();
+	ImGui::Text("Draws: %d items, %d calls, %d shader / %d VAO binds, %d material changes", renderStats.items,
+		renderStats.drawCalls, renderStats.shaderBinds, renderStats.vertexArrayBinds, renderStats.materialChanges);
+	bool occlusionCulling = m_renderQueue.IsOcclusionCulling();
+	if (ImGui::Checkbox("Occlusion culling", &occlusionCulling))
+		m_renderQueue.SetOcclusionCulling(occlusionCulling);
+	ImGui::Text("Culled: %d meshes outside the frustum, %d occluded, %d balls, %d queries", renderStats.culledMeshes,
+		renderStats.occludedMeshes, m_culledBalls, renderStats.occlusionQueries);
+	ImGui::Text("Shadows: %d casters redrawn, static map drawn %d times", m_shadowCasterCount, m_staticShadowPasses);
+	if (m_framePacer)
+	{
+		int mode = static_cast<int>(m_framePacer->GetMode());
+		if (ImGui::Combo("Frame pacing", &mode, "Uncapped\0Adaptive vsync\0Fixed rate\0"))
+			m_framePacer->SetMode(static_cast<PacingMode>(mode));
+		float targetRate = static_cast<float>(m_framePacer->GetTargetRate());
+		if (m_framePacer->GetMode() == PacingMode::FixedRate && ImGui::SliderFloat("Target rate", &targetRate, 15.0f, 360.0f, "%.0f Hz"))
+			m_framePacer->SetTargetRate(targetRate);
+		const FramePacer::Stats frameStats = m_framePacer->GetStats();
+		ImGui::Text("Frame: %.2f ms average, %.2f / %.2f min / max, %.2f 99th percentile, %.2f ms work",
+			frameStats.averageFrameTime, frameStats.minFrameTime, frameStats.maxFrameTime,
+			frameStats.percentile99FrameTime, frameStats.averageWorkTime);
+	}
 	ImGui::End();
+	if (m_showProfiler && m_profiler)
+		m_profiler->DrawPanel(&m_showProfiler);
 
 	RenderImGui(); // This handles ImGui::Render() and drawing the data
 }
 
+void Application::RenderScene() {
+	glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Add GL_DEPTH_BUFFER_BIT if doing 3D
+
+	// move finished loads to the GPU, bounded per frame so streaming never stalls a frame
+	if (m_assets)
+		m_assets->Update();
+
+	// --- Your OpenGL scene rendering would go here ---
+	// For now, we're just clearing the screen.
+	// The triangle/model drawing will be added back here later.
+
+
+	// camera and light are uploaded once per frame, every shader reads them from the same buffer
+	if (m_frameUniforms && m_camera) {
+		FrameUniforms frame;
+		frame.projection = glm::perspective(glm::radians(m_camera->GetZoom()),
+			m_renderTarget ? (float)m_renderTarget->GetWidth() / (float)m_renderTarget->GetHeight()
+				: (float)m_window->GetWidth() / (float)m_window->GetHeight(),
+			0.1f, 100.0f);
+		frame.view = m_camera->GetViewMatrix();
+		frame.viewProjection = frame.projection * frame.view;
+		frame.viewPosition = glm::vec4(m_camera->GetPosition(), 1.0f);
+		frame.lightPosition = glm::vec4(c_TABLE_LIGHT_POSITION, 1.0f);
+		frame.lightColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+		// the light looks straight down onto the table plane
+		frame.lightViewProjection = glm::perspective(glm::radians(c_TABLE_LIGHT_FOV), 1.0f, c_TABLE_LIGHT_NEAR, c_TABLE_LIGHT_FAR)
+			* glm::lookAt(c_TABLE_LIGHT_POSITION, c_TABLE_LIGHT_POSITION - glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		m_frameUniforms->Update(frame);
+
+		// everything submitted below is culled against the same matrix the shaders draw with
+		m_renderQueue.SetView(frame.viewProjection, m_camera->GetPosition());
+		m_shadowQueue.SetView(frame.lightViewProjection, c_TABLE_LIGHT_POSITION);
+	}
+
+	if (m_ModelShader && m_triangleModel) {
+		glm::mat4 model = glm::mat4(1.0f);
+		// model = glm::rotate(model, (float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f)); // Optional: test rotation
+		m_renderQueue.Submit(m_modelShaderId, m_materials.triangle, *m_triangleModel, model, glm::mat3(1.0f));
+	}
+
+	RenderTable();
+	RenderBalls();
+	RenderShadows(); // before the flush, the scene samples the map
+
+	// the recorded draws are sorted by state and issued here
+	{
+		Profiler::GpuScope gpuScope(m_profiler.get(), "Scene");
+		m_renderQueue.Flush();
+	}
+	if (m_ballInstances)
+		m_ballInstances->Fence(); // after the draw that reads the ball instances
+}
+
+void Application::RenderTable() {
+	if (!m_ModelShader || !m_assets || !m_tableModel.IsValid())
+		return;
+
+	// the placeholder box until the file has streamed in
+	m_renderQueue.Submit(m_modelShaderId, m_materials.table, m_assets->GetModel(m_tableModel),
+		glm::mat4(1.0f), glm::mat3(1.0f), m_tableOcclusionTest);
+}
+
+void Application::RenderShadows() {
+	if (!m_shadowMap || !m_shadowShader)
+		return;
+	Profiler::CpuScope scope(m_profiler.get(), "Shadows");
+	Profiler::GpuScope gpuScope(m_profiler.get(), "Shadows");
+
+	// the static map only changes with the table, when a streamed in model replaces its placeholder
+	const Model* table = m_assets && m_tableModel.IsValid() ? &m_assets->GetModel(m_tableModel) : nullptr;
+	if (table != m_shadowedTable)
+	{
+		m_shadowMap->InvalidateStatic();
+		m_shadowedTable = table;
+	}
+
+	if (!m_shadowMap->IsStaticValid())
+	{
+		m_shadowMap->BeginStatic();
+		if (table)
+			m_shadowQueue.Submit(m_shadowShaderId, m_shadowMaterial, *table, glm::mat4(1.0f), glm::mat3(1.0f));
+		m_shadowQueue.Flush();
+		m_shadowMap->End();
+		m_staticShadowPasses++;
+	}
+
+	// the balls are the only casters that move, they are drawn over a copy of the static depth every frame
+	m_shadowMap->BeginDynamic();
+	if (m_ballModel && m_ballInstances && m_shadowCasterCount > 0)
+		m_shadowQueue.SubmitInstanced(m_shadowShaderId, m_shadowMaterial, *m_ballModel, *m_ballInstances, m_shadowCasterCount);
+	m_shadowQueue.Flush();
+	m_shadowMap->End();
+
+	m_shadowMap->Bind();
+}
+
+void Application::RenderBalls() {
+	m_shadowCasterCount = 0;
+	if (!m_ModelShader || !m_ballModel || !m_ballInstances)
+		return;
+
+	// the table plane of the physics world maps onto the x/y plane, facing the default camera
+	const BallState* states = m_renderState.state;
+	const int ballCount = std::min({ static_cast<int>(m_renderState.ballCount), m_ballTransforms.GetBallCount(),
+		static_cast<int>(m_ballInstances->GetCapacity()) });
+
+	// one sphere test per ball, four at a time, before any instance is written
+	float centerX[c_BALL_COUNT], centerY[c_BALL_COUNT], centerZ[c_BALL_COUNT], radius[c_BALL_COUNT];
+	std::uint8_t inFrustum[c_BALL_COUNT];
+	for (int i = 0; i < ballCount; i++)
+	{
+		const glm::mat4& transform = m_ballTransforms.GetTransform(i);
+		centerX[i] = transform[3].x;
+		centerY[i] = transform[3].y;
+		centerZ[i] = transform[3].z;
+		radius[i] = c_BALL_RADIUS;
+	}
+	m_renderQueue.GetFrustum().CullSpheres(centerX, centerY, centerZ, radius, ballCount, inFrustum);
+
+	int visible = 0;
+	m_culledBalls = 0;
+	for (int i = 0; i < ballCount; i++)
+	{
+		if (states[i] == BallState::Pocketed)
+			continue;
+		if (inFrustum[i])
+			visible++;
+		else
+			m_culledBalls++;
+		m_shadowCasterCount++;
+	}
+
+	// balls in view come first, balls outside it only cast shadows into it and follow them, so both passes
+	// draw a prefix of the same instances
+	BallInstance* instances = m_ballInstances->Map(m_shadowCasterCount);
+	int k = 0;
+	for (int pass = 1; pass >= 0; pass--)
+	{
+		for (int i = 0; i < ballCount; i++)
+		{
+			if (states[i] == BallState::Pocketed || inFrustum[i] != pass)
+				continue;
+			// the instance memory may be write-combined, so copy from the source and never read it back
+			const glm::mat4& transform = m_ballTransforms.GetTransform(i);
+			instances[k].transform = transform;
+			// balls are rotated, never scaled, so the normal matrix is the rotation itself
+			for (int column = 0; column < 3; column++)
+				instances[k].normalMatrix[column] = transform[column];
+			instances[k].ballId = static_cast<std::uint32_t>(i);
+			k++;
+		}
+	}
+	m_ballInstances->Unmap();
+
+	m_renderQueue.SubmitInstanced(m_modelShaderId, m_materials.balls, *m_ballModel, *m_ballInstances, visible);
+}
+
 void Application::Run() {
+	if (m_replay && m_config.mode == RunMode::Headless)
+		RunReplay();
+	else if (m_config.mode == RunMode::Windowed)
+		RunWindowed();
+	else
+		RunWithoutWindow();
+}
+
+void Application::RunWindowed() {
 	if (!m_window) {
 		std::cerr << "Window not initialized in Application. Cannot run." << std::endl;
 		return;
 	}
 	m_isRunning = true; // Set running state after all critical inits
 
-	auto lastTime = std::chrono::high_resolution_clock::now();
+	m_framePacer = std::make_unique<FramePacer>(m_window.get(), m_config.pacing, m_config.targetFrameRate);
+	if (m_config.pacing == PacingMode::AdaptiveVsync && !m_framePacer->HasAdaptiveVsync())
+		std::cout << "Adaptive vsync is not supported, falling back to vsync." << std::endl;
+
+	// from here on the world belongs to the simulation thread until the loop ends, replays step it per frame
+	if (m_config.threadedPhysics && m_physics && !m_replay)
+	{
+		m_simulation = std::make_unique<SimulationThread>(*m_physics, m_config.physicsTickRate);
+		if (m_recording)
+			m_simulation->SetTickHook([this](PhysicsWorld& world) { m_shotLog->RecordTick(world); });
+		m_simulation->Start();
+	}
 
-	
 	// main window loop
 	while (m_isRunning && !m_window->ShouldClose()) 
 	{
-		auto currentTime = std::chrono::high_resolution_clock::now();
-		float deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - lastTime).count();
-		lastTime = currentTime;
+		const float deltaTime = m_framePacer->BeginFrame();
+		m_profiler->BeginFrame();
 
 		glfwPollEvents(); // Poll events at the start of the frame
 
 		// application bits
 		{
-			std::cout << "Pretending to render...\n";
-			//ProcessInput(deltaTime);
-			//Update(deltaTime);
-			//Render();
+			Profiler::CpuScope scope(m_profiler.get(), "ProcessInput");
+			ProcessInput(deltaTime);
+		}
+		{
+			Profiler::CpuScope scope(m_profiler.get(), "Update");
+			Update(deltaTime);
+		}
+		{
+			Profiler::CpuScope scope(m_profiler.get(), "Render");
+			Render();
+		}
+		{
+			// blocks on vsync, so it shows where the frame waits for the display
+			Profiler::CpuScope scope(m_profiler.get(), "Swap");
+			m_window->SwapBuffers();
 		}
 
-		m_window->SwapBuffers();
+		m_profiler->EndFrame();
+		m_framePacer->EndFrame();
 	}
+	m_simulation.reset();
+
+	const FramePacer::Stats stats = m_framePacer->GetStats();
+	std::cout << "Last " << stats.frames << " frames (" << FramePacer::GetModeName(m_framePacer->GetMode()) << "): "
+		<< stats.averageFrameTime << " ms average, " << stats.minFrameTime << " / " << stats.maxFrameTime
+		<< " ms min / max, " << stats.percentile99FrameTime << " ms 99th percentile, "
+		<< stats.averageWorkTime << " ms work." << std::endl;
+	WriteTrace();
+	FinishRecording();
+}
+
+void Application::RunWithoutWindow() {
+	m_isRunning = true;
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	const float deltaTime = m_config.fixedDeltaTime;
+
+	// captured frames should be reproducible, so they never show placeholders
+	if (m_assets)
+		m_assets->Finish();
+
+	int frame = 0;
+	while (m_isRunning)
+	{
+		// a planner game runs until the planner stops playing
+		const bool atEnd = m_replay ? m_replay->IsFinished() : m_physics->IsAtRest() && !m_autoPlay;
+		const bool done = m_config.frameCount > 0 ? frame >= m_config.frameCount : atEnd;
+		if (done)
+			break;
+
+		m_profiler->BeginFrame();
+		{
+			Profiler::CpuScope scope(m_profiler.get(), "ProcessInput");
+			ProcessInput(deltaTime);
+		}
+		{
+			Profiler::CpuScope scope(m_profiler.get(), "Update");
+			Update(deltaTime);
+		}
+
+		if (m_renderTarget)
+		{
+			Profiler::CpuScope scope(m_profiler.get(), "Render");
+			m_renderTarget->Bind();
+			RenderScene();
+			if (m_config.capturePrefix && frame % m_config.captureInterval == 0)
+				CaptureFrame(frame);
+		}
+		m_profiler->EndFrame();
+		++frame;
+	}
+
+	const float wallTime = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - startTime).count();
+	std::cout << "Ran " << frame << " frames (" << m_physics->GetTime() << " s simulated) in "
+		<< wallTime << " s." << std::endl;
+	WriteTrace();
+	FinishRecording();
+}
+
+void Application::RunReplay() {
+	m_isRunning = true;
+
+	// no frames at all, the world is stepped from one recorded input to the next as fast as it goes
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	m_replay->Advance(m_replay->GetLastStep() - m_replay->GetStep());
+	const float wallTime = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+	const float simulated = static_cast<float>(m_replay->GetLastStep() - m_replay->GetFirstStep()) * m_physics->GetFixedStep();
+	std::cout << "Replayed " << m_shotLog->GetStrikeCount() << " strikes, " << simulated << " s simulated in "
+		<< wallTime << " s (" << simulated / std::max(wallTime, 1e-6f) << "x real time)." << std::endl;
+	if (m_replay->GetMismatchCount() > 0)
+		std::cerr << m_replay->GetMismatchCount() << " of " << m_replay->GetVerifiedKeyframes()
+			<< " keyframes differ from the recording, the first at step " << m_replay->GetFirstMismatchStep() << "." << std::endl;
+	else
+		std::cout << "All " << m_replay->GetVerifiedKeyframes() << " keyframes match the recording." << std::endl;
+}
+
+void Application::FinishRecording() {
+	if (!m_recording)
+		return;
+	m_recording = false;
+
+	// the simulation thread has stopped by now, the world is ours again
+	m_shotLog->End(*m_physics);
+	if (m_shotLog->Save(m_config.recordPath))
+		std::cout << "Recorded " << m_shotLog->GetStrikeCount() << " strikes and " << m_shotLog->GetKeyframeCount()
+			<< " keyframes in " << m_shotLog->GetSize() << " bytes to " << m_config.recordPath << std::endl;
+	else
+		std::cerr << "Failed to write shot log: " << m_config.recordPath << std::endl;
+}
+
+void Application::WriteTrace() {
+	if (!m_config.tracePath || !m_profiler)
+		return;
+	if (m_profiler->ExportChromeTrace(m_config.tracePath))
+		std::cout << "Wrote the last " << m_profiler->GetFrameCount() << " frames to " << m_config.tracePath << std::endl;
+	else
+		std::cerr << "Failed to write trace: " << m_config.tracePath << std::endl;
+}
+
+void Application::CaptureFrame(int frame) {
+	const std::string path = std::string(m_config.capturePrefix) + "_" + std::to_string(frame) + ".png";
+	if (!m_renderTarget->SaveImage(path.c_str()))
+		std::cerr << "Failed to write frame capture: " << path << std::endl;
 }
\ No newline at end of file
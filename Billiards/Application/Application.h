@@ -1,16 +1,73 @@
 #pragma once
 
+#include <cstdint>
 #include <memory> // for std::unique_ptr
 #include <imgui.h>
 
 #include "Window.h"
 #include "Shader.h"
 #include "Camera.h"
+#include "PhysicsWorld.h"
+#include "RenderTarget.h"
+#include "UniformBuffer.h"
+#include "InstanceBuffer.h"
+#include "Model.h"
+#include "BallTransforms.h"
+#include "AssetManager.h"
+#include "RenderQueue.h"
+#include "ShadowMap.h"
+#include "FramePacer.h"
+#include "Profiler.h"
+#include "SimulationThread.h"
+#include "ShotLog.h"
+#include "ShotReplay.h"
+#include "ShotPlanner.h"
+
+enum class RunMode : std::uint8_t
+{
+    Windowed,  // interactive window with ImGui
+    Headless,  // no GLFW, GL context or ImGui, only input and update run
+    Offscreen  // hidden window, frames are rendered into a RenderTarget and can be captured
+};
+
+struct ApplicationConfig
+{
+    int windowWidth = 1280;
+    int windowHeight = 720;
+    const char* windowTitle = "Billiards Simulation";
+    RunMode mode = RunMode::Windowed;
+
+    // outside windowed mode frames advance by a fixed time so runs are reproducible
+    float fixedDeltaTime = 1.0f / 60.0f;
+    int frameCount = 0;          // frames to run without a window, 0 runs until the table is at rest
+    float breakSpeed = 0.0f;     // strike the cue ball into the rack at startup, 0 leaves the table racked
+    const char* capturePrefix = nullptr; // offscreen only, frames are written to <prefix>_<frame>.png
+    int captureInterval = 1;             // capture every n-th frame
+    const char* tableModel = nullptr;    // model file streamed in for the table, drawn as a placeholder until loaded
+
+    // windowed only, how frames are paced against the display
+    PacingMode pacing = PacingMode::AdaptiveVsync;
+    double targetFrameRate = 60.0;       // fixed rate mode
+
+    const char* tracePath = nullptr;     // profiled frames are written here as Chrome trace JSON at exit
+
+    // windowed only, physics ticks on its own thread and frames draw interpolated snapshots
+    bool threadedPhysics = true;
+    double physicsTickRate = 120.0;
+
+    // deterministic physics, recording and replaying implies it
+    bool deterministic = false;
+    const char* recordPath = nullptr;    // strikes and keyframes are written here as a shot log at exit
+    const char* replayPath = nullptr;    // shot log to play back instead of simulating, as fast as possible when headless
+
+    bool autoPlay = false;               // the shot planner plays every shot until the table is cleared
+};
 
 class Application
 {
 public:
     Application(int windowWidth, int windowHeight, const char* windowTitle);
+    explicit Application(const ApplicationConfig& config);
     ~Application();
 
     // Rule of five/three
@@ -23,30 +80,64 @@ public:
 
 private:
     void InitializeSubsystems(int windowWidth, int windowHeight, const char * windowName);
+    void InitializeGraphics(int windowWidth, int windowHeight, const char* windowTitle);
+    void InitializePhysics();
     void ShutdownSubsystems();
     bool glfwInitState();
 
     void InitializeShaders();
     void InitializeModel();
+    void InitializeBalls();
+
+    // runs on the simulation thread before its next tick when there is one, right away otherwise
+    void ApplyToPhysics(SimulationThread::Command command);
+    // strikes go through here so they are recorded
+    void StrikeBall(int ball, const CueShot& shot);
+
+    // picks up finished searches and starts the next one once the table rests
+    void UpdateShotPlanner();
+    void PlayPlannedShot(const ShotPlan& plan);
+    // reads the cushions baked from the table model and hands them to the physics and the planner
+    void ApplyRailGeometry(std::shared_ptr<const RailGeometry> rails);
+    // false while balls move or a planned shot has not reached the world yet
+    bool GetRestingTable(TableState& table);
 
     void ProcessInput(float deltaTime);
     void Update(float deltaTime);
     void Render();
+    void RenderScene();
+    void RenderBalls();
+    void RenderTable();
+    void RenderShadows();
+
+    void RunWindowed();
+    void RunWithoutWindow();
+    void RunReplay();
+    void CaptureFrame(int frame);
+    void WriteTrace();
+    void FinishRecording();
 
     void InitImGui();
     void ShutdownImGui();
     void BeginImGuiFrame();
     void RenderImGui();
 
+    ApplicationConfig m_config;
+
     std::unique_ptr<Window> m_window;
+    std::unique_ptr<FramePacer> m_framePacer; // windowed only
+    std::unique_ptr<Profiler> m_profiler; // GPU timing whenever there is a context
+    std::unique_ptr<RenderTarget> m_renderTarget; // offscreen mode only
 
 	float m_dpiScale = 1.0f; // DPI scale for high-DPI displays
 
     // ImGui related state
     bool m_showDemoWindow = true;
+    bool m_showProfiler = false;
 	ImVec4 m_clearColor = ImVec4(0.45f, 0.55f, 0.60f, 1.00f); // Clear color
 
     bool m_isRunning = false;
+    bool m_imGuiInitialized = false;
 
     // static callback function for when window size changes and dpi needs to be adjusted
     static void WindowContentScaleCallback(GLFWwindow* window, float xscale, float yscale);
@@ -54,12 +145,70 @@ private:
 
 	std::unique_ptr<Camera> m_camera; // Camera object
 
+	std::unique_ptr<PhysicsWorld> m_physics; // ball simulation, stepped from Update
+    std::unique_ptr<SimulationThread> m_simulation; // owns m_physics while it runs, declared after it to stop first
+    PhysicsSnapshot m_renderState; // the balls as drawn this frame
+
+    // a recording is only touched from the thread that steps the world
+    std::unique_ptr<ShotLog> m_shotLog;
+    bool m_recording = false;
+    std::unique_ptr<ShotReplay> m_replay; // drives m_physics from m_shotLog instead of the simulation
+    float m_replaySpeed = 1.0f;
+
+    // searches shots on its own threads, plays them through StrikeBall while m_autoPlay is set
+    std::unique_ptr<ShotPlanner> m_planner;
+    bool m_autoPlay = false;
+    bool m_plannedShotPending = false;
+    std::uint64_t m_pendingCommandCount = 0; // the simulation thread's command count before the planned strike
+    ShotPlan m_lastPlan;
+    bool m_hasPlan = false;
+    int m_plannedShots = 0;
+
     // shader data (move to dedicated classes later)
     std::unique_ptr<Shader> m_ModelShader; // New shader object
-
-    // For basic model data (will move to Model/Mesh classes later)
-    unsigned int m_ModelVAO = 0;
-    unsigned int m_ModelVBO = 0;
-    unsigned int m_ModelEBO = 0;
-    unsigned int m_ModelIndexCount = 0;
+    std::unique_ptr<UniformBuffer> m_frameUniforms; // camera and light, FrameData block
+
+    // model shader uniform locations, looked up once after linking
+    struct ModelUniforms
+    {
+        int ballColors = -1;
+    } m_modelUniforms;
+
+    // every draw of a frame goes through the queue, sorted by state and flushed at the end of RenderScene
+    RenderQueue m_renderQueue;
+    std::uint8_t m_modelShaderId = 0;
+    struct SceneMaterials
+    {
+        std::uint16_t triangle = 0;
+        std::uint16_t table = 0;
+        std::uint16_t balls = 0;
+    } m_materials;
+
+    // models and textures stream in on loader threads, the first frame never waits for them
+    std::unique_ptr<AssetManager> m_assets;
+    ModelHandle m_tableModel;
+    // the table model's cushions, the box of the table constants is used until they are loaded or if it has none
+    std::shared_ptr<const RailGeometry> m_rails;
+    bool m_railsLoaded = false;
+    std::uint16_t m_tableOcclusionTest = RenderQueue::c_NO_OCCLUSION_TEST;
+
+    // balls are drawn instanced, one draw call for the whole table
+    std::unique_ptr<Model> m_ballModel;
+    std::unique_ptr<InstanceBuffer> m_ballInstances;
+    BallTransforms m_ballTransforms; // only rebuilt for balls that moved
+    float m_ballTransformTime = 0.0f; // m_renderState.time the ball spin was last turned to
+    int m_culledBalls = 0; // outside the frustum last frame
+
+    // depth of the table light, static geometry cached and the balls redrawn every frame
+    std::unique_ptr<Shader> m_shadowShader;
+    std::unique_ptr<ShadowMap> m_shadowMap;
+    RenderQueue m_shadowQueue;
+    std::uint8_t m_shadowShaderId = 0;
+    std::uint16_t m_shadowMaterial = 0;
+    const Model* m_shadowedTable = nullptr; // table the static map was drawn with
+    int m_shadowCasterCount = 0; // instances of the ball buffer the shadow pass draws
+    int m_staticShadowPasses = 0;
+
+    // For basic model data
+    std::unique_ptr<Model> m_triangleModel;
 };
\ No newline at end of file
@@ -80,6 +80,7 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geo
         glAttachShader(ID, geometry);
     glLinkProgram(ID);
     checkCompileErrors(ID, "PROGRAM");
+    reflectUniforms();
     // Delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
@@ -97,41 +98,117 @@ void Shader::Use() const {
     glUseProgram(ID);
 }
 
+int Shader::GetUniformLocation(const std::string& name) const {
+    const auto it = m_uniformLocations.find(name);
+    return it != m_uniformLocations.end() ? it->second : -1;
+}
+
+bool Shader::BindUniformBlock(const char* blockName, unsigned int bindingPoint) const {
+    const GLuint blockIndex = glGetUniformBlockIndex(ID, blockName);
+    if (blockIndex == GL_INVALID_INDEX)
+        return false;
+    glUniformBlockBinding(ID, blockIndex, bindingPoint);
+    return true;
+}
+
+void Shader::SetBool(int location, bool value) const {
+    glUniform1i(location, (int)value);
+}
+void Shader::SetInt(int location, int value) const {
+    glUniform1i(location, value);
+}
+void Shader::SetFloat(int location, float value) const {
+    glUniform1f(location, value);
+}
+void Shader::SetVec2(int location, const glm::vec2& value) const {
+    glUniform2fv(location, 1, &value[0]);
+}
+void Shader::SetVec3(int location, const glm::vec3& value) const {
+    glUniform3fv(location, 1, &value[0]);
+}
+void Shader::SetVec3Array(int location, const glm::vec3* values, int count) const {
+    glUniform3fv(location, count, &values[0][0]);
+}
+void Shader::SetVec4(int location, const glm::vec4& value) const {
+    glUniform4fv(location, 1, &value[0]);
+}
+void Shader::SetMat3(int location, const glm::mat3& mat) const {
+    glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+void Shader::SetMat4(int location, const glm::mat4& mat) const {
+    glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+
 void Shader::SetBool(const std::string& name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    glUniform1i(GetUniformLocation(name), (int)value);
 }
 void Shader::SetInt(const std::string& name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1i(GetUniformLocation(name), value);
 }
 void Shader::SetFloat(const std::string& name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1f(GetUniformLocation(name), value);
 }
 void Shader::SetVec2(const std::string& name, const glm::vec2& value) const {
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform2fv(GetUniformLocation(name), 1, &value[0]);
 }
 void Shader::SetVec2(const std::string& name, float x, float y) const {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    glUniform2f(GetUniformLocation(name), x, y);
 }
 void Shader::SetVec3(const std::string& name, const glm::vec3& value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform3fv(GetUniformLocation(name), 1, &value[0]);
 }
 void Shader::SetVec3(const std::string& name, float x, float y, float z) const {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    glUniform3f(GetUniformLocation(name), x, y, z);
 }
 void Shader::SetVec4(const std::string& name, const glm::vec4& value) const {
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform4fv(GetUniformLocation(name), 1, &value[0]);
 }
 void Shader::SetVec4(const std::string& name, float x, float y, float z, float w) const {
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    glUniform4f(GetUniformLocation(name), x, y, z, w);
 }
 void Shader::SetMat2(const std::string& name, const glm::mat2& mat) const {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix2fv(GetUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 void Shader::SetMat3(const std::string& name, const glm::mat3& mat) const {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix3fv(GetUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 void Shader::SetMat4(const std::string& name, const glm::mat4& mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::reflectUniforms() {
+    m_uniformLocations.clear();
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+    if (!linked)
+        return;
+
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<GLchar> nameBuffer(static_cast<size_t>(maxNameLength) + 1);
+    for (GLuint index = 0; index < static_cast<GLuint>(uniformCount); index++) {
+        // members of uniform blocks have no location, they are set through the bound buffer
+        GLint blockIndex = -1;
+        glGetActiveUniformsiv(ID, 1, &index, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+        if (blockIndex != -1)
+            continue;
+
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, index, maxNameLength, &length, &size, &type, nameBuffer.data());
+        std::string name(nameBuffer.data(), length);
+
+        // arrays are reported as "name[0]", store them under the plain name as well
+        const GLint location = glGetUniformLocation(ID, name.c_str());
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            m_uniformLocations.emplace(name.substr(0, name.size() - 3), location);
+        m_uniformLocations.emplace(std::move(name), location);
+    }
 }
 
 void Shader::checkCompileErrors(GLuint shader, std::string type) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
 #include <glm/glm.hpp> // For glm types used in uniform setters
 
 // Forward declare GLAD's types if not including glad.h here (though often simpler to include)
@@ -23,11 +24,12 @@ public:
     // Prevent copying/moving
     Shader(const Shader&) = delete;
     Shader& operator=(const Shader&) = delete;
-    Shader(Shader&& other) noexcept : ID(other.ID) { other.ID = 0; } // Allow move
+    Shader(Shader&& other) noexcept : ID(other.ID), m_uniformLocations(std::move(other.m_uniformLocations)) { other.ID = 0; } // Allow move
     Shader& operator=(Shader&& other) noexcept {
         if (this != &other) {
             glDeleteProgram(ID);
             ID = other.ID;
+            m_uniformLocations = std::move(other.m_uniformLocations);
             other.ID = 0;
         }
         return *this;
@@ -37,7 +39,24 @@ public:
     // Use/activate the shader
     void Use() const;
 
-    // Utility uniform functions
+    // Location of a uniform reflected at link time, -1 if the program has no such active uniform.
+    // Look locations up once and pass them to the setters below, setting -1 is silently ignored by GL.
+    int GetUniformLocation(const std::string& name) const;
+    // Bind a uniform block to a uniform buffer binding point, returns false if the block does not exist
+    bool BindUniformBlock(const char* blockName, unsigned int bindingPoint) const;
+
+    // Uniform setters taking precomputed locations
+    void SetBool(int location, bool value) const;
+    void SetInt(int location, int value) const;
+    void SetFloat(int location, float value) const;
+    void SetVec2(int location, const glm::vec2& value) const;
+    void SetVec3(int location, const glm::vec3& value) const;
+    void SetVec3Array(int location, const glm::vec3* values, int count) const;
+    void SetVec4(int location, const glm::vec4& value) const;
+    void SetMat3(int location, const glm::mat3& mat) const;
+    void SetMat4(int location, const glm::mat4& mat) const;
+
+    // Utility uniform functions, these look the name up in the location table on every call
     void SetBool(const std::string& name, bool value) const;
     void SetInt(const std::string& name, int value) const;
     void SetFloat(const std::string& name, float value) const;
@@ -54,4 +73,8 @@ public:
 private:
     // Utility function for checking shader compilation/linking errors.
     void checkCompileErrors(GLuint shader, std::string type);
+    // Fill the location table with every active uniform outside a uniform block
+    void reflectUniforms();
+
+    std::unordered_map<std::string, int> m_uniformLocations;
 };
\ No newline at end of file
@@ -41,7 +41,7 @@ Window::Window(int width, int height, const char* title)
 	glfwSetFramebufferSizeCallback(m_nativeWindow, FramebufferSizeCallback);
 
 	MakeContextCurrent();
-	glfwSwapInterval(1); // Enable V-Sync
+	// the swap interval is left to FramePacer, which owns the pacing mode
 }
 
 Window::~Window() {
@@ -65,4 +65,12 @@ bool Window::ShouldClose() const {
 
 void Window::SwapBuffers() const {
 	glfwSwapBuffers(m_nativeWindow);
+}
+
+void Window::SetSwapInterval(int interval) const {
+	glfwSwapInterval(interval); // applies to the current context, which is this window's
+}
+
+bool Window::SupportsAdaptiveVsync() const {
+	return glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
 }
\ No newline at end of file
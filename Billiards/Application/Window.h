@@ -19,6 +19,9 @@ public:
     bool ShouldClose() const;
     void SwapBuffers() const;
     void MakeContextCurrent() const;
+    // vblanks to wait per swap, -1 for adaptive vsync, see FramePacer
+    void SetSwapInterval(int interval) const;
+    bool SupportsAdaptiveVsync() const;
 
     GLFWwindow* GetNativeHandle() const { return m_nativeWindow; }
     int GetWidth() const { return m_width; }
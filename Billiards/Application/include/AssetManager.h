@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Model.h"
+#include "RailGeometry.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+
+constexpr std::uint32_t c_INVALID_ASSET = 0xFFFFFFFF;
+
+struct ModelHandle
+{
+    std::uint32_t index = c_INVALID_ASSET;
+    bool IsValid() const { return index != c_INVALID_ASSET; }
+};
+
+struct TextureHandle
+{
+    std::uint32_t index = c_INVALID_ASSET;
+    bool IsValid() const { return index != c_INVALID_ASSET; }
+};
+
+enum class AssetState : std::uint8_t
+{
+    Loading,   // read and decoded on a loader thread
+    Uploading, // in CPU memory, waiting for its turn on the GL thread
+    Ready,
+    Failed     // the placeholder stays in place
+};
+
+// Streams models and textures in the background.
+// Load calls return a handle at once and queue the file on the loader threads, which decode it into CPU
+// buffers. Update, called once per frame on the GL thread, moves finished assets to the GPU until the frame's
+// upload budget is spent, textures through a small ring of pixel unpack buffers. Until an asset is ready the
+// getters hand out placeholder geometry and a white texture, so nothing waits on the files.
+class AssetManager
+{
+public:
+    // needs a current GL context for the placeholders
+    explicit AssetManager(unsigned threadCount = 1);
+    ~AssetManager();
+
+    AssetManager(const AssetManager&) = delete;
+    AssetManager& operator=(const AssetManager&) = delete;
+    AssetManager(AssetManager&&) = delete;
+    AssetManager& operator=(AssetManager&&) = delete;
+
+    // loading the same path twice returns the same handle
+    ModelHandle LoadModel(const std::string& path);
+    TextureHandle LoadTexture(const std::string& path);
+
+    // GL thread, once per frame, uploads at least one item even if it is larger than the budget
+    void Update();
+    // block until every queued asset is decoded and uploaded, for runs that need complete frames
+    void Finish();
+
+    void SetUploadBudget(std::size_t bytesPerFrame) { m_uploadBudget = bytesPerFrame; }
+
+    AssetState GetState(ModelHandle handle) const;
+    AssetState GetState(TextureHandle handle) const;
+    // the loaded asset, or the placeholder while it is loading or if it failed
+    const Model& GetModel(ModelHandle handle) const;
+    const Texture& GetTexture(TextureHandle handle) const;
+    // cushions baked from a model on its loader thread, null until it is decoded or if it has none
+    std::shared_ptr<const RailGeometry> GetRailGeometry(ModelHandle handle) const;
+
+    // assets that are not ready or failed yet
+    int GetPendingCount() const { return m_pendingCount; }
+
+private:
+    static constexpr std::size_t c_DEFAULT_UPLOAD_BUDGET = 4 << 20; // bytes per frame
+    static constexpr int c_PIXEL_BUFFER_COUNT = 3; // a buffer is reused two uploads later, by then the copy is done
+
+    enum class AssetType : std::uint8_t { Model, Texture };
+
+    struct ModelSlot
+    {
+        std::string path;
+        AssetState state = AssetState::Loading;
+        std::vector<MeshData> staging;
+        std::vector<Mesh> meshes; // uploaded so far, a model can take several frames
+        std::unique_ptr<Model> model;
+        std::shared_ptr<const RailGeometry> rails;
+    };
+
+    struct TextureSlot
+    {
+        std::string path;
+        AssetState state = AssetState::Loading;
+        TextureData staging;
+        Texture texture;
+    };
+
+    // result handed from a loader thread to the GL thread
+    struct LoadResult
+    {
+        AssetType type;
+        std::uint32_t index;
+        bool succeeded;
+        std::vector<MeshData> meshes;
+        TextureData image;
+        std::shared_ptr<const RailGeometry> rails;
+    };
+
+    struct Upload
+    {
+        AssetType type;
+        std::uint32_t index;
+    };
+
+    void CollectResults();
+    // upload the next piece of the front of the queue, returns the bytes sent
+    std::size_t UploadNext();
+    std::size_t UploadModelMesh(ModelSlot& slot);
+    std::size_t UploadTexture(TextureSlot& slot);
+    void Finished(AssetState& state, AssetState result, const std::string& path);
+    void PushResult(LoadResult&& result);
+
+    std::vector<std::unique_ptr<ModelSlot>> m_models;
+    std::vector<std::unique_ptr<TextureSlot>> m_textures;
+    std::unordered_map<std::string, std::uint32_t> m_modelIndices;
+    std::unordered_map<std::string, std::uint32_t> m_textureIndices;
+    std::deque<Upload> m_uploads;
+    std::size_t m_uploadBudget = c_DEFAULT_UPLOAD_BUDGET;
+    int m_pendingCount = 0;
+
+    std::unique_ptr<Model> m_placeholderModel;
+    Texture m_placeholderTexture;
+    GLuint m_pixelBuffers[c_PIXEL_BUFFER_COUNT] = {};
+    int m_nextPixelBuffer = 0;
+
+    std::mutex m_resultMutex;
+    std::vector<LoadResult> m_results; // written by the loader threads
+    std::atomic<bool> m_stopping{ false };
+
+    // last, so the loader threads are joined before anything they touch goes away
+    ThreadPool m_loaders;
+};
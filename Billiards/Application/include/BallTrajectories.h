@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+
+#include "PhysicsConstants.h"
+
+enum class BallState : std::uint8_t;
+class PhysicsWorld;
+struct PhysicsSnapshot;
+
+// Closed form motion of every ball until its next collision.
+// Without collisions a ball slides with constant deceleration against its contact point velocity, rolls with
+// constant deceleration against its velocity and then spins in place until the spin has decayed, so its
+// position is a quadratic in time per phase. Build turns the current state into up to c_MAX_SEGMENTS of
+// those phases per ball, after which any time is a lookup among at most four segments and a polynomial
+// evaluation, without stepping. The result holds until the first cushion, pocket or ball contact, which
+// whoever built it records with SetValidUntil.
+class BallTrajectories
+{
+public:
+    static constexpr int c_MAX_SEGMENTS = 4; // sliding, rolling, spinning, at rest
+
+    struct Sample
+    {
+        float posX, posY;
+        float velX, velY;
+        float angX, angY, angZ;
+        BallState state;
+    };
+
+    // every ball of the world starting at time, the world's own time by default
+    void Build(const PhysicsWorld& world);
+    void Build(const PhysicsWorld& world, double time);
+    // one ball after an event changed its motion
+    void Rebuild(const PhysicsWorld& world, int ball, double time);
+
+    // times before the start of the trajectory are clamped to it
+    void Evaluate(int ball, double time, Sample& out) const;
+    // the ball arrays, time and rest state of out for every ball
+    void Evaluate(double time, PhysicsSnapshot& out) const;
+
+    int GetBallCount() const { return m_ballCount; }
+    double GetStartTime(int ball) const { return m_segments[ball][0].start; }
+    // when the ball stops moving and spinning
+    double GetRestTime(int ball) const;
+    // the latest rest time of all balls
+    double GetRestTime() const;
+
+    double GetValidUntil() const { return m_validUntil; }
+    void SetValidUntil(double time) { m_validUntil = time; }
+
+private:
+    struct Segment
+    {
+        double start = 0.0;  // absolute time
+        double px = 0.0, py = 0.0;
+        double vx = 0.0, vy = 0.0;
+        double ax = 0.0, ay = 0.0;
+        double angX = 0.0, angY = 0.0; // at the start, grow linearly with the friction torque while sliding
+        BallState state{};
+    };
+
+    Segment m_segments[c_BALL_COUNT][c_MAX_SEGMENTS];
+    std::uint8_t m_segmentCounts[c_BALL_COUNT] = {};
+    // spin around the vertical axis decays linearly in every phase
+    double m_spin[c_BALL_COUNT] = {};
+    int m_ballCount = 0;
+    double m_validUntil = 0.0;
+};
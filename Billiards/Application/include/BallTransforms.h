@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct PhysicsSnapshot;
+
+// Render transforms of every ball, derived from a snapshot of the physics world.
+// Orientations are integrated from the angular velocities, and the matrices are rebuilt only for balls that
+// moved since the last update. The dirty balls are gathered into structure of arrays blocks of four and
+// their matrices are built four at a time with SSE.
+class BallTransforms
+{
+public:
+    // integrate the orientations over deltaTime and rebuild the matrices of the balls that moved
+    void Update(const PhysicsSnapshot& snapshot, float deltaTime);
+
+    int GetBallCount() const { return static_cast<int>(m_matrices.size()); }
+    const glm::mat4& GetTransform(int ball) const { return m_matrices[ball]; }
+    // number of matrices rebuilt by the last update
+    int GetRebuiltCount() const { return m_rebuiltCount; }
+
+private:
+    void Resize(int ballCount);
+    void BuildMatrices(int count);
+    void BuildMatricesScalar(int count);
+
+    // orientation quaternions, structure of arrays like the physics state
+    std::vector<float> m_rotW, m_rotX, m_rotY, m_rotZ;
+    std::vector<float> m_lastX, m_lastY; // positions the matrices were built from
+    std::vector<glm::mat4> m_matrices;
+
+    // balls to rebuild this update, with their data gathered into contiguous blocks
+    std::vector<int> m_dirty;
+    std::vector<float> m_gatherX, m_gatherY, m_gatherW, m_gatherQx, m_gatherQy, m_gatherQz;
+    int m_rebuiltCount = 0;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "PhysicsWorld.h"
+#include "ThreadPool.h"
+
+// one shot to simulate: a cue shot played on one of the input tables
+struct ShotRequest
+{
+    int table = 0; // index into the table states handed to Simulate
+    int ball = 0;  // ball struck by the cue
+    CueShot shot;
+};
+
+struct ShotResult
+{
+    TableState finalState;
+    float duration = 0.0f;   // simulated seconds until the table came to rest
+    std::uint32_t events = 0; // events resolved, only counted by the event-driven solver
+};
+
+// Headless simulator for large batches of shots.
+// Shots are sharded over a work-stealing thread pool. Every worker owns a physics world that it reuses
+// for all of its shots, so no memory is allocated once the worlds have grown to table size.
+class BatchSimulator
+{
+public:
+    explicit BatchSimulator(unsigned threadCount = 0); // 0 uses every hardware thread
+    ~BatchSimulator() = default;
+
+    BatchSimulator(const BatchSimulator&) = delete;
+    BatchSimulator& operator=(const BatchSimulator&) = delete;
+    BatchSimulator(BatchSimulator&&) = delete;
+    BatchSimulator& operator=(BatchSimulator&&) = delete;
+
+    void SetSolverMode(SolverMode mode) { m_solverMode = mode; }
+    void SetMaxShotTime(float seconds) { m_maxShotTime = seconds; }
+    // baked cushions every worker plays against, shared read-only; null for the box cushions
+    void SetRailGeometry(std::shared_ptr<const RailGeometry> rails) { m_rails = std::move(rails); }
+    int GetWorkerCount() const { return m_pool.GetWorkerCount(); }
+
+    // simulate every shot until the table rests, results[k] belongs to shots[k]
+    std::vector<ShotResult> Simulate(const std::vector<TableState>& tables, const std::vector<ShotRequest>& shots);
+    void Simulate(const TableState* tables, const ShotRequest* shots, int shotCount, ShotResult* results);
+
+private:
+    // padded to a cache line so workers never write to the same line
+    struct alignas(64) WorkerArena
+    {
+        PhysicsWorld world;
+    };
+
+    ThreadPool m_pool;
+    std::vector<WorkerArena> m_arenas;
+    SolverMode m_solverMode = SolverMode::EventDriven;
+    float m_maxShotTime = 60.0f;
+    std::shared_ptr<const RailGeometry> m_rails;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+// Axis aligned box, the bounding volume of meshes and models.
+// A default constructed box is empty, extending it with the first point makes it that point.
+struct BoundingBox
+{
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    bool IsEmpty() const { return min.x > max.x; }
+    glm::vec3 GetCenter() const { return (min + max) * 0.5f; }
+    glm::vec3 GetExtent() const { return (max - min) * 0.5f; }
+
+    void Extend(const glm::vec3& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void Extend(const BoundingBox& box)
+    {
+        if (box.IsEmpty())
+            return;
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+
+    bool Contains(const glm::vec3& point) const
+    {
+        return point.x >= min.x && point.y >= min.y && point.z >= min.z
+            && point.x <= max.x && point.y <= max.y && point.z <= max.z;
+    }
+
+    // the box around this box after an affine transform, the centre is transformed and the extent is
+    // projected onto the world axes through the absolute values of the linear part
+    BoundingBox Transformed(const glm::mat4& transform) const
+    {
+        if (IsEmpty())
+            return *this;
+
+        const glm::vec3 center = glm::vec3(transform * glm::vec4(GetCenter(), 1.0f));
+        const glm::vec3 extent = GetExtent();
+        glm::vec3 worldExtent(0.0f);
+        for (int column = 0; column < 3; column++)
+        {
+            const glm::vec3 axis = glm::vec3(transform[column]);
+            worldExtent += glm::vec3(std::abs(axis.x), std::abs(axis.y), std::abs(axis.z)) * extent[column];
+        }
+
+        BoundingBox box;
+        box.min = center - worldExtent;
+        box.max = center + worldExtent;
+        return box;
+    }
+};
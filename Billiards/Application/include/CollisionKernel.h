@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+// instruction set used by the narrowphase
+enum class KernelPath : std::uint8_t
+{
+    Scalar, // reference implementation
+    Sse,    // 4 pairs per instruction, two groups per block of 8
+    Avx2    // 8 pairs per instruction with gathers
+};
+
+// Narrowphase for ball-ball collisions on the structure of arrays ball state.
+// Every path computes dx * dx + dy * dy < distance^2 with the same single precision operations and
+// no fused multiply-add, so all of them report exactly the same pairs as the scalar reference.
+class CollisionKernel
+{
+public:
+    CollisionKernel() = delete;
+    ~CollisionKernel() = delete;
+
+    // fastest path the running CPU supports
+    static KernelPath GetBestPath();
+    static const char* GetPathName(KernelPath path);
+
+    // test the candidate pairs (pairA[k], pairB[k]) for overlap and write the k of every overlapping pair
+    // to outIndices, in increasing order. Returns the number of overlaps written.
+    static int FindOverlaps(KernelPath path, const float* posX, const float* posY,
+                            const int* pairA, const int* pairB, int pairCount,
+                            float distance, int* outIndices);
+
+private:
+    static int FindOverlapsScalar(const float* posX, const float* posY, const int* pairA, const int* pairB,
+                                  int begin, int end, float distanceSq, int* outIndices);
+    static int FindOverlapsSse(const float* posX, const float* posY, const int* pairA, const int* pairB,
+                               int pairCount, float distanceSq, int* outIndices);
+    static int FindOverlapsAvx2(const float* posX, const float* posY, const int* pairA, const int* pairB,
+                                int pairCount, float distanceSq, int* outIndices);
+};
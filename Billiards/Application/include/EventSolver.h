@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "BallTrajectories.h"
+
+class PhysicsWorld;
+
+enum class EventType : std::uint8_t
+{
+    None,
+    Transition, // sliding -> rolling -> spinning -> stationary
+    BallBall,
+    Cushion,
+    Rail, // baked cushion of a table model
+    Pocket
+};
+
+struct PhysicsEvent
+{
+    EventType type = EventType::None;
+    double time = 0.0; // absolute simulation time
+    int ball = -1;
+    int other = -1; // second ball, cushion axis (0 = x, 1 = y), rail primitive or pocket index, depending on type
+};
+
+// Event-driven solver for PhysicsWorld.
+// Between events every ball moves with constant acceleration, so its position is a quadratic in time.
+// The solver predicts the time of the next transition, ball-ball, cushion and pocket event analytically
+// and jumps straight to it. Predictions are cached and only the ones involving balls touched by an
+// event are recomputed.
+class EventSolver
+{
+public:
+    // advance the world by deltaTime, resolving every event inside the interval, returns the event count
+    int Advance(PhysicsWorld& world, float deltaTime);
+    // resolve events until every ball is at rest or maxTime has passed, returns the event count
+    int AdvanceUntilRest(PhysicsWorld& world, float maxTime);
+
+    std::uint64_t GetEventCount() const { return m_eventCount; }
+    // closed form motion from the last collision on, valid until the next predicted one
+    const BallTrajectories& GetTrajectories() const { return m_trajectories; }
+    // false if the world changed since the last Advance, then the trajectories are stale
+    bool IsCurrent(const PhysicsWorld& world) const;
+
+private:
+    void Rebuild(const PhysicsWorld& world);
+    void PredictBall(const PhysicsWorld& world, int ball); // transition, cushion and pocket events
+    void PredictPair(const PhysicsWorld& world, int a, int b);
+    void PredictAllPairs(const PhysicsWorld& world, int ball);
+    PhysicsEvent NextEvent() const;
+    double NextCollisionTime() const; // cushion, pocket or ball, transitions are part of the trajectories
+    void AdvanceTo(PhysicsWorld& world, double time);
+    void Resolve(PhysicsWorld& world, const PhysicsEvent& event);
+    int Run(PhysicsWorld& world, double endTime, bool stopAtRest);
+
+    int m_ballCount = 0;
+    double m_now = 0.0;
+    std::uint32_t m_revision = 0;
+    bool m_valid = false;
+    std::uint64_t m_eventCount = 0;
+
+    // cached predictions, absolute times
+    std::vector<double> m_transitionTimes;   // per ball
+    std::vector<PhysicsEvent> m_boundEvents; // per ball, earliest cushion or pocket event
+    std::vector<double> m_pairTimes;         // m_ballCount * m_ballCount, only entries a < b are used
+
+    // rebuilt for the balls a collision touched, transitions need no rebuild
+    BallTrajectories m_trajectories;
+    std::vector<int> m_railCandidates; // scratch for PredictBall
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+class Window;
+
+enum class PacingMode : std::uint8_t
+{
+    Uncapped,      // no swap interval and no waiting, for measuring render cost
+    AdaptiveVsync, // wait for vblank unless the frame is late, then swap right away instead of halving the rate
+    FixedRate      // no swap interval, the pacer sleeps until the next frame of the target rate
+};
+
+// Paces the windowed main loop and records frame time statistics.
+// BeginFrame starts a frame and returns the time since the last one, EndFrame goes after the buffer swap and
+// waits out the rest of the frame in fixed rate mode. The wait sleeps in 1 ms steps for as long as the
+// measured sleep overshoot allows and spins the remainder, so it stays precise with coarse OS timers.
+class FramePacer
+{
+public:
+    // over the last c_HISTORY_SIZE frames, in milliseconds
+    struct Stats
+    {
+        int frames = 0;
+        float averageFrameTime = 0.0f;
+        float minFrameTime = 0.0f;
+        float maxFrameTime = 0.0f;
+        float percentile99FrameTime = 0.0f;
+        float averageWorkTime = 0.0f; // BeginFrame to EndFrame, without the pacing wait
+    };
+
+    static constexpr int c_HISTORY_SIZE = 240;
+
+    FramePacer(Window* window, PacingMode mode, double targetRate);
+
+    void SetMode(PacingMode mode);
+    void SetTargetRate(double rate);
+    PacingMode GetMode() const { return m_mode; }
+    double GetTargetRate() const { return m_targetRate; }
+    // false if the driver has no tear control, AdaptiveVsync then falls back to plain vsync
+    bool HasAdaptiveVsync() const { return m_adaptiveVsync; }
+
+    // seconds since the previous BeginFrame, 0 for the first frame
+    float BeginFrame();
+    void EndFrame();
+
+    Stats GetStats() const;
+
+    static const char* GetModeName(PacingMode mode);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void ApplySwapInterval() const;
+    void WaitUntil(Clock::time_point deadline);
+
+    Window* m_window;
+    PacingMode m_mode;
+    double m_targetRate;
+    bool m_adaptiveVsync = false;
+
+    Clock::time_point m_frameStart;
+    Clock::time_point m_nextDeadline;
+    bool m_started = false;
+
+    // running estimate of how long a 1 ms sleep really takes, mean plus one standard deviation
+    double m_sleepEstimate = 0.005;
+    double m_sleepMean = 0.005;
+    double m_sleepM2 = 0.0;
+    std::int64_t m_sleepCount = 1;
+
+    // ring buffers in milliseconds
+    std::vector<float> m_frameTimes;
+    std::vector<float> m_workTimes;
+    int m_historyNext = 0;
+    int m_historyCount = 0;
+};
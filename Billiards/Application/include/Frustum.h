@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+struct BoundingBox;
+
+// The six clip planes of a view-projection matrix, for culling bounding volumes before they are drawn.
+// Planes are stored as structure of arrays and volumes are passed the same way, so the tests run on four
+// volumes at a time with SSE. Tests are conservative: a volume outside the frustum but crossing two planes
+// near a corner can be kept, a visible one is never dropped.
+class Frustum
+{
+public:
+    static constexpr int c_PLANE_COUNT = 6;
+
+    // extract the planes from the rows of the matrix, normalised so distances are in world units
+    void Update(const glm::mat4& viewProjection);
+
+    // boxes given as centres and half extents, outVisible[i] is 1 if box i is at least partly inside, 0 if not
+    void CullBoxes(const float* centerX, const float* centerY, const float* centerZ,
+                   const float* extentX, const float* extentY, const float* extentZ,
+                   int count, std::uint8_t* outVisible) const;
+    // spheres given as centres and radii, same output as CullBoxes
+    void CullSpheres(const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+                     int count, std::uint8_t* outVisible) const;
+
+    bool IsVisible(const BoundingBox& box) const;
+
+private:
+    void CullBoxesScalar(const float* centerX, const float* centerY, const float* centerZ,
+                         const float* extentX, const float* extentY, const float* extentZ,
+                         int begin, int count, std::uint8_t* outVisible) const;
+    void CullSpheresScalar(const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+                           int begin, int count, std::uint8_t* outVisible) const;
+
+    // a x + b y + c z + d >= 0 inside every plane, the planes start out accepting everything
+    float m_a[c_PLANE_COUNT] = {};
+    float m_b[c_PLANE_COUNT] = {};
+    float m_c[c_PLANE_COUNT] = {};
+    float m_d[c_PLANE_COUNT] = { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+};
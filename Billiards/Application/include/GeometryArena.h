@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glad/gl.h>
+
+struct PackedVertex;
+class Mesh;
+
+// Shared vertex and index storage for every static mesh.
+// Meshes suballocate a vertex range and an index range out of one large vertex buffer and one large index
+// buffer. Indices are relative to the first vertex of their mesh and drawn with a base vertex, so 16 bit
+// indices keep working however large the arena grows. Two VAOs share the buffers: one for plain draws and one
+// that InstanceBuffer attaches its per-instance arrays to, so a whole frame binds at most two vertex arrays.
+class GeometryArena
+{
+public:
+    struct Allocation
+    {
+        GLint baseVertex = -1;
+        GLsizei vertexCount = 0;
+        std::size_t indexOffset = 0; // in bytes
+        GLsizei indexCount = 0;
+        GLenum indexType = GL_UNSIGNED_INT;
+
+        bool IsValid() const { return baseVertex >= 0; }
+        // first index in units of the index type, as used by indirect draw commands
+        GLuint GetFirstIndex() const;
+    };
+
+    // the arena lives from after GL is loaded until every mesh is destroyed
+    static void Initialize();
+    static void Shutdown();
+    static bool IsInitialized() { return s_instance != nullptr; }
+    static GeometryArena& Get() { return *s_instance; }
+
+    ~GeometryArena();
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+    GeometryArena(GeometryArena&&) = delete;
+    GeometryArena& operator=(GeometryArena&&) = delete;
+
+    // reserve space for a mesh, the buffers grow when they run out
+    Allocation Allocate(GLsizei vertexCount, GLsizei indexCount, GLenum indexType);
+    void Free(const Allocation& allocation);
+    // fill an allocation, indices are converted to the allocation's index type
+    void Write(const Allocation& allocation, const PackedVertex* vertices, const GLsizei* indices);
+
+    void BindVertexArray() const { glBindVertexArray(m_vertexArrays[0]); }
+    void BindInstancedVertexArray() const { glBindVertexArray(m_vertexArrays[1]); }
+
+    std::size_t GetVertexBytesUsed() const { return m_vertexRanges.GetUsed(); }
+    std::size_t GetIndexBytesUsed() const { return m_indexRanges.GetUsed(); }
+
+private:
+    static constexpr std::size_t c_INITIAL_VERTEX_BYTES = 4 << 20;
+    static constexpr std::size_t c_INITIAL_INDEX_BYTES = 2 << 20;
+
+    // first fit allocator over byte ranges of a buffer, free neighbours are merged
+    class RangeAllocator
+    {
+    public:
+        explicit RangeAllocator(std::size_t capacity);
+
+        bool Allocate(std::size_t size, std::size_t alignment, std::size_t& outOffset);
+        void Free(std::size_t offset, std::size_t size);
+        // the new space is appended as a free range
+        void Grow(std::size_t capacity);
+
+        std::size_t GetCapacity() const { return m_capacity; }
+        std::size_t GetUsed() const { return m_used; }
+
+    private:
+        struct Range
+        {
+            std::size_t offset;
+            std::size_t size;
+        };
+
+        std::vector<Range> m_free; // sorted by offset
+        std::size_t m_capacity;
+        std::size_t m_used = 0;
+    };
+
+    GeometryArena();
+
+    void Allocate(RangeAllocator& ranges, GLuint& buffer, std::size_t size, std::size_t alignment, std::size_t& outOffset);
+    void SetupVertexArrays() const;
+
+    static std::unique_ptr<GeometryArena> s_instance;
+
+    GLuint m_vertexArrays[2] = {}; // plain and instanced
+    GLuint m_vertexBuffer = 0;
+    GLuint m_indexBuffer = 0;
+    RangeAllocator m_vertexRanges;
+    RangeAllocator m_indexRanges;
+};
+
+// Draw commands for a fixed set of arena meshes, submitted with one multi-draw per index type.
+// With GL 4.3 the commands live in an indirect buffer, older contexts pass the same data to
+// glMultiDrawElementsBaseVertex.
+class DrawBatch
+{
+public:
+    DrawBatch() = default;
+    explicit DrawBatch(const std::vector<Mesh>& meshes);
+    ~DrawBatch();
+
+    DrawBatch(const DrawBatch&) = delete;
+    DrawBatch& operator=(const DrawBatch&) = delete;
+    DrawBatch(DrawBatch&& batch) noexcept;
+    DrawBatch& operator=(DrawBatch&& batch) noexcept;
+
+    void Draw() const;
+    // the multi-draws alone, for callers that already bound the arena's plain VAO
+    void Submit() const;
+    // like Submit, but only the meshes whose entry in meshVisible is non-zero, indexed like the mesh vector
+    // the batch was built from, returns the draw calls issued
+    int SubmitVisible(const std::uint8_t* meshVisible) const;
+
+    // draw calls Draw issues, for statistics
+    int GetCallCount() const;
+
+private:
+    // layout of DrawElementsIndirectCommand in the GL spec
+    struct IndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    struct Group
+    {
+        GLenum indexType;
+        std::vector<GLsizei> counts;
+        std::vector<const void*> offsets;
+        std::vector<GLint> baseVertices;
+        std::vector<int> meshes; // index of each command's mesh in the vector the batch was built from
+        std::size_t indirectOffset = 0; // in bytes
+    };
+
+    std::vector<Group> m_groups;
+    GLuint m_indirectBuffer = 0;
+
+    // compacted commands of SubmitVisible, kept to reuse their storage
+    mutable std::vector<GLsizei> m_visibleCounts;
+    mutable std::vector<const void*> m_visibleOffsets;
+    mutable std::vector<GLint> m_visibleBaseVertices;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+// vertex attribute locations of the per-instance data in model.vert
+constexpr GLuint c_INSTANCE_TRANSFORM_LOCATION = 3; // mat4, occupies locations 3 to 6
+constexpr GLuint c_INSTANCE_BALL_ID_LOCATION = 7;
+constexpr GLuint c_INSTANCE_NORMAL_LOCATION = 8; // mat3, occupies locations 8 to 10
+// ball id of objects that are not balls, the fragment shader uses objectColor for them
+constexpr std::uint32_t c_NO_BALL_ID = 0xFFFFFFFFu;
+
+// per-instance data read by model.vert, 128 bytes
+struct BallInstance
+{
+    glm::mat4 transform = glm::mat4(1.0f);
+    // inverse transpose of the upper 3x3 of transform, columns padded to vec4
+    glm::vec4 normalMatrix[3] = { glm::vec4(1, 0, 0, 0), glm::vec4(0, 1, 0, 0), glm::vec4(0, 0, 1, 0) };
+    std::uint32_t ballId = c_NO_BALL_ID;
+    std::uint32_t padding[3] = {};
+};
+
+// Per-instance vertex buffer for instanced draws.
+// With GL 4.4 the buffer is persistently mapped and split into c_REGION_COUNT regions used round robin,
+// each guarded by a fence so the CPU never writes a region the GPU is still reading. Older contexts
+// orphan and map the buffer every frame instead.
+class InstanceBuffer
+{
+public:
+    explicit InstanceBuffer(GLsizei capacity);
+    ~InstanceBuffer();
+
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+    InstanceBuffer(InstanceBuffer&&) = delete;
+    InstanceBuffer& operator=(InstanceBuffer&&) = delete;
+
+    // start writing the instances of a new frame, count must not exceed the capacity
+    BallInstance* Map(GLsizei count);
+    void Unmap();
+    // fence the region just drawn from, call once after the last draw that reads it
+    void Fence();
+
+    // point the instance attributes of the bound VAO at the region written by the last Map
+    void BindAttributes() const;
+    // constant instance data for draws of VAOs without instance arrays
+    static void SetSingleInstance(const glm::mat4& transform, const glm::mat3& normalMatrix,
+                                  std::uint32_t ballId = c_NO_BALL_ID);
+
+    GLsizei GetCapacity() const { return m_capacity; }
+    GLsizei GetCount() const { return m_count; }
+    bool IsPersistent() const { return m_persistent != nullptr; }
+
+private:
+    static constexpr int c_REGION_COUNT = 3;
+
+    GLuint m_buffer = 0;
+    GLsizei m_capacity;
+    GLsizei m_count = 0;
+    int m_region = 0;
+    BallInstance* m_persistent = nullptr; // start of the mapping, null without GL 4.4
+    GLsync m_fences[c_REGION_COUNT] = {};
+};
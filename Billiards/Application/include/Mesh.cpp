@@ -1,76 +1,201 @@
 ﻿#include "Mesh.h"
+#include "InstanceBuffer.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    // largest vertex count whose indices still fit in GL_UNSIGNED_SHORT
+    constexpr GLsizei c_MAX_SHORT_INDEX_VERTICES = std::numeric_limits<std::uint16_t>::max() + 1;
+
+    // 1 if dropping the low shift bits of mantissa has to round the kept value up, ties go to even
+    std::uint32_t RoundUp(std::uint32_t mantissa, int shift, std::uint32_t kept)
+    {
+        const std::uint32_t half = 1u << (shift - 1);
+        const std::uint32_t dropped = mantissa & ((1u << shift) - 1);
+        return dropped > half || (dropped == half && (kept & 1)) ? 1 : 0;
+    }
+
+    // IEEE half, rounded to nearest even, values too small for a half subnormal become zero
+    std::uint16_t FloatToHalf(float value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        const std::uint32_t sign = (bits >> 16) & 0x8000;
+        const std::uint32_t floatExponent = (bits >> 23) & 0xFF;
+        std::uint32_t mantissa = bits & 0x7FFFFF;
+
+        if (floatExponent == 0xFF)
+            return static_cast<std::uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0)); // inf or nan
+
+        const int exponent = static_cast<int>(floatExponent) - 127 + 15;
+        if (exponent >= 31)
+            return static_cast<std::uint16_t>(sign | 0x7C00);
+        if (exponent <= 0)
+        {
+            if (exponent < -10)
+                return static_cast<std::uint16_t>(sign);
+            mantissa |= 0x800000;
+            const int shift = 14 - exponent;
+            std::uint32_t half = mantissa >> shift;
+            half += RoundUp(mantissa, shift, half);
+            return static_cast<std::uint16_t>(sign | half);
+        }
+
+        // a carry out of the mantissa correctly bumps the exponent
+        std::uint32_t half = sign | (static_cast<std::uint32_t>(exponent) << 10) | (mantissa >> 13);
+        half += RoundUp(mantissa, 13, half);
+        return static_cast<std::uint16_t>(half);
+    }
+
+    std::int16_t FloatToSnorm16(float value)
+    {
+        const float clamped = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+        return static_cast<std::int16_t>(std::lround(clamped * 32767.0f));
+    }
+}
+
+// the unit sphere is projected onto the octahedron |x| + |y| + |z| = 1, the lower half folded over the upper,
+// model.vert unfolds it again
+PackedVertex PackedVertex::Pack(const Vertex& vertex)
+{
+    PackedVertex packed;
+    packed.position = vertex.position;
+
+    const glm::vec3& n = vertex.normal;
+    const float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    float x = length > 0.0f ? n.x / length : 0.0f;
+    float y = length > 0.0f ? n.y / length : 0.0f;
+    if (length > 0.0f && n.z < 0.0f)
+    {
+        const float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    packed.normal[0] = FloatToSnorm16(x);
+    packed.normal[1] = FloatToSnorm16(y);
+
+    packed.texCoord[0] = FloatToHalf(vertex.texCoord.x);
+    packed.texCoord[1] = FloatToHalf(vertex.texCoord.y);
+    return packed;
+}
 
 // mesh constructor
 Mesh::Mesh(const Vertex* vertices, const GLsizei* indices, const GLsizei vertexCount, const GLsizei indexCount)
+{
+    std::vector<PackedVertex> packed(vertexCount);
+    for (GLsizei i = 0; i < vertexCount; i++)
+        packed[i] = PackedVertex::Pack(vertices[i]);
+    Init(packed.data(), indices, vertexCount, indexCount);
+}
+
+Mesh::Mesh(const PackedVertex* vertices, const GLsizei* indices, const GLsizei vertexCount, const GLsizei indexCount)
 {
     Init(vertices, indices, vertexCount, indexCount);
 }
 
-Mesh::Mesh(Mesh&& mesh) noexcept
+Mesh::Mesh(const MeshView& view)
 {
-    m_VAO = mesh.m_VAO;
-    m_VBO = mesh.m_VBO;
-    m_EBO = mesh.m_EBO;
-    m_vertexCount = mesh.m_vertexCount;
-    m_indexCount = mesh.m_indexCount;
+    Init(view);
+}
 
-    mesh.m_VAO = mesh.m_VBO = mesh.m_EBO = 0;
-    mesh.m_vertexCount = mesh.m_indexCount = 0;
+Mesh::Mesh(Mesh&& mesh) noexcept
+    : m_allocation(mesh.m_allocation), m_bounds(mesh.m_bounds)
+{
+    mesh.m_allocation = GeometryArena::Allocation();
 }
 
 Mesh& Mesh::operator=(Mesh&& mesh) noexcept
 {
     if (this != &mesh)
     {
-        m_VAO = mesh.m_VAO;
-        m_VBO = mesh.m_VBO;
-        m_EBO = mesh.m_EBO;
-        m_vertexCount = mesh.m_vertexCount;
-        m_indexCount = mesh.m_indexCount;
-
-        mesh.m_VAO = mesh.m_VBO = mesh.m_EBO = 0;
-        mesh.m_vertexCount = mesh.m_indexCount = 0;
+        Cleanup();
+        m_allocation = mesh.m_allocation;
+        m_bounds = mesh.m_bounds;
+        mesh.m_allocation = GeometryArena::Allocation();
     }
     return *this;
 }
 
-void Mesh::Init(const Vertex* vertices, const GLsizei* indices, const GLsizei vertexCount, const GLsizei indexCount)
+void Mesh::Init(const PackedVertex* vertices, const GLsizei* indices, const GLsizei vertexCount, const GLsizei indexCount)
+{
+    Init({ vertices, indices, vertexCount, indexCount, BoundingBox() });
+}
+
+void Mesh::Init(const MeshView& view)
 {
-    m_vertexCount = vertexCount;
-    m_indexCount = indexCount;
+    Cleanup();
+    const GLsizei vertexCount = view.vertexCount;
+    m_bounds = view.bounds.IsEmpty() ? ComputeBounds(view.vertices, vertexCount) : view.bounds;
 
-    // create VAO
-    glGenVertexArrays(1, &m_VAO);
-    glBindVertexArray(m_VAO);
+    // indices are relative to the mesh's base vertex, so small meshes get 16 bit indices wherever they land
+    GeometryArena& arena = GeometryArena::Get();
+    const GLenum indexType = vertexCount <= c_MAX_SHORT_INDEX_VERTICES ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    m_allocation = arena.Allocate(vertexCount, view.indexCount, indexType);
+    arena.Write(m_allocation, view.vertices, view.indices);
+}
 
-    // create vertex buffer
-    glGenBuffers(1, &m_VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);
+std::vector<Mesh> Mesh::CreateBatch(const std::vector<MeshView>& views)
+{
+    std::vector<Mesh> meshes(views.size());
+    for (size_t i = 0; i < views.size(); i++)
+        meshes[i].Init(views[i]);
+    return meshes;
+}
 
-    // create index buffer
-    glGenBuffers(1, &m_EBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(GLsizei), indices, GL_STATIC_DRAW);
+void Mesh::Cleanup()
+{
+    if (m_allocation.IsValid() && GeometryArena::IsInitialized())
+        GeometryArena::Get().Free(m_allocation);
+    m_allocation = GeometryArena::Allocation();
+}
 
-    // vertex attributes
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
-    
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+BoundingBox Mesh::ComputeBounds(const PackedVertex* vertices, GLsizei vertexCount)
+{
+    BoundingBox bounds;
+    for (GLsizei i = 0; i < vertexCount; i++)
+        bounds.Extend(vertices[i].position);
+    return bounds;
+}
 
-    glBindVertexArray(0); // unbind VAO for now
+std::size_t Mesh::GetMemorySize() const
+{
+    const std::size_t indexSize = m_allocation.indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(GLsizei);
+    return m_allocation.vertexCount * sizeof(PackedVertex) + m_allocation.indexCount * indexSize;
 }
 
 // draw function assuming the shader is set outside the mesh
 void Mesh::Draw() const
 {
-    glBindVertexArray(m_VAO);
-    glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    if (!m_allocation.IsValid())
+        return;
+
+    GeometryArena::Get().BindVertexArray();
+    glDrawElementsBaseVertex(GL_TRIANGLES, m_allocation.indexCount, m_allocation.indexType,
+                             reinterpret_cast<const void*>(m_allocation.indexOffset), m_allocation.baseVertex);
+}
+
+void Mesh::DrawInstanced(const InstanceBuffer& instances) const
+{
+    if (!m_allocation.IsValid() || instances.GetCount() == 0)
+        return;
+
+    // the instance arrays live on the arena's second VAO, so plain draws never see them
+    GeometryArena::Get().BindInstancedVertexArray();
+    instances.BindAttributes();
+    SubmitInstanced(instances.GetCount());
 }
 
+void Mesh::SubmitInstanced(GLsizei instanceCount) const
+{
+    if (!m_allocation.IsValid())
+        return;
+
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, m_allocation.indexCount, m_allocation.indexType,
+                                      reinterpret_cast<const void*>(m_allocation.indexOffset), instanceCount,
+                                      m_allocation.baseVertex);
+}
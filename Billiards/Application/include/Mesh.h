@@ -1,9 +1,18 @@
 ﻿#pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include <glad/gl.h>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
+#include "BoundingBox.h"
+#include "GeometryArena.h"
+
+class InstanceBuffer;
+
+// full precision vertex, what procedural meshes and the importer build
 struct Vertex
 {
     glm::vec3 position;
@@ -11,11 +20,50 @@ struct Vertex
     glm::vec3 normal;
 };
 
+// the vertex as stored in the mesh cache and on the GPU, 20 bytes instead of 32
+// the normal is octahedral encoded into two snorm16 values, the texture coordinates are half floats
+struct PackedVertex
+{
+    glm::vec3 position;
+    std::int16_t normal[2];
+    std::uint16_t texCoord[2];
+
+    static PackedVertex Pack(const Vertex& vertex);
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed");
+
+// geometry owned elsewhere (staging buffers, mapped files) handed to a batched upload
+struct MeshView
+{
+    const PackedVertex* vertices = nullptr;
+    const GLsizei* indices = nullptr;
+    GLsizei vertexCount = 0;
+    GLsizei indexCount = 0;
+    BoundingBox bounds; // object space, empty means unknown and Mesh computes it from the vertices
+};
+
+// CPU side geometry of one mesh, produced by the loaders before the GL upload
+struct MeshData
+{
+    std::vector<PackedVertex> vertices;
+    std::vector<GLsizei> indices;
+    BoundingBox bounds; // object space, filled in by the loaders together with the vertices
+
+    MeshView GetView() const
+    {
+        return { vertices.data(), indices.data(), static_cast<GLsizei>(vertices.size()), static_cast<GLsizei>(indices.size()), bounds };
+    }
+};
+
+// Handle to a vertex and index range in the GeometryArena.
+// The mesh owns its range and returns it to the arena when destroyed, it has no GL objects of its own.
 class Mesh
 {
 public:
     Mesh() = default;
     Mesh(const Vertex* vertices, const GLsizei* indices, const GLsizei vertexCount, const GLsizei indexCount);
+    Mesh(const PackedVertex* vertices, const GLsizei* indices, const GLsizei vertexCount, const GLsizei indexCount);
+    explicit Mesh(const MeshView& view);
     ~Mesh()
     {
         Cleanup();
@@ -27,23 +75,27 @@ public:
     Mesh(Mesh&& mesh)noexcept;
     Mesh& operator=(Mesh&& mesh)noexcept;
 
-    void Init(const Vertex* vertices, const GLsizei* indices, const GLsizei vertexCount, const GLsizei indexCount);
+    void Init(const PackedVertex* vertices, const GLsizei* indices, const GLsizei vertexCount, const GLsizei indexCount);
+    // as above, with bounds already known from the loader or the mesh cache
+    void Init(const MeshView& view);
+    // upload many meshes at once on the GL thread
+    static std::vector<Mesh> CreateBatch(const std::vector<MeshView>& views);
     void Draw()const;
+    // one draw for every instance written to the buffer
+    void DrawInstanced(const InstanceBuffer& instances)const;
+    // the instanced draw alone, the arena's instanced VAO and the instance attributes must already be bound
+    void SubmitInstanced(GLsizei instanceCount)const;
+
+    const GeometryArena::Allocation& GetAllocation() const { return m_allocation; }
+    // object space bounds, for culling
+    const BoundingBox& GetBounds() const { return m_bounds; }
+    // bytes the mesh occupies in GPU buffers
+    std::size_t GetMemorySize() const;
+
+    static BoundingBox ComputeBounds(const PackedVertex* vertices, GLsizei vertexCount);
 private:
-    void Cleanup()
-    {
-        if (m_VAO != 0)
-            glDeleteVertexArrays(1, &m_VAO);
-        if (m_VBO != 0)
-            glDeleteBuffers(1, &m_VBO);
-        if (m_EBO != 0)
-            glDeleteBuffers(1, &m_EBO);
-        m_VAO = m_VBO = m_EBO = 0;
-    }
-    
-    GLuint m_VAO = 0; // vertex array object https://www.khronos.org/opengl/wiki/Vertex_Specification#Vertex_Array_Object 
-    GLuint m_VBO = 0; // vertex buffer object https://en.wikipedia.org/wiki/Vertex_buffer_object
-    GLuint m_EBO = 0; // EBO index buffer 
-    GLsizei m_vertexCount = 0;
-    GLsizei m_indexCount = 0;
+    void Cleanup();
+
+    GeometryArena::Allocation m_allocation;
+    BoundingBox m_bounds;
 };
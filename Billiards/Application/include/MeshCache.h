@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+
+class MappedFile;
+
+// Binary cache of imported meshes, so warm starts skip Assimp.
+// An entry stores the interleaved PackedVertex and index buffers and the bounds of every mesh of one source file. It is keyed by the
+// source path and validated against the source size, modification time and content hash. Entries are memory
+// mapped and the buffers are uploaded to Mesh::Init straight from the mapping.
+// Collision data baked from the meshes at import, such as the cushions of a table, is kept in the same entry as
+// an opaque blob so it goes stale together with them.
+class MeshCache
+{
+public:
+    MeshCache() = delete;
+    ~MeshCache() = delete;
+
+    // bump whenever the file layout or the PackedVertex struct changes
+    static constexpr std::uint32_t c_VERSION = 4;
+
+    // upload the cached meshes of sourcePath, returns false if there is no valid entry
+    static bool Load(const std::string& sourcePath, std::vector<Mesh>& outMeshes);
+    // copy the cached meshes of sourcePath into CPU buffers, touches no GL state so it can run on any thread
+    // the collision blob stored with them is copied too if asked for, empty if none was baked
+    static bool Read(const std::string& sourcePath, std::vector<MeshData>& outMeshes,
+                     std::vector<std::uint8_t>* outRails = nullptr);
+    // write the entry for sourcePath, returns false if it could not be written
+    static bool Store(const std::string& sourcePath, const std::vector<MeshData>& meshes,
+                      const std::vector<std::uint8_t>& rails = {});
+
+    static std::string GetCachePath(const std::string& sourcePath);
+
+private:
+    struct SourceStamp
+    {
+        std::uint64_t size = 0;
+        std::int64_t modifiedTime = 0;
+    };
+
+    // map and validate the entry of sourcePath, the views point into the mapping, the rails are copied out if asked for
+    // outStale is set when only the source's modification time changed, the file must be closed before refreshing it
+    static bool Map(const std::string& sourcePath, MappedFile& file, std::vector<MeshView>& outViews,
+                    bool& outStale, std::vector<std::uint8_t>* outRails = nullptr);
+    static void RefreshSourceTime(const std::string& sourcePath);
+    static bool ReadSourceStamp(const std::string& sourcePath, SourceStamp& outStamp);
+    static bool HashSource(const std::string& sourcePath, std::uint64_t& outHash);
+    static std::uint64_t Hash(const void* data, std::size_t size, std::uint64_t seed);
+};
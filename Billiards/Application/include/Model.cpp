@@ -1,38 +1,100 @@
 ﻿#include "Model.h"
+#include "InstanceBuffer.h"
 #include <utility>
 
+#include <glm/gtc/matrix_transform.hpp>
+
 Model::Model(std::vector<Mesh>&& meshes, std::string directory)
-    : m_meshes(std::move(meshes)), m_directory(std::move(directory)),
-    m_position(glm::vec3(0.0f, 0.0f, 0.0f)), m_rotation(glm::vec3(0.0f, 0.0f, 0.0f)),
-    m_scale(glm::vec3(1.0f, 1.0f, 1.0f)), m_transform(glm::mat4(1.0f))
+    : m_meshes(std::move(meshes)), m_directory(std::move(directory)), m_batch(m_meshes),
+    m_position(glm::vec3(0.0f, 0.0f, 0.0f)), m_rotation(glm::quat(1.0f, 0.0f, 0.0f, 0.0f)),
+    m_scale(glm::vec3(1.0f, 1.0f, 1.0f)), m_transform(glm::mat4(1.0f)), m_normalMatrix(glm::mat3(1.0f))
 {
-    
+    for (const Mesh& mesh : m_meshes)
+        m_bounds.Extend(mesh.GetBounds());
 }
 
 void Model::Draw() const
+{
+    m_batch.Draw();
+}
+
+void Model::DrawInstanced(const InstanceBuffer& instances) const
+{
+    if (instances.GetCount() == 0)
+        return;
+
+    // every mesh shares the arena VAO, so the instance arrays are attached once for the whole model
+    GeometryArena::Get().BindInstancedVertexArray();
+    instances.BindAttributes();
+    SubmitInstanced(instances.GetCount());
+}
+
+void Model::SubmitInstanced(GLsizei instanceCount) const
 {
     for (const auto& mesh : m_meshes)
-        mesh.Draw();
+        mesh.SubmitInstanced(instanceCount);
 }
 
 void Model::SetPosition(float x, float y, float z)
 {
-    m_position = glm::vec3(x, y, z);
+    SetPosition(glm::vec3(x, y, z));
 }
 
 void Model::SetPosition(glm::vec3 position)
 {
     m_position = position;
+    m_transformDirty = true;
 }
 
 void Model::SetScale(float scale)
 {
-    m_scale = glm::vec3(scale);
+    SetScale(scale, scale, scale);
 }
 
 void Model::SetScale(float x, float y, float z)
 {
     m_scale = glm::vec3(x, y, z);
+    m_transformDirty = true;
+}
+
+void Model::SetRotation(float angle, float x, float y, float z)
+{
+    SetRotation(glm::angleAxis(angle, glm::normalize(glm::vec3(x, y, z))));
+}
+
+void Model::SetRotation(const glm::quat& rotation)
+{
+    m_rotation = rotation;
+    m_transformDirty = true;
+}
+
+const glm::mat4x4& Model::GetTransform() const
+{
+    if (m_transformDirty)
+        UpdateTransform();
+    return m_transform;
+}
+
+const glm::mat3& Model::GetNormalMatrix() const
+{
+    if (m_transformDirty)
+        UpdateTransform();
+    return m_normalMatrix;
+}
+
+void Model::UpdateTransform() const
+{
+    // columns of the rotation scaled per axis, then the translation, no matrix products needed
+    const glm::mat3 rotation = glm::mat3_cast(m_rotation);
+    m_transform = glm::mat4x4(
+        glm::vec4(rotation[0] * m_scale.x, 0.0f),
+        glm::vec4(rotation[1] * m_scale.y, 0.0f),
+        glm::vec4(rotation[2] * m_scale.z, 0.0f),
+        glm::vec4(m_position, 1.0f));
+
+    // the inverse transpose of rotation * scale is rotation * inverse scale, so no general inverse is needed
+    m_normalMatrix = glm::mat3(rotation[0] / m_scale.x, rotation[1] / m_scale.y, rotation[2] / m_scale.z);
+    m_transformDirty = false;
 }
 
 
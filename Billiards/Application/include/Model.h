@@ -1,8 +1,10 @@
 ﻿#pragma once
 
 #include <string>
+#include <vector>
 
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include "Mesh.h"
 
@@ -17,27 +19,49 @@ public:
     Model(Model && model) noexcept = default;
     Model &operator=(Model &&other) noexcept = default;    
     
+    // all meshes with a single multi-draw, the instance data is set by the caller
     void Draw()const;
+    // draw every mesh once for all instances in the buffer, the instance transforms replace m_transform
+    void DrawInstanced(const InstanceBuffer& instances)const;
+    // the instanced draws alone, the arena's instanced VAO and the instance attributes must already be bound
+    void SubmitInstanced(GLsizei instanceCount)const;
+
+    const DrawBatch& GetBatch() const { return m_batch; }
+    int GetMeshCount() const { return static_cast<int>(m_meshes.size()); }
+    const Mesh& GetMesh(int index) const { return m_meshes[index]; }
+    // object space bounds of every mesh together
+    const BoundingBox& GetBounds() const { return m_bounds; }
 
     void SetScale(float scale);
     void SetScale(float x, float y, float z);
-    void SetRotation(float angle, float x, float y, float z);
+    void SetRotation(float angle, float x, float y, float z); // angle in radians around the axis (x, y, z)
+    void SetRotation(const glm::quat& rotation);
     void SetPosition(float x, float y, float z);
     void SetPosition(glm::vec3 position);
 
+    // translation * rotation * scale, rebuilt on first use after a setter changed it
+    const glm::mat4x4& GetTransform() const;
+    // matrix for normals, rotation * inverse scale, rebuilt together with the transform
+    const glm::mat3& GetNormalMatrix() const;
+    bool HasUniformScale() const { return m_scale.x == m_scale.y && m_scale.y == m_scale.z; }
+
     // no copying
     Model(const Model&) = delete;
     Model& operator=(const Model&) = delete;
 private:
-    void UpdateTransform();
+    void UpdateTransform() const;
 
     // geometry data
     std::vector<Mesh> m_meshes;
     std::string m_directory;
+    DrawBatch m_batch; // every mesh in one multi-draw per index type
+    BoundingBox m_bounds;
 
-    // transform
+    // transform, the matrix is a cache of the other three
     glm::vec3 m_position;
-    glm::vec3 m_rotation;
+    glm::quat m_rotation;
     glm::vec3 m_scale;
-    glm::mat4x4 m_transform;
+    mutable glm::mat4x4 m_transform;
+    mutable glm::mat3 m_normalMatrix;
+    mutable bool m_transformDirty = false;
 };
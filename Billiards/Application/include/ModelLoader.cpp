@@ -1,10 +1,13 @@
 ﻿#include "ModelLoader.h"
 #include "Model.h"
 #include "Mesh.h"
+#include "MeshCache.h"
 
 #include <iostream>
 #include <utility> // std::move
 
+#include "ThreadPool.h"
+
 // assimp
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -13,8 +16,89 @@
 
 using namespace Assimp;
 
+namespace
+{
+    // shared by every load, the workers are created on first use
+    ThreadPool& GetLoaderPool()
+    {
+        static ThreadPool s_pool;
+        return s_pool;
+    }
+}
+
 std::unique_ptr<Model> ModelLoader::LoadModel(const std::string& path)
 {   
+    std::string directory = path.substr(0, path.find_last_of('/'));
+
+    // warm start, the cache holds the meshes exactly as the import below produces them
+    std::vector<Mesh> meshes;
+    if (MeshCache::Load(path, meshes))
+    {
+        std::cout << "Model loaded from mesh cache: " << path << " with " << meshes.size() << " meshes.\n";
+        return std::make_unique<Model>(std::move(meshes), directory);
+    }
+
+    std::vector<MeshData> meshData;
+    if (!ImportMeshData(path, meshData))
+        return nullptr;
+
+    // GL stage, on this thread since it owns the context
+    std::vector<MeshView> views;
+    views.reserve(meshData.size());
+    for (const MeshData& data : meshData)
+        views.push_back(data.GetView());
+    meshes = Mesh::CreateBatch(views);
+
+    std::cout << "Model loaded with ModeLoader: " << path << "with" << meshes.size() << " meshes.\n";
+
+    return std::make_unique<Model>(std::move(meshes), directory);
+}
+
+bool ModelLoader::LoadMeshData(const std::string& path, std::vector<MeshData>& outMeshes, RailGeometry* outRails)
+{
+    std::vector<std::uint8_t> blob;
+    std::vector<std::uint8_t>* blobOut = outRails ? &blob : nullptr;
+    if (!MeshCache::Read(path, outMeshes, blobOut) && !ImportMeshData(path, outMeshes, blobOut))
+        return false;
+
+    if (outRails && (blob.empty() || !outRails->Deserialize(blob.data(), blob.size())))
+        *outRails = RailGeometry();
+    return true;
+}
+
+bool ModelLoader::LoadRailGeometry(const std::string& path, RailGeometry& outRails)
+{
+    std::vector<MeshData> meshes;
+    return LoadMeshData(path, meshes, &outRails) && !outRails.IsEmpty();
+}
+
+std::vector<std::uint8_t> ModelLoader::BakeRails(const std::vector<MeshData>& meshes)
+{
+    std::vector<RailMeshView> views;
+    views.reserve(meshes.size());
+    for (const MeshData& mesh : meshes)
+    {
+        if (mesh.vertices.empty())
+            continue;
+        RailMeshView view;
+        view.positions = &mesh.vertices[0].position.x;
+        view.stride = sizeof(PackedVertex);
+        view.indices = mesh.indices.data();
+        view.indexCount = mesh.indices.size();
+        views.push_back(view);
+    }
+
+    std::vector<std::uint8_t> blob;
+    RailGeometry rails;
+    if (RailGeometry::Bake(views, rails))
+        rails.Serialize(blob);
+    return blob;
+}
+
+bool ModelLoader::ImportMeshData(const std::string& path, std::vector<MeshData>& outMeshes,
+                                 std::vector<std::uint8_t>* outRails)
+{
+    std::string directory = path.substr(0, path.find_last_of('/'));
     ASSIMP_API Importer importer;
 
     const aiScene* scene = importer.ReadFile(
@@ -25,58 +109,72 @@ std::unique_ptr<Model> ModelLoader::LoadModel(const std::string& path)
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
     {
         std::cerr << "ERROR::MODELLOADER::ASSIMP::" << importer.GetErrorString() << std::endl;
-        return nullptr;
+        return false;
     }
 
-    std::string directory = path.substr(0, path.find_last_of('/'));
-    std::vector<Mesh> meshes;
-
-    ProcessNode(scene->mRootNode, scene, meshes, directory);
-
-    std::cout << "Model loaded with ModeLoader: " << path << "with" << meshes.size() << " meshes.\n";
-
-    return std::make_unique<Model>(std::move(meshes), directory);
+    std::vector<aiMesh*> sceneMeshes;
+    ProcessNode(scene->mRootNode, scene, sceneMeshes);
+
+    // CPU stage, every mesh is converted on the worker threads
+    outMeshes.clear();
+    outMeshes.resize(sceneMeshes.size());
+    GetLoaderPool().ParallelFor(static_cast<int>(sceneMeshes.size()), 1, [&](int begin, int end, int) {
+        for (int i = begin; i < end; i++)
+            outMeshes[i] = ProcessMesh(sceneMeshes[i], scene, directory);
+    });
+
+    // the cushions are baked once here, later loads read them from the cache with the meshes
+    std::vector<std::uint8_t> rails = BakeRails(outMeshes);
+    if (!MeshCache::Store(path, outMeshes, rails))
+        std::cerr << "Warning: could not write the mesh cache for " << path << std::endl;
+    if (outRails)
+        *outRails = std::move(rails);
+    return true;
 }
 
-void ModelLoader::ProcessNode(aiNode* node, const aiScene* scene, std::vector<Mesh>& outMeshes,
-                              const std::string& directory)
+void ModelLoader::ProcessNode(aiNode* node, const aiScene* scene, std::vector<aiMesh*>& outMeshes)
 {
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
     {
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        outMeshes.push_back(ProcessMesh(mesh, scene, directory));
+        outMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
     }
 
     for (unsigned int i = 0; i < node->mNumChildren; i++)
     {
-        ProcessNode(node->mChildren[i], scene, outMeshes, directory);
+        ProcessNode(node->mChildren[i], scene, outMeshes);
     }
 }
 
-Mesh ModelLoader::ProcessMesh(aiMesh* mesh, const aiScene* scene, const std::string& directory)
+MeshData ModelLoader::ProcessMesh(aiMesh* mesh, const aiScene* scene, const std::string& directory)
 {
-    std::vector<Vertex> vertices;
-    std::vector<GLsizei> indices;
-    vertices.reserve(mesh->mNumVertices);
-    indices.reserve(mesh->mNumFaces * 3);
+    MeshData data;
 
+    // sized once up front and written in place, no push_back per vertex
+    // the bounds come along with the vertices, culling never has to walk them again
+    data.vertices.resize(mesh->mNumVertices);
+    const aiVector3D* texCoords = mesh->mTextureCoords[0];
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
         Vertex vertex;
         vertex.position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+        data.bounds.Extend(vertex.position);
         vertex.normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
-        vertex.texCoord = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
-        vertices.push_back(vertex);
+        vertex.texCoord = texCoords ? glm::vec2(texCoords[i].x, texCoords[i].y) : glm::vec2(0.0f);
+        data.vertices[i] = PackedVertex::Pack(vertex);
     }
 
+    size_t indexCount = 0;
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+        indexCount += mesh->mFaces[i].mNumIndices;
+
+    data.indices.resize(indexCount);
+    GLsizei* index = data.indices.data();
     for (unsigned int i = 0; i < mesh->mNumFaces; i++)
     {
-        aiFace face = mesh->mFaces[i];
+        const aiFace& face = mesh->mFaces[i];
         for (unsigned int j = 0; j < face.mNumIndices; j++)
-        {
-            indices.push_back(face.mIndices[j]);
-        }
+            *index++ = static_cast<GLsizei>(face.mIndices[j]);
     }
 
-    return Mesh(vertices.data(), indices.data(), mesh->mNumVertices, mesh->mNumFaces * 3);
+    return data;
 }
@@ -5,6 +5,7 @@
 #include <string>
 
 #include "Model.h"
+#include "RailGeometry.h"
 
 // forward declarations using assimp.h
 struct aiNode;
@@ -19,8 +20,19 @@ public:
     ~ModelLoader() = delete;
     
     static std::unique_ptr<Model> LoadModel(const std::string &path);
+    // CPU half of LoadModel (mesh cache or import), touches no GL state so it can run on a loader thread
+    // the cushions come along if asked for, left empty if the model has none
+    static bool LoadMeshData(const std::string& path, std::vector<MeshData>& outMeshes, RailGeometry* outRails = nullptr);
+    // cushions of a table model, baked at import and kept in the mesh cache, false if the model has none
+    static bool LoadRailGeometry(const std::string& path, RailGeometry& outRails);
 private:
-    static void ProcessNode(aiNode* node, const aiScene* scene, std::vector<Mesh>& outMeshes,
-                            const std::string& directory);
-    static Mesh ProcessMesh(aiMesh* mesh, const aiScene* scene, const std::string &directory);
+    // slice the meshes into rail primitives, an empty blob if they hold no table
+    static std::vector<std::uint8_t> BakeRails(const std::vector<MeshData>& meshes);
+    // import with Assimp and refresh the mesh cache, the baked cushions are handed out too if asked for
+    static bool ImportMeshData(const std::string& path, std::vector<MeshData>& outMeshes,
+                               std::vector<std::uint8_t>* outRails = nullptr);
+    // collect the meshes referenced by the node tree, in depth first order
+    static void ProcessNode(aiNode* node, const aiScene* scene, std::vector<aiMesh*>& outMeshes);
+    // convert one mesh into staging buffers, touches no GL state so meshes can be processed in parallel
+    static MeshData ProcessMesh(aiMesh* mesh, const aiScene* scene, const std::string &directory);
 };
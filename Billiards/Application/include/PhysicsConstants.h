@@ -0,0 +1,34 @@
+#pragma once
+
+// Physical constants for the billiards simulation.
+// Values come from the data tables in README.md, converted to SI units (m, kg, s).
+// Where the README gives a range, the middle of the range is used.
+
+constexpr float c_GRAVITY = 9.81f; // m/s^2
+
+// Table 1: billiard ball
+constexpr float c_BALL_DIAMETER = 0.05715f; // m
+constexpr float c_BALL_RADIUS = 0.028575f; // m
+constexpr float c_BALL_MASS = 0.170f; // kg
+constexpr float c_BALL_INERTIA = 0.4f * c_BALL_MASS * c_BALL_RADIUS * c_BALL_RADIUS; // kg*m^2, solid sphere
+
+// Table 2: restitution coefficients
+constexpr float c_RESTITUTION_BALL = 0.95f;
+constexpr float c_RESTITUTION_RAIL = 0.75f;
+constexpr float c_RESTITUTION_CUE = 0.73f;
+
+// Table 3: friction coefficients
+constexpr float c_FRICTION_BALL = 0.055f;
+constexpr float c_FRICTION_SLIDE = 0.2f; // most common value according to drdavepoolinfo
+constexpr float c_FRICTION_ROLL = 0.01f;
+
+// Table 4: spin deceleration around the vertical axis
+constexpr float c_SPIN_DECELERATION = 10.0f; // rad/s^2
+
+// table layout, playing surface of a 9ft table centred on the origin
+// x runs along the length of the table and y along its width
+constexpr float c_TABLE_LENGTH = 2.54f; // m
+constexpr float c_TABLE_WIDTH = 1.27f; // m
+constexpr float c_POCKET_RADIUS = 0.06f; // capture radius around a pocket centre
+constexpr int c_POCKET_COUNT = 6;
+constexpr int c_BALL_COUNT = 16; // cue ball + 15 object balls
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "PhysicsConstants.h"
+#include "EventSolver.h"
+#include "UniformGrid.h"
+#include "CollisionKernel.h"
+#include "RailGeometry.h"
+
+// motion state of a ball, decides which friction model is applied to it
+enum class BallState : std::uint8_t
+{
+    Stationary, // at rest
+    Spinning,   // no linear velocity, only spin around the vertical axis
+    Sliding,    // the contact point slips over the cloth
+    Rolling,    // rolling without slipping
+    Pocketed    // out of play
+};
+
+// how PhysicsWorld::Update advances the simulation
+enum class SolverMode : std::uint8_t
+{
+    FixedStep,  // fixed substeps fed by a time accumulator
+    EventDriven // jump from one predicted collision or state change to the next
+};
+
+// parameters for striking a ball with the cue
+struct CueShot
+{
+    float angle = 0.0f;    // direction in the table plane in radians, 0 is +x
+    float speed = 0.0f;    // ball speed right after the hit (m/s)
+    float sideSpin = 0.0f; // horizontal offset of the cue tip from the ball centre, in radii [-1, 1]
+    float topSpin = 0.0f;  // vertical offset of the cue tip, in radii [-1, 1], positive is follow
+};
+
+// compact snapshot of a table at rest, used to hand tables to and from the batch simulator
+struct TableState
+{
+    float posX[c_BALL_COUNT] = {};
+    float posY[c_BALL_COUNT] = {};
+    BallState state[c_BALL_COUNT] = {};
+    std::uint8_t ballCount = 0;
+
+    // bit i is set when ball i is pocketed
+    std::uint16_t GetPocketedMask() const
+    {
+        std::uint16_t mask = 0;
+        for (int i = 0; i < ballCount; i++)
+        {
+            if (state[i] == BallState::Pocketed)
+                mask |= static_cast<std::uint16_t>(1u << i);
+        }
+        return mask;
+    }
+};
+
+// full ball state at one instant, handed from the simulation thread to the render thread
+struct PhysicsSnapshot
+{
+    float posX[c_BALL_COUNT] = {};
+    float posY[c_BALL_COUNT] = {};
+    float angX[c_BALL_COUNT] = {};
+    float angY[c_BALL_COUNT] = {};
+    float angZ[c_BALL_COUNT] = {};
+    BallState state[c_BALL_COUNT] = {};
+    std::uint8_t ballCount = 0;
+
+    float time = 0.0f;        // simulated seconds
+    bool atRest = true;
+    SolverMode solverMode = SolverMode::FixedStep;
+    KernelPath kernelPath = KernelPath::Scalar;
+    std::uint8_t awakeCount = 0;  // fixed stepping, balls the last step looked at
+    std::uint8_t islandCount = 0; // and the contact islands they formed
+
+    // event-driven worlds pass on the solver's closed form motion, exact at any time until validUntil
+    bool analytic = false;
+    BallTrajectories trajectories;
+
+    // filled in by the simulation thread
+    std::uint64_t tick = 0;
+    float stepTime = 0.0f;    // ms spent simulating this tick
+    std::uint64_t commandCount = 0; // commands run so far, trajectories only lead to a snapshot with the same count
+
+    // blend positions and spins, alpha 0 is a and 1 is b; balls that were pocketed or re-placed in between take b
+    static void Interpolate(const PhysicsSnapshot& a, const PhysicsSnapshot& b, float alpha, PhysicsSnapshot& out);
+};
+
+// exact state of a world between two steps, restoring it continues the simulation bit for bit
+struct WorldState
+{
+    float posX[c_BALL_COUNT] = {};
+    float posY[c_BALL_COUNT] = {};
+    float velX[c_BALL_COUNT] = {};
+    float velY[c_BALL_COUNT] = {};
+    float angX[c_BALL_COUNT] = {};
+    float angY[c_BALL_COUNT] = {};
+    float angZ[c_BALL_COUNT] = {};
+    BallState state[c_BALL_COUNT] = {};
+    std::uint8_t ballCount = 0;
+
+    float time = 0.0f;
+    float accumulator = 0.0f;
+    std::uint64_t stepCount = 0;
+};
+
+// Billiards physics simulation.
+// Ball state is stored as a structure of arrays so the step loops run over contiguous memory,
+// and the world advances in fixed substeps fed by an accumulator of frame time.
+class PhysicsWorld
+{
+public:
+    explicit PhysicsWorld(float fixedStep = 1.0f / 960.0f, int maxSubsteps = 240);
+    ~PhysicsWorld() = default;
+
+    PhysicsWorld(const PhysicsWorld&) = default;
+    PhysicsWorld& operator=(const PhysicsWorld&) = default;
+    PhysicsWorld(PhysicsWorld&&) noexcept = default;
+    PhysicsWorld& operator=(PhysicsWorld&&) noexcept = default;
+
+    // advance the simulation by frame time, either in fixed substeps or from event to event
+    void Update(float deltaTime);
+    // advance the simulation by exactly one substep of length dt
+    void Step(float dt);
+    // run until every ball is at rest or maxTime seconds have passed, returns the simulated time
+    float SimulateUntilRest(float maxTime = 60.0f);
+
+    // deterministic worlds only step in fixed substeps, on the scalar kernel
+    void SetSolverMode(SolverMode mode) { if (!m_deterministic) m_solverMode = mode; }
+    SolverMode GetSolverMode() const { return m_solverMode; }
+    const EventSolver& GetEventSolver() const { return m_eventSolver; }
+    void SetKernelPath(KernelPath path) { m_kernelPath = path; }
+    KernelPath GetKernelPath() const { return m_kernelPath; }
+    // the same initial state and the same strikes at the same step counts give bit-identical results, so a
+    // run can be recorded as its inputs and replayed
+    void SetDeterministic(bool deterministic);
+    bool IsDeterministic() const { return m_deterministic; }
+    // cushions baked from a table model, shared between worlds; null keeps the box cushions of the table constants
+    void SetRailGeometry(std::shared_ptr<const RailGeometry> rails);
+    const RailGeometry* GetRailGeometry() const { return m_rails.get(); }
+
+    int AddBall(float x, float y);
+    void Clear();
+    void RackBalls(); // cue ball on the head spot and a 15-ball triangle on the foot spot
+    void Strike(int ball, const CueShot& shot);
+
+    // replace the balls with a resting table, and capture the first c_BALL_COUNT balls (velocities are dropped)
+    void LoadState(const TableState& table);
+    void SaveState(TableState& table) const;
+    // every ball with its spin, the first c_BALL_COUNT balls
+    void SaveSnapshot(PhysicsSnapshot& snapshot) const;
+    void SaveWorldState(WorldState& state) const;
+    void LoadWorldState(const WorldState& state);
+
+    bool IsAtRest() const;
+    int GetBallCount() const { return static_cast<int>(m_state.size()); }
+    // fixed stepping only, as of the last step: balls that were not asleep and the contact islands they formed
+    int GetAwakeCount() const { return static_cast<int>(m_awake.size()); }
+    int GetIslandCount() const { return m_islandCount; }
+    float GetFixedStep() const { return m_fixedStep; }
+    float GetTime() const { return m_time; }
+    // substeps taken since the world was created, never reset, the clock inputs are recorded against
+    std::uint64_t GetStepCount() const { return m_stepCount; }
+    float GetInterpolationAlpha() const { return m_accumulator / m_fixedStep; }
+
+    // read access to the ball arrays, each GetBallCount() long
+    const float* GetPositionsX() const { return m_posX.data(); }
+    const float* GetPositionsY() const { return m_posY.data(); }
+    const float* GetVelocitiesX() const { return m_velX.data(); }
+    const float* GetVelocitiesY() const { return m_velY.data(); }
+    const float* GetAngularX() const { return m_angX.data(); }
+    const float* GetAngularY() const { return m_angY.data(); }
+    const float* GetAngularZ() const { return m_angZ.data(); }
+    const BallState* GetStates() const { return m_state.data(); }
+
+    static void GetPocketPosition(int pocket, float& x, float& y);
+
+private:
+    friend class EventSolver;
+
+    // collects the balls the step has to look at, false when every ball sleeps
+    bool UpdateAwakeSet();
+    void IntegrateBalls(float dt);
+    void CheckPockets();
+    void ResolveCushionCollisions();
+    void ResolveRailCollisions();
+    void ResolveBallCollisions();
+    // groups moving balls with everything they can reach before the islands have to be rebuilt
+    void BuildIslands();
+    bool AreIslandsCurrent() const;
+    // narrowphase over a range of the pair lists, overlaps are collected for ResolveBallCollisions
+    void FindOverlappingPairs(int begin, int end);
+    void ResolveBallPair(int i, int j);
+
+    // collision responses shared by the fixed stepper and the event solver
+    void ApplyBallImpulse(int i, int j, float nx, float ny);
+    void ReboundFromCushion(int i, bool alongX);
+    void ReboundFromRail(int i, float nx, float ny);
+    void PocketBall(int i);
+
+    // ball state, structure of arrays indexed by ball
+    std::vector<float> m_posX;
+    std::vector<float> m_posY;
+    std::vector<float> m_velX;
+    std::vector<float> m_velY;
+    std::vector<float> m_angX; // angular velocity around the table x axis
+    std::vector<float> m_angY; // angular velocity around the table y axis
+    std::vector<float> m_angZ; // angular velocity around the vertical axis (english)
+    std::vector<BallState> m_state;
+
+    float m_fixedStep = 1.0f / 960.0f;
+    int m_maxSubsteps = 240; // cap on substeps per Update to avoid a spiral of death after a stall
+    float m_accumulator = 0.0f;
+    float m_time = 0.0f;
+    std::uint64_t m_stepCount = 0;
+    bool m_deterministic = false;
+
+    SolverMode m_solverMode = SolverMode::FixedStep;
+    EventSolver m_eventSolver;
+    // bumped by every public change to the ball state so the event solver knows its predictions are stale
+    std::uint32_t m_revision = 0;
+
+    // baked cushions, when set they replace the box and balls are swept along their step against them
+    std::shared_ptr<const RailGeometry> m_rails;
+    std::vector<float> m_stepStartX; // per ball, position before the step moved it
+    std::vector<float> m_stepStartY;
+
+    // ball-ball broadphase and narrowphase, the vectors are scratch space kept between steps
+    UniformGrid m_grid;
+    UniformGrid m_islandGrid; // cells as wide as an island's reach, finds the balls BuildIslands measures
+    std::vector<int> m_nearby;
+    KernelPath m_kernelPath;
+    std::vector<int> m_pairA;
+    std::vector<int> m_pairB;
+    std::vector<int> m_overlaps;
+    std::vector<std::uint64_t> m_contacts; // (a << 32 | b) of the overlapping pairs of a step, sorted before they are resolved
+
+    // sleeping balls, stationary or pocketed, are skipped by every pass of a fixed step
+    std::vector<int> m_awake;
+
+    // Contact islands for the fixed stepper, valid over many steps like a Verlet list: a moving ball is joined
+    // with every ball within a diameter plus a skin, and the pair lists hold the pairs of each island back to
+    // back. They stay complete until a ball that did not move at the build starts moving, a moving ball has
+    // covered half the skin or the world is changed from outside.
+    int m_islandCount = 0;
+    std::vector<int> m_islandPairStart;  // per island, its first pair, followed by the total pair count
+    std::vector<int> m_islandOf;         // per ball, its island or -1
+    std::vector<float> m_islandX;        // per ball, position at the build
+    std::vector<float> m_islandY;
+    std::vector<std::uint8_t> m_islandMoving; // per ball, whether it moved at the build
+    std::vector<std::uint8_t> m_islandActive; // per island, scratch for the current step
+    std::vector<int> m_islandParent;     // union-find scratch
+    std::uint32_t m_stepRevision = 0;    // m_revision as the last step left it
+    bool m_islandsValid = false;
+};
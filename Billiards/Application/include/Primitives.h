@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Mesh.h"
+
+// Procedural meshes for objects that do not need an asset file.
+class Primitives
+{
+public:
+    Primitives() = delete;
+    ~Primitives() = delete;
+
+    // UV sphere around the origin, rings >= 2 latitude bands and segments >= 3 longitude bands
+    static Mesh CreateSphere(float radius, int rings, int segments);
+    // axis aligned box centred on the origin, every face has its own vertices so the normals stay flat
+    static Mesh CreateBox(float width, float height, float depth);
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Frame profiler for the main thread: scoped CPU timers, GL_TIME_ELAPSED queries around GPU passes and a ring
+// buffer of the last c_HISTORY_SIZE frames.
+// GPU queries are double buffered, frame n reads the results of frame n - 2 when it begins and drops any that
+// are not available yet instead of waiting, so timing never stalls the pipeline. GPU scopes must not nest, the
+// GL has a single time elapsed target. The history is drawn as a graph and a flame view of one frame, and can
+// be written as Chrome trace JSON (chrome://tracing, Perfetto).
+class Profiler
+{
+public:
+    static constexpr int c_HISTORY_SIZE = 300;
+    static constexpr int c_MAX_SCOPES = 48;     // per frame, CPU and GPU together
+    static constexpr int c_MAX_GPU_SCOPES = 8;  // per frame
+    static constexpr int c_GPU_LATENCY = 2;     // frames a query set is in flight
+
+    struct Scope
+    {
+        const char* name;    // must outlive the profiler, string literals
+        float start;         // ms after the frame start, for GPU scopes when the commands were submitted
+        float duration;      // ms, negative for GPU scopes without a result (yet)
+        std::uint8_t depth;  // nesting level of CPU scopes
+        bool gpu;
+    };
+
+    struct Frame
+    {
+        std::uint64_t number = 0;
+        double start = 0.0;   // ms since the profiler was created
+        float duration = 0.0f;
+        float gpuDuration = 0.0f; // sum of the GPU scopes with results
+        int scopeCount = 0;
+        Scope scopes[c_MAX_SCOPES];
+    };
+
+    // times the enclosing block on the CPU
+    class CpuScope
+    {
+    public:
+        CpuScope(Profiler* profiler, const char* name) : m_profiler(profiler), m_scope(profiler ? profiler->BeginCpu(name) : -1) {}
+        ~CpuScope() { if (m_profiler) m_profiler->EndCpu(m_scope); }
+        CpuScope(const CpuScope&) = delete;
+        CpuScope& operator=(const CpuScope&) = delete;
+    private:
+        Profiler* m_profiler;
+        int m_scope;
+    };
+
+    // times the GL commands issued in the enclosing block
+    class GpuScope
+    {
+    public:
+        GpuScope(Profiler* profiler, const char* name) : m_profiler(profiler), m_scope(profiler ? profiler->BeginGpu(name) : -1) {}
+        ~GpuScope() { if (m_profiler) m_profiler->EndGpu(m_scope); }
+        GpuScope(const GpuScope&) = delete;
+        GpuScope& operator=(const GpuScope&) = delete;
+    private:
+        Profiler* m_profiler;
+        int m_scope;
+    };
+
+    // gpuTiming needs a current GL context for the whole lifetime of the profiler
+    explicit Profiler(bool gpuTiming);
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+    Profiler(Profiler&&) = delete;
+    Profiler& operator=(Profiler&&) = delete;
+
+    void BeginFrame();
+    void EndFrame();
+
+    // scopes return an index for the matching End, -1 when the frame has no room left
+    int BeginCpu(const char* name);
+    void EndCpu(int scope);
+    int BeginGpu(const char* name);
+    void EndGpu(int scope);
+
+    // completed frames, age 0 is the newest one
+    int GetFrameCount() const { return m_frameCount; }
+    const Frame& GetFrame(int age) const;
+
+    // ImGui window with the frame graph, the flame view and per-scope averages
+    void DrawPanel(bool* open = nullptr);
+    // every frame of the history as complete events, CPU and GPU on separate tracks
+    bool ExportChromeTrace(const std::string& path) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct QuerySet
+    {
+        unsigned int queries[c_MAX_GPU_SCOPES] = {};
+        int scopes[c_MAX_GPU_SCOPES] = {}; // scope index in the frame the query was issued in
+        int count = 0;
+        int frame = -1;                    // ring index of that frame
+        std::uint64_t frameNumber = 0;
+    };
+
+    double Now() const;
+    void ReadGpuResults(QuerySet& set);
+    void DrawFlame(const Frame& frame, float width);
+
+    Clock::time_point m_epoch;
+    bool m_gpuTiming;
+
+    std::vector<Frame> m_frames; // ring, c_HISTORY_SIZE entries
+    int m_current = -1;          // ring index of the frame being recorded
+    int m_latest = -1;           // ring index of the newest completed frame
+    int m_frameCount = 0;        // completed frames in the ring
+    std::uint64_t m_frameNumber = 0;
+    int m_depth = 0;
+
+    QuerySet m_querySets[c_GPU_LATENCY];
+    int m_activeGpuScope = -1;
+    int m_droppedGpuResults = 0;
+
+    // panel state
+    bool m_paused = false;
+    int m_selectedAge = c_GPU_LATENCY; // frame shown in the flame view, the newest with GPU results
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PhysicsConstants.h"
+
+enum class RailShape : std::uint8_t
+{
+    Segment,
+    Arc
+};
+
+// one piece of cushion nose or pocket jaw in table coordinates
+struct RailPrimitive
+{
+    RailShape shape = RailShape::Segment;
+    float x0 = 0.0f, y0 = 0.0f; // segment start, or arc centre
+    float x1 = 0.0f, y1 = 0.0f; // segment end, unused by arcs
+    float radius = 0.0f;        // arc only
+    float angle = 0.0f;         // arc only, it runs counter-clockwise from angle over sweep radians
+    float sweep = 0.0f;
+};
+
+// triangles of one mesh, positions are read with a byte stride so vertex structs can be passed as they are
+struct RailMeshView
+{
+    const float* positions = nullptr;
+    std::size_t stride = 0;
+    const int* indices = nullptr;
+    std::size_t indexCount = 0;
+};
+
+// Static 2D collision outline of a table's cushions and pocket jaws.
+// Bake slices the table mesh at the height of a ball's centre, welds the cuts into chains and fits each chain
+// with as few segments and arcs as stay within a tolerance of it, so the primitive count depends on the shape
+// of the rails and not on how finely the visual mesh is tessellated. The primitives are binned into a uniform
+// grid, grown by a ball radius, so a ball only ever tests the few primitives around it.
+class RailGeometry
+{
+public:
+    // earliest contact of a swept circle
+    struct Hit
+    {
+        float time = 1.0f;      // fraction of the sweep
+        float normalX = 0.0f;   // unit normal pointing from the rail to the ball
+        float normalY = 0.0f;
+        int primitive = -1;
+    };
+
+    // bump whenever RailPrimitive or the serialized layout changes
+    static constexpr std::uint32_t c_VERSION = 1;
+
+    // false if the meshes have nothing at ball height that looks like a table in table coordinates
+    static bool Bake(const std::vector<RailMeshView>& meshes, RailGeometry& out);
+
+    // replace the primitives and rebuild the grid
+    void SetPrimitives(std::vector<RailPrimitive> primitives);
+    const std::vector<RailPrimitive>& GetPrimitives() const { return m_primitives; }
+    bool IsEmpty() const { return m_primitives.empty(); }
+    int GetSegmentCount() const;
+    int GetArcCount() const;
+
+    // circle of radius moving from (x, y) by (dx, dy), true if it touches a rail it is moving into
+    bool SweepCircle(float x, float y, float dx, float dy, float radius, Hit& hit) const;
+    // primitives that may come within a ball radius of the box, each once, in index order
+    void Query(float minX, float minY, float maxX, float maxY, std::vector<int>& out) const;
+    // unit normal from the closest point of a primitive to (x, y), returns the distance between them
+    float GetNormal(int primitive, float x, float y, float& nx, float& ny) const;
+
+    // whether the direction from an arc's centre to (x, y) falls inside the arc
+    static bool IsWithinArc(const RailPrimitive& arc, float x, float y);
+    static void GetArcEnd(const RailPrimitive& arc, bool last, float& x, float& y);
+
+    void Serialize(std::vector<std::uint8_t>& out) const;
+    bool Deserialize(const std::uint8_t* data, std::size_t size);
+
+private:
+    void BuildGrid();
+    int CellX(float x) const;
+    int CellY(float y) const;
+
+    std::vector<RailPrimitive> m_primitives;
+
+    // cells in rows, the items of cell k are m_cellItems[m_cellStart[k] .. m_cellStart[k + 1])
+    float m_minX = 0.0f;
+    float m_minY = 0.0f;
+    float m_invCellSize = 0.0f;
+    int m_columns = 0;
+    int m_rows = 0;
+    std::vector<std::uint32_t> m_cellStart;
+    std::vector<std::uint32_t> m_cellItems;
+};
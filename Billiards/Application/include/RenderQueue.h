@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+
+class Shader;
+class Model;
+class InstanceBuffer;
+
+// Per-frame list of draws, sorted by GL state before anything is submitted.
+// Draws are recorded with small shader and material ids and get a 64 bit sort key, most expensive state in
+// the highest bits: shader, vertex array, material, geometry. Flush radix sorts the keys and walks the draws
+// in order, only binding what differs from the previous draw.
+// Single draws are culled per mesh against the view frustum on the way. Draws recorded with an occlusion test
+// (large environment models) sort after everything else and also skip meshes whose bounding box was hidden
+// last frame, found with hardware occlusion queries that are read back a frame late so they never stall.
+class RenderQueue
+{
+public:
+    static constexpr std::uint16_t c_NO_OCCLUSION_TEST = 0xFFFF;
+
+    // per-draw uniforms of model.vert/model.frag
+    struct Material
+    {
+        glm::vec3 color = glm::vec3(1.0f);
+        bool uniformScale = true; // every instance has uniform scale, see model.vert
+    };
+
+    // counted by the last Flush
+    struct Stats
+    {
+        int items = 0;
+        int drawCalls = 0;
+        int shaderBinds = 0;
+        int vertexArrayBinds = 0;
+        int materialChanges = 0;
+        int culledMeshes = 0;      // outside the frustum
+        int occludedMeshes = 0;    // inside the frustum but hidden last frame
+        int occlusionQueries = 0;  // bounding boxes issued for next frame
+    };
+
+    RenderQueue();
+    ~RenderQueue();
+
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    // register once at startup, the ids are what draws are recorded with
+    std::uint8_t AddShader(const Shader& shader);
+    std::uint16_t AddMaterial(const Material& material);
+    // query state for one object drawn every frame, the id is passed along with its draws
+    std::uint16_t AddOcclusionTest();
+
+    // camera of the frame, before the first submit
+    void SetView(const glm::mat4& viewProjection, const glm::vec3& viewPosition);
+    void SetOcclusionCulling(bool enabled) { m_occlusionCulling = enabled; }
+    bool IsOcclusionCulling() const { return m_occlusionCulling; }
+    const Frustum& GetFrustum() const { return m_frustum; }
+
+    // draw every mesh of model once with a constant transform, meshes outside the frustum are skipped
+    void Submit(std::uint8_t shader, std::uint16_t material, const Model& model,
+                const glm::mat4& transform, const glm::mat3& normalMatrix,
+                std::uint16_t occlusionTest = c_NO_OCCLUSION_TEST);
+    // draw every mesh of model once per instance written to the buffer, the caller culls the instances
+    // instanceCount draws only the first instances of the buffer, -1 draws all of them
+    void SubmitInstanced(std::uint8_t shader, std::uint16_t material, const Model& model, const InstanceBuffer& instances,
+                         int instanceCount = -1);
+
+    // sort and issue the recorded draws, then clear them
+    void Flush();
+    // free the GL objects while the context and the geometry arena still exist
+    void Shutdown();
+
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    struct ShaderEntry
+    {
+        unsigned int program;
+        int colorLocation;
+        int uniformScaleLocation;
+    };
+
+    struct Item
+    {
+        const Model* model;
+        const InstanceBuffer* instances; // null for single draws
+        int instanceCount;
+        glm::mat4 transform;
+        glm::mat3 normalMatrix;
+        std::uint8_t shader;
+        std::uint16_t material;
+        std::uint16_t occlusionTest;
+    };
+
+    struct SortEntry
+    {
+        std::uint64_t key;
+        std::uint32_t item;
+    };
+
+    // one query per mesh of the tested model, resized when the model behind the id changes
+    struct OcclusionTest
+    {
+        std::vector<unsigned int> queries;
+        std::vector<std::uint8_t> pending;  // query issued, result not read yet
+        std::vector<std::uint8_t> visible;  // last result, meshes start out visible
+    };
+
+    void Record(const Item& item);
+    static std::uint64_t MakeKey(const Item& item);
+    // least significant digit first, 8 bits per pass, passes where every key has the same digit are skipped
+    static void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+    // world space boxes of every mesh of the item into m_boxes, the frustum result into m_meshVisible
+    void CullMeshes(const Item& item);
+    void ReadOcclusionResults();
+    // bounding boxes of the frustum visible meshes of item, against the depth of the finished frame
+    void IssueOcclusionQueries(const Item& item);
+    void ResizeOcclusionTest(OcclusionTest& test, int meshCount);
+
+    std::vector<ShaderEntry> m_shaders;
+    std::vector<Material> m_materials;
+    std::vector<Item> m_items;
+    std::vector<SortEntry> m_order;
+    std::vector<SortEntry> m_scratch;
+    Stats m_stats;
+
+    Frustum m_frustum;
+    glm::vec3 m_viewPosition = glm::vec3(0.0f);
+    std::vector<float> m_boxCenterX, m_boxCenterY, m_boxCenterZ;
+    std::vector<float> m_boxExtentX, m_boxExtentY, m_boxExtentZ;
+    std::vector<std::uint8_t> m_meshVisible;
+
+    bool m_occlusionCulling = true;
+    std::vector<OcclusionTest> m_occlusionTests;
+    std::vector<std::uint32_t> m_testedItems; // drawn this flush, queried after the last draw
+    std::unique_ptr<Model> m_occlusionBox; // unit box drawn scaled to each tested bounding box
+};
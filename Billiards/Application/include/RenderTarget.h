@@ -0,0 +1,33 @@
+#pragma once
+
+// Offscreen framebuffer with a colour texture and a depth renderbuffer.
+// Used to render without a visible window and to read frames back for capture.
+class RenderTarget
+{
+public:
+    RenderTarget(int width, int height);
+    ~RenderTarget();
+
+    RenderTarget(const RenderTarget&) = delete;
+    RenderTarget& operator=(const RenderTarget&) = delete;
+    RenderTarget(RenderTarget&&) = delete;
+    RenderTarget& operator=(RenderTarget&&) = delete;
+
+    // bind as the draw framebuffer and set the viewport to cover it
+    void Bind() const;
+    void Unbind() const;
+
+    // read the colour buffer back and write it as a PNG, returns false if the file could not be written
+    bool SaveImage(const char* path) const;
+
+    unsigned int GetColorTexture() const { return m_colorTexture; }
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+
+private:
+    unsigned int m_framebuffer = 0;
+    unsigned int m_colorTexture = 0;
+    unsigned int m_depthBuffer = 0;
+    int m_width;
+    int m_height;
+};
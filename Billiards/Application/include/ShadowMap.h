@@ -0,0 +1,54 @@
+#pragma once
+
+// texture unit model.frag samples the shadow map from, above the units materials use
+constexpr unsigned int c_SHADOW_MAP_UNIT = 7;
+
+// Depth map of the table light, split into a cached static map and a per-frame composite.
+// Static geometry (table, rails, room) is drawn into the static map only after InvalidateStatic. Every frame
+// the static depth is copied into the composite map and only the moving objects are drawn on top of it, so a
+// frame costs one copy and a few balls instead of the whole scene. Shaders sample the composite map through a
+// sampler2DShadow, the light's view-projection matrix is part of FrameUniforms.
+class ShadowMap
+{
+public:
+    static constexpr int c_DEFAULT_SIZE = 2048;
+
+    explicit ShadowMap(int size = c_DEFAULT_SIZE);
+    ~ShadowMap();
+
+    ShadowMap(const ShadowMap&) = delete;
+    ShadowMap& operator=(const ShadowMap&) = delete;
+    ShadowMap(ShadowMap&&) = delete;
+    ShadowMap& operator=(ShadowMap&&) = delete;
+
+    // the static map is redrawn before the next frame's dynamic pass
+    void InvalidateStatic() { m_staticValid = false; }
+    bool IsStaticValid() const { return m_staticValid; }
+
+    // bind the cleared static map for drawing, the framebuffer and viewport in use are restored by End
+    void BeginStatic();
+    // copy the static depth into the composite map and bind it for drawing the dynamic objects
+    void BeginDynamic();
+    void End();
+
+    void Bind(unsigned int unit = c_SHADOW_MAP_UNIT) const;
+
+    int GetSize() const { return m_size; }
+
+private:
+    // remember the framebuffer and viewport End restores
+    void SaveState();
+    void Begin(unsigned int framebuffer);
+
+    enum Map { Static = 0, Composite = 1 };
+
+    unsigned int m_textures[2] = {};
+    unsigned int m_framebuffers[2] = {};
+    int m_size;
+    bool m_staticValid = false;
+    bool m_drawingStatic = false;
+
+    // restored by End
+    int m_previousFramebuffer = 0;
+    int m_previousViewport[4] = {};
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PhysicsWorld.h"
+
+// Binary log of a deterministic run: the strikes that drove it and periodic keyframes of the world.
+// After a small header every record is a type byte and a LEB128 varint step, the step count since the
+// previous record or the absolute step for keyframes, followed by the payload. Strikes only store the shot
+// parameters that changed since the previous strike and keyframes only the non-zero velocities of each ball,
+// so a table at rest costs a few bytes per ball. Every keyframe resets the delta base, so decoding can start
+// at any keyframe, which is what seeking builds on. Floats are stored as their exact bits, little endian.
+class ShotLog
+{
+public:
+    static constexpr std::uint32_t c_DEFAULT_KEYFRAME_INTERVAL = 960; // steps, a second at the default step
+    static constexpr std::uint16_t c_VERSION = 1;
+
+    enum class RecordType : std::uint8_t
+    {
+        Keyframe = 1,
+        Strike = 2,
+        End = 3 // the step the recording stopped at
+    };
+
+    struct Record
+    {
+        RecordType type = RecordType::End;
+        std::uint64_t step = 0;
+        int ball = 0;      // strikes
+        CueShot shot;      // strikes
+        WorldState state;  // keyframes
+    };
+
+    // decoding position, Begin or FindKeyframe create one
+    struct Cursor
+    {
+        std::size_t offset = 0;
+        std::uint64_t step = 0;
+        CueShot lastShot;
+    };
+
+    // recording, on the thread that owns the world, which should be deterministic
+    void Begin(const PhysicsWorld& world, std::uint32_t keyframeInterval = c_DEFAULT_KEYFRAME_INTERVAL);
+    // before the strike is applied to the world
+    void RecordStrike(const PhysicsWorld& world, int ball, const CueShot& shot);
+    // after the world advanced, adds a keyframe once an interval has passed while the balls are moving
+    void RecordTick(const PhysicsWorld& world);
+    void End(const PhysicsWorld& world);
+
+    bool Save(const std::string& path) const;
+    // false if the file is missing, not a shot log of this version or truncated
+    bool Load(const std::string& path);
+
+    float GetFixedStep() const { return m_fixedStep; }
+    std::uint64_t GetFirstStep() const { return m_keyframes.empty() ? 0 : m_keyframes.front().step; }
+    std::uint64_t GetLastStep() const { return m_lastStep; }
+    std::size_t GetSize() const { return m_data.size(); }
+    int GetKeyframeCount() const { return static_cast<int>(m_keyframes.size()); }
+    int GetStrikeCount() const { return m_strikeCount; }
+
+    // cursor at the last keyframe at or before step, the first keyframe if there is none
+    Cursor FindKeyframe(std::uint64_t step) const;
+    // decode the record at the cursor and move past it, false at the end of the log
+    bool ReadRecord(Cursor& cursor, Record& record) const;
+
+private:
+    struct KeyframeEntry
+    {
+        std::uint64_t step;
+        std::size_t offset;
+    };
+
+    void WriteKeyframe(const PhysicsWorld& world);
+
+    std::vector<std::uint8_t> m_data; // header and records, exactly as written to the file
+    std::vector<KeyframeEntry> m_keyframes;
+    float m_fixedStep = 0.0f;
+    std::uint32_t m_keyframeInterval = c_DEFAULT_KEYFRAME_INTERVAL;
+    std::uint64_t m_lastStep = 0; // of the newest record
+    int m_strikeCount = 0;
+
+    // recording state
+    CueShot m_lastShot;
+    std::uint64_t m_nextKeyframe = 0;
+    bool m_ended = false;
+};
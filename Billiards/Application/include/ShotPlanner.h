@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "BatchSimulator.h"
+
+// the shot a search settled on
+struct ShotPlan
+{
+    CueShot shot;
+    float score = 0.0f;     // expected score over the noisy executions of the shot
+    float potChance = 0.0f; // share of those executions that pot a ball without losing the cue ball
+    int evaluated = 0;      // shots simulated by the search
+    float searchTime = 0.0f; // seconds
+};
+
+// how wide a search looks, every round is one batch on the simulator
+struct ShotPlannerSettings
+{
+    int samples = 4096;       // first, broad round
+    int candidates = 8;       // distinct shots refined after it
+    int refineIterations = 5;
+    int refineSamples = 256;  // per candidate and iteration
+    int eliteCount = 24;      // per candidate, the samples the next distribution is fitted to
+    int noiseSamples = 64;    // per finalist
+    float maxSpeed = 6.0f;    // m/s
+    float maxSpin = 0.8f;     // cue tip offset in radii
+    std::uint32_t seed = 1;   // the same table and seed always give the same plan
+};
+
+// Chooses cue shots by simulating them.
+// A search samples angle, speed and spin, half of them aimed through the ghost ball of every object ball and
+// pocket pair and half at random, and plays all of them headless on the batch simulator. Results are scored by
+// the balls they pot, a lost cue ball and how easy the next shot looks from where the cue ball stops. The best
+// distinct shots are refined with a few rounds of the cross-entropy method, and the finalists are replayed
+// with execution noise so the plan favours shots that still work when hit slightly off.
+// Searches run on a thread of their own so the game loop can keep drawing while one runs.
+class ShotPlanner
+{
+public:
+    explicit ShotPlanner(unsigned threadCount = 0, const ShotPlannerSettings& settings = ShotPlannerSettings()); // 0 uses every hardware thread
+    ~ShotPlanner();
+
+    ShotPlanner(const ShotPlanner&) = delete;
+    ShotPlanner& operator=(const ShotPlanner&) = delete;
+    ShotPlanner(ShotPlanner&&) = delete;
+    ShotPlanner& operator=(ShotPlanner&&) = delete;
+
+    // blocking search on the calling thread, not while an asynchronous one runs
+    ShotPlan Plan(const TableState& table, int cueBall = 0);
+
+    // search on the planner thread, ignored while one is still running
+    void Start(const TableState& table, int cueBall = 0);
+    bool IsSearching() const { return m_searching; }
+    // hands out the plan of a finished search once
+    bool Poll(ShotPlan& plan);
+
+    // any thread, the cushions the next search plays against
+    void SetRailGeometry(std::shared_ptr<const RailGeometry> rails);
+
+    const ShotPlannerSettings& GetSettings() const { return m_settings; }
+    void SetSettings(const ShotPlannerSettings& settings) { m_settings = settings; }
+    int GetWorkerCount() const { return m_simulator.GetWorkerCount(); }
+
+    // score of a finished shot, also used to judge shots that were actually played
+    static float Score(const TableState& before, const TableState& after, int cueBall);
+
+private:
+    // a shot as a point in the search space
+    struct Params
+    {
+        float angle, speed, sideSpin, topSpin;
+    };
+
+    // every shot of a round in one batch, so the pool always has enough of them to spread
+    void Evaluate(const std::vector<Params>& params, std::vector<float>& scores);
+    Params Clamp(Params params) const;
+    static CueShot ToShot(const Params& params);
+    // the easiest pot left for the cue ball, 0 without any
+    static float PositionScore(const TableState& table, int cueBall);
+
+    ShotPlannerSettings m_settings;
+    BatchSimulator m_simulator;
+    std::mt19937 m_random;
+
+    // the search being run, one at a time
+    TableState m_table;
+    int m_cueBall = 0;
+    std::vector<ShotRequest> m_requests;
+    std::vector<ShotResult> m_results;
+    int m_evaluated = 0;
+
+    std::thread m_thread;
+    std::atomic<bool> m_searching{ false };
+    std::mutex m_resultMutex;
+    ShotPlan m_result; // guarded by the mutex
+    bool m_hasResult = false;
+    std::shared_ptr<const RailGeometry> m_rails; // guarded by the mutex, picked up when a search starts
+};
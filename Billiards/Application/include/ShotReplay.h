@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+#include "ShotLog.h"
+
+class PhysicsWorld;
+
+// Plays a ShotLog back on a PhysicsWorld.
+// The world is stepped exactly like the recording and every strike is applied at the step it was recorded
+// at. Seek restores the last keyframe before the target and steps on from there, so any step of a match is
+// at most a keyframe interval of simulation away. Keyframes passed while playing forward are compared with
+// the world bit for bit, the first mismatch is the step where this build diverges from the recording.
+class ShotReplay
+{
+public:
+    // the world is made deterministic and must use the log's fixed step, throws std::runtime_error otherwise
+    ShotReplay(const ShotLog& log, PhysicsWorld& world);
+
+    void Seek(std::uint64_t step);
+    // step the world, applying the recorded strikes on the way, returns false once the end of the log is reached
+    bool Advance(std::uint64_t steps);
+    // advance by simulated seconds, left over time carries into the next call
+    bool AdvanceTime(float seconds);
+
+    bool IsFinished() const { return m_finished; }
+    std::uint64_t GetStep() const;
+    std::uint64_t GetFirstStep() const { return m_log.GetFirstStep(); }
+    std::uint64_t GetLastStep() const { return m_log.GetLastStep(); }
+
+    int GetVerifiedKeyframes() const { return m_verifiedKeyframes; }
+    int GetMismatchCount() const { return m_mismatchCount; }
+    std::uint64_t GetFirstMismatchStep() const { return m_firstMismatchStep; }
+
+private:
+    void ReadNext();
+    void Apply(const ShotLog::Record& record);
+    bool Matches(const WorldState& state) const;
+
+    const ShotLog& m_log;
+    PhysicsWorld& m_world;
+
+    ShotLog::Cursor m_cursor;
+    ShotLog::Record m_next; // first record not applied yet
+    bool m_hasNext = false;
+    bool m_finished = false;
+    float m_timeAccumulator = 0.0f;
+
+    int m_verifiedKeyframes = 0;
+    int m_mismatchCount = 0;
+    std::uint64_t m_firstMismatchStep = 0;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "PhysicsWorld.h"
+#include "TripleBuffer.h"
+
+// Runs a PhysicsWorld on its own thread at a fixed tick rate.
+// After every tick the thread publishes a snapshot of the balls through a triple buffer, so the render thread
+// never waits on physics and a slow frame never holds up the simulation. The render thread keeps the two
+// newest snapshots it has seen and draws a blend of them on a clock that trails the simulation by one tick.
+// Changes to the world are queued as commands and run on the simulation thread before its next tick.
+class SimulationThread
+{
+public:
+    using Command = std::function<void(PhysicsWorld&)>;
+
+    // the world must outlive the thread and is only touched by it between Start and Stop
+    SimulationThread(PhysicsWorld& world, double tickRate);
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+    SimulationThread(SimulationThread&&) = delete;
+    SimulationThread& operator=(SimulationThread&&) = delete;
+
+    void Start();
+    // joins the thread and runs the commands it did not get to
+    void Stop();
+    bool IsRunning() const { return m_thread.joinable(); }
+
+    // any thread, the command sees the world between two ticks
+    void Submit(Command command);
+    // runs on the simulation thread after every tick, set before Start
+    void SetTickHook(Command hook) { m_tickHook = std::move(hook); }
+
+    // render thread, advances the render clock by deltaTime and blends the two newest snapshots at it
+    void Interpolate(float deltaTime, PhysicsSnapshot& out);
+    // render thread, the newest snapshot picked up by Interpolate
+    const PhysicsSnapshot& GetLatest() const { return m_latest; }
+
+    double GetTickRate() const { return m_tickRate; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void Loop();
+    void RunCommands();
+
+    PhysicsWorld& m_world;
+    double m_tickRate;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{ false };
+
+    std::mutex m_commandMutex;
+    std::vector<Command> m_commands;  // queued, guarded by the mutex
+    std::vector<Command> m_executing; // simulation thread only
+    Command m_tickHook;
+    std::uint64_t m_commandCount = 0; // simulation thread only
+
+    TripleBuffer<PhysicsSnapshot> m_snapshots;
+
+    // render thread only
+    PhysicsSnapshot m_previous;
+    PhysicsSnapshot m_latest;
+    float m_renderTime = 0.0f; // simulated time being drawn
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+// Include before any code that has to produce bit-identical results on every run and build, the physics
+// step and everything recorded in a shot log. It stops the compiler from contracting a * b + c into a fused
+// multiply-add, which rounds once instead of twice and so depends on the target and the optimizer.
+// The project builds with /fp:precise, so nothing else is reordered.
+#if defined(_MSC_VER) && !defined(__clang__)
+#pragma fp_contract(off)
+#elif defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glad/gl.h>
+
+// decoded image in CPU memory, 8 bits per channel, rows top to bottom as stored in the file
+struct TextureData
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0; // 1 to 4
+    std::vector<unsigned char> pixels;
+
+    std::size_t GetSize() const { return pixels.size(); }
+};
+
+// 2D texture with mipmaps.
+// Decoding touches no GL state and can run on any thread, the upload has to happen on the GL thread.
+class Texture
+{
+public:
+    Texture() = default;
+    // pixels is read like glTexImage2D does, as an offset into the bound GL_PIXEL_UNPACK_BUFFER if there is one
+    Texture(int width, int height, int channels, const void* pixels);
+    ~Texture()
+    {
+        Cleanup();
+    }
+
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+    Texture(Texture&& texture) noexcept;
+    Texture& operator=(Texture&& texture) noexcept;
+
+    // read and decode an image file, returns false if it can not be read
+    static bool Decode(const std::string& path, TextureData& outData);
+
+    void Bind(unsigned int unit) const;
+
+    GLuint GetId() const { return m_texture; }
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+
+private:
+    void Cleanup()
+    {
+        if (m_texture != 0)
+            glDeleteTextures(1, &m_texture);
+        m_texture = 0;
+    }
+
+    GLuint m_texture = 0;
+    int m_width = 0;
+    int m_height = 0;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool.
+// Every worker owns a task queue. Submitted tasks are spread round robin over the queues, a worker takes
+// the newest task from its own queue and steals the oldest task from another queue when its own runs dry.
+// Tasks receive the index of the worker running them so they can use per-worker scratch data.
+class ThreadPool
+{
+public:
+    using Task = std::function<void(int worker)>;
+
+    explicit ThreadPool(unsigned threadCount = 0); // 0 uses one worker per hardware thread
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    int GetWorkerCount() const { return static_cast<int>(m_threads.size()); }
+
+    void Submit(Task task);
+    // block until every submitted task has finished
+    void Wait();
+    // run body over [0, count) in chunks of grain items and wait for those chunks only
+    // a worker of this pool may call it too, it runs queued tasks on its own index while it waits
+    void ParallelFor(int count, int grain, const std::function<void(int begin, int end, int worker)>& body);
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void WorkerLoop(int index);
+    bool TryPop(int index, Task& task);
+    bool TrySteal(int thief, Task& task);
+    // run a dequeued task and mark it finished
+    void Run(Task& task, int worker);
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake; // signalled when work is queued or the pool stops
+    std::condition_variable m_done; // signalled when the last pending task or the last chunk of a ParallelFor finishes
+    std::atomic<int> m_queued{ 0 };  // tasks sitting in a queue
+    std::atomic<int> m_pending{ 0 }; // tasks queued or running
+    std::atomic<unsigned> m_nextQueue{ 0 };
+    bool m_stopping = false;
+};
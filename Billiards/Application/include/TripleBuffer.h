@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer for one writer and one reader thread.
+// The writer fills its back slot and publishes it by swapping it with the shared middle slot, the reader
+// swaps the middle slot into its front slot when a newer value is there. Neither side ever waits, the
+// writer overwrites values the reader was too slow to pick up and the reader keeps its last value until a
+// newer one arrives.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+    TripleBuffer(TripleBuffer&&) = delete;
+    TripleBuffer& operator=(TripleBuffer&&) = delete;
+
+    // writer thread, the slot stays the writer's until Publish
+    T& GetWriteBuffer() { return m_slots[m_back].value; }
+
+    void Publish()
+    {
+        // release makes the written value visible to the reader that acquires the index
+        const std::uint8_t previous = m_middle.exchange(static_cast<std::uint8_t>(m_back | c_FRESH), std::memory_order_acq_rel);
+        m_back = previous & c_INDEX_MASK;
+    }
+
+    // reader thread, true if a value newer than the current front was published
+    bool Acquire()
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & c_FRESH))
+            return false;
+        const std::uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = previous & c_INDEX_MASK;
+        return true;
+    }
+
+    // reader thread, the value of the last successful Acquire
+    const T& GetReadBuffer() const { return m_slots[m_front].value; }
+
+private:
+    static constexpr std::uint8_t c_INDEX_MASK = 3;
+    static constexpr std::uint8_t c_FRESH = 4; // the middle slot holds a value the reader has not seen
+
+    // each slot on its own cache lines, so the writer never shares a line with the value being read
+    struct alignas(64) Slot
+    {
+        T value{};
+    };
+
+    Slot m_slots[3];
+    alignas(64) std::atomic<std::uint8_t> m_middle{ 1 };
+    alignas(64) std::uint8_t m_back = 0;  // writer only
+    alignas(64) std::uint8_t m_front = 2; // reader only
+};
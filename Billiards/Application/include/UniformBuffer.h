@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+// uniform buffer binding points shared by every shader
+constexpr unsigned int c_FRAME_UNIFORM_BINDING = 0;
+
+// Per-frame camera and light data, the std140 "FrameData" block in the shaders.
+// Only mat4 and vec4 members so the C++ layout matches std140 without padding.
+struct FrameUniforms
+{
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    glm::vec4 viewPosition = glm::vec4(0.0f); // w unused
+    glm::vec4 lightPosition = glm::vec4(0.0f);
+    glm::vec4 lightColor = glm::vec4(1.0f);
+    glm::mat4 lightViewProjection = glm::mat4(1.0f); // shadow map clip space, see ShadowMap
+};
+
+// GL uniform buffer bound to a fixed binding point for its whole lifetime.
+// Shaders attach their blocks to the same binding point with Shader::BindUniformBlock.
+class UniformBuffer
+{
+public:
+    UniformBuffer(std::size_t size, unsigned int bindingPoint);
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+    UniformBuffer(UniformBuffer&&) = delete;
+    UniformBuffer& operator=(UniformBuffer&&) = delete;
+
+    // replace the start of the buffer, size must not exceed the size the buffer was created with
+    void Update(const void* data, std::size_t size) const;
+
+    template <typename T>
+    void Update(const T& data) const { Update(&data, sizeof(T)); }
+
+    unsigned int GetBindingPoint() const { return m_bindingPoint; }
+
+private:
+    unsigned int m_buffer = 0;
+    std::size_t m_size;
+    unsigned int m_bindingPoint;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum class BallState : std::uint8_t;
+
+// Broadphase for ball-ball collisions.
+// Balls are binned into square cells and sorted by cell index. With the cell size at least the distance looked
+// for, two balls that close are always in the same or in neighbouring cells, so only those are paired up.
+// Cells are numbered row by row, so the three neighbours in the next row are one contiguous key range and
+// the cost depends on the number of balls, not on the size of the table.
+class UniformGrid
+{
+public:
+    UniformGrid(float minX, float minY, float maxX, float maxY, float cellSize);
+
+    // bin every ball that is still in play
+    void Build(const float* posX, const float* posY, const BallState* states, int count);
+    // every pair sharing or neighbouring a cell, each pair once, in a fixed order for a given input
+    void FindCandidatePairs(std::vector<int>& pairA, std::vector<int>& pairB) const;
+    // every binned ball in the cell of (x, y) and the cells around it
+    void FindNear(float x, float y, std::vector<int>& out) const;
+
+    int GetColumns() const { return m_columns; }
+    int GetRows() const { return m_rows; }
+
+private:
+    int CellOf(float x, float y) const;
+
+    float m_minX;
+    float m_minY;
+    float m_invCellSize;
+    int m_columns;
+    int m_rows;
+
+    // (cell << 32 | ball) for every binned ball, sorted, so equal cells are contiguous and ordered by ball
+    std::vector<std::uint64_t> m_entries;
+};
@@ -1,3 +1,5 @@
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
@@ -7,11 +9,129 @@ static constexpr auto g_windowTitle = "Billiards Simulation";
 static constexpr int g_windowWidth = 1280;
 static constexpr int g_windowHeight = 720;
 
+static void PrintUsage(const char* program)
+{
+	std::cout << "Usage: " << program << " [options]\n"
+		<< "  --headless           run input and physics only, no window, GL context or ImGui\n"
+		<< "  --offscreen          render into a hidden framebuffer instead of a window\n"
+		<< "  --frames <n>         frames to run without a window (default: until the table is at rest)\n"
+		<< "  --dt <seconds>       fixed frame time without a window (default: 1/60)\n"
+		<< "  --break <speed>      strike the cue ball into the rack at startup, in m/s\n"
+		<< "  --capture <prefix>   offscreen only, write frames to <prefix>_<frame>.png\n"
+		<< "  --capture-every <n>  capture every n-th frame (default: 1)\n"
+		<< "  --size <w> <h>       window or framebuffer size\n"
+		<< "  --table <path>       model file for the table, loaded in the background\n"
+		<< "  --pacing <mode>      windowed frame pacing: uncapped, adaptive (default) or fixed\n"
+		<< "  --fps <rate>         target rate of fixed pacing (default: 60)\n"
+		<< "  --trace <path>       write the last profiled frames as Chrome trace JSON at exit\n"
+		<< "  --serial-physics     step physics on the render thread instead of its own\n"
+		<< "  --tick-rate <hz>     tick rate of the physics thread (default: 120)\n"
+		<< "  --deterministic      bit-reproducible physics, fixed substeps on the scalar kernel\n"
+		<< "  --record <path>      write the strikes and keyframes of the run as a shot log at exit\n"
+		<< "  --replay <path>      play a shot log back, with --headless as fast as possible and verified\n"
+		<< "  --ai                 let the shot planner play until the table is cleared\n";
+}
+
+// returns false if the command line is invalid or only asked for help
+static bool ParseCommandLine(int argc, char** argv, ApplicationConfig& config)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const int remaining = argc - i - 1;
+
+		if (std::strcmp(arg, "--headless") == 0)
+			config.mode = RunMode::Headless;
+		else if (std::strcmp(arg, "--offscreen") == 0)
+			config.mode = RunMode::Offscreen;
+		else if (std::strcmp(arg, "--frames") == 0 && remaining >= 1)
+			config.frameCount = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--dt") == 0 && remaining >= 1)
+			config.fixedDeltaTime = static_cast<float>(std::atof(argv[++i]));
+		else if (std::strcmp(arg, "--break") == 0 && remaining >= 1)
+			config.breakSpeed = static_cast<float>(std::atof(argv[++i]));
+		else if (std::strcmp(arg, "--capture") == 0 && remaining >= 1)
+			config.capturePrefix = argv[++i];
+		else if (std::strcmp(arg, "--capture-every") == 0 && remaining >= 1)
+			config.captureInterval = std::atoi(argv[++i]);
+		else if (std::strcmp(arg, "--table") == 0 && remaining >= 1)
+			config.tableModel = argv[++i];
+		else if (std::strcmp(arg, "--pacing") == 0 && remaining >= 1)
+		{
+			const char* mode = argv[++i];
+			if (std::strcmp(mode, "uncapped") == 0)
+				config.pacing = PacingMode::Uncapped;
+			else if (std::strcmp(mode, "adaptive") == 0)
+				config.pacing = PacingMode::AdaptiveVsync;
+			else if (std::strcmp(mode, "fixed") == 0)
+				config.pacing = PacingMode::FixedRate;
+			else
+			{
+				std::cerr << "Unknown pacing mode: " << mode << "\n";
+				PrintUsage(argv[0]);
+				return false;
+			}
+		}
+		else if (std::strcmp(arg, "--fps") == 0 && remaining >= 1)
+			config.targetFrameRate = std::atof(argv[++i]);
+		else if (std::strcmp(arg, "--trace") == 0 && remaining >= 1)
+			config.tracePath = argv[++i];
+		else if (std::strcmp(arg, "--serial-physics") == 0)
+			config.threadedPhysics = false;
+		else if (std::strcmp(arg, "--tick-rate") == 0 && remaining >= 1)
+			config.physicsTickRate = std::atof(argv[++i]);
+		else if (std::strcmp(arg, "--deterministic") == 0)
+			config.deterministic = true;
+		else if (std::strcmp(arg, "--record") == 0 && remaining >= 1)
+			config.recordPath = argv[++i];
+		else if (std::strcmp(arg, "--replay") == 0 && remaining >= 1)
+			config.replayPath = argv[++i];
+		else if (std::strcmp(arg, "--ai") == 0)
+			config.autoPlay = true;
+		else if (std::strcmp(arg, "--size") == 0 && remaining >= 2)
+		{
+			config.windowWidth = std::atoi(argv[++i]);
+			config.windowHeight = std::atoi(argv[++i]);
+		}
+		else
+		{
+			if (std::strcmp(arg, "--help") != 0)
+				std::cerr << "Unknown or incomplete option: " << arg << "\n";
+			PrintUsage(argv[0]);
+			return false;
+		}
+	}
+
+	if (config.fixedDeltaTime <= 0.0f || config.captureInterval < 1 || config.windowWidth <= 0 || config.windowHeight <= 0
+		|| config.targetFrameRate <= 0.0 || config.physicsTickRate <= 0.0)
+	{
+		std::cerr << "Frame time, capture interval, size, frame rate and tick rate must be positive.\n";
+		return false;
+	}
+	if (config.capturePrefix && config.mode != RunMode::Offscreen)
+		std::cerr << "Warning: --capture only applies to --offscreen runs.\n";
+	if (config.recordPath && config.replayPath)
+	{
+		std::cerr << "--record and --replay can not be combined.\n";
+		return false;
+	}
+	if (config.autoPlay && config.replayPath)
+		std::cerr << "Warning: --ai does not play during a --replay, the log decides every shot.\n";
+	return true;
+}
+
 int main(int argc, char** argv)
 {
+	ApplicationConfig config;
+	config.windowWidth = g_windowWidth;
+	config.windowHeight = g_windowHeight;
+	config.windowTitle = g_windowTitle;
+	if (!ParseCommandLine(argc, argv, config))
+		return EXIT_FAILURE;
+
 	try
 	{
-		Application app(g_windowWidth, g_windowHeight, g_windowTitle);
+		Application app(config);
 		app.Run();
 	}
 	catch (const std::exception& e)
@@ -3,35 +3,66 @@ out vec4 FragColor;
 
 in vec3 FragPos_World;
 in vec3 Normal_World;
+flat in uint BallId;
+in vec4 FragPos_Light;
 // in vec2 TexCoords_Out; // If using textures
 
+// per-frame camera and light data, must match the block in model.vert
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPos_World;  // Camera position in world space
+    vec4 lightPos_World; // Light position in world space
+    vec4 lightColor;
+    mat4 lightViewProjection;
+};
+
 // Uniforms for simple lighting
-uniform vec3 objectColor;
-uniform vec3 lightColor;
-uniform vec3 lightPos_World; // Light position in world space
-uniform vec3 viewPos_World;  // Camera position in world space
+uniform vec3 objectColor;        // colour of everything that is not a ball
+uniform vec3 ballColors[16];     // indexed by ball id
+uniform sampler2DShadow shadowMap; // depth seen from the light, see ShadowMap
+
+// fraction of the light reaching the fragment, nine bilinear comparisons around the projected position
+float ShadowFactor(vec3 norm, vec3 lightDir)
+{
+    vec3 coords = FragPos_Light.xyz / FragPos_Light.w * 0.5 + 0.5;
+    if (coords.z > 1.0)
+        return 1.0; // beyond the light's far plane
+
+    // surfaces at a grazing angle to the light need more bias
+    float bias = max(0.002 * (1.0 - dot(norm, lightDir)), 0.0005);
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0));
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x++)
+        for (int y = -1; y <= 1; y++)
+            lit += texture(shadowMap, vec3(coords.xy + vec2(x, y) * texel, coords.z - bias));
+    return lit / 9.0;
+}
 
 void main() 
 {
     // Ambient
     float ambientStrength = 0.1;
-    vec3 ambient = ambientStrength * lightColor;
+    vec3 ambient = ambientStrength * lightColor.rgb;
 
     // Diffuse
     vec3 norm = normalize(Normal_World);
-    vec3 lightDir = normalize(lightPos_World - FragPos_World);
+    vec3 lightDir = normalize(lightPos_World.xyz - FragPos_World);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diff * lightColor;
+    vec3 diffuse = diff * lightColor.rgb;
 
     // Specular (simple Blinn-Phong like)
     float specularStrength = 0.5;
-    vec3 viewDir = normalize(viewPos_World - FragPos_World);
+    vec3 viewDir = normalize(viewPos_World.xyz - FragPos_World);
     vec3 reflectDir = reflect(-lightDir, norm); // Or use halfway vector for Blinn-Phong
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32); // 32 is shininess
-    vec3 specular = specularStrength * spec * lightColor;
+    vec3 specular = specularStrength * spec * lightColor.rgb;
     
-    // final result
-    vec3 result = (ambient + diffuse + specular) * objectColor;
+    // final result, ambient light is the only part that reaches shadowed fragments
+    float shadow = ShadowFactor(norm, lightDir);
+    vec3 baseColor = BallId < 16u ? ballColors[BallId] : objectColor;
+    vec3 result = (ambient + shadow * (diffuse + specular)) * baseColor;
     FragColor = vec4(result, 1.0);
         // FragColor = vec4(objectColor, 1.0); // Or just fixed color for now
 }
\ No newline at end of file
@@ -1,20 +1,50 @@
 ﻿#version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;      // We'll add normals later
+layout (location = 1) in vec2 aNormal;    // octahedral encoded, see PackedVertex
 layout (location = 2) in vec2 aTexCoords; // We'll add tex coords later
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// per-instance data, see InstanceBuffer. Non-instanced draws set these as constant attributes
+layout (location = 3) in mat4 aInstanceModel; // locations 3 to 6
+layout (location = 7) in uint aBallId;
+layout (location = 8) in mat3 aInstanceNormal; // locations 8 to 10, inverse transpose computed on the CPU
+
+// per-frame camera and light data, shared by every shader through one uniform buffer
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPos_World;
+    vec4 lightPos_World;
+    vec4 lightColor;
+    mat4 lightViewProjection; // clip space of the table light's shadow map
+};
+
+// set for draws where every instance has uniform scale, the rotation part of the model matrix
+// then transforms normals correctly up to length and the normal matrix is not read at all
+uniform bool uniformScale;
 
 // To Fragment Shader
 out vec3 FragPos_World; // Vertex position in world space
 out vec3 Normal_World;  // Normal in world space
+flat out uint BallId;
+out vec4 FragPos_Light; // Vertex position in the shadow map's clip space
+
+// unfold the octahedron back onto the unit sphere
+vec3 DecodeNormal(vec2 encoded) {
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -fold : fold;
+    n.y += n.y >= 0.0 ? -fold : fold;
+    return normalize(n);
+}
 
 void main() {
-    FragPos_World = vec3(model * vec4(aPos, 1.0));
-    Normal_World = mat3(transpose(inverse(model))) * aNormal; // Transform normals correctly
+    vec3 normal = DecodeNormal(aNormal);
+    FragPos_World = vec3(aInstanceModel * vec4(aPos, 1.0));
+    Normal_World = uniformScale ? mat3(aInstanceModel) * normal : aInstanceNormal * normal;
+    BallId = aBallId;
+    FragPos_Light = lightViewProjection * vec4(FragPos_World, 1.0);
 
-    gl_Position = projection * view * vec4(FragPos_World, 1.0);
+    gl_Position = viewProjection * vec4(FragPos_World, 1.0);
     // TexCoords_Out = aTexCoords; // If using textures
 }
\ No newline at end of file
@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+// per-instance transform, see InstanceBuffer. Non-instanced draws set it as a constant attribute
+layout (location = 3) in mat4 aInstanceModel; // locations 3 to 6
+
+// per-frame camera and light data, must match the block in model.vert
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPos_World;
+    vec4 lightPos_World;
+    vec4 lightColor;
+    mat4 lightViewProjection;
+};
+
+void main() {
+    gl_Position = lightViewProjection * (aInstanceModel * vec4(aPos, 1.0));
+}
@@ -0,0 +1,247 @@
+#include "AssetManager.h"
+#include "ModelLoader.h"
+#include "Primitives.h"
+
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+AssetManager::AssetManager(unsigned threadCount)
+    : m_loaders(threadCount)
+{
+    std::vector<Mesh> meshes;
+    meshes.push_back(Primitives::CreateBox(1.0f, 1.0f, 1.0f));
+    m_placeholderModel = std::make_unique<Model>(std::move(meshes), "");
+
+    const unsigned char white[4] = { 255, 255, 255, 255 };
+    m_placeholderTexture = Texture(1, 1, 4, white);
+
+    glGenBuffers(c_PIXEL_BUFFER_COUNT, m_pixelBuffers);
+}
+
+AssetManager::~AssetManager()
+{
+    // queued loads are skipped, the pool joins its threads once the running ones return
+    m_stopping = true;
+    m_loaders.Wait();
+
+    glDeleteBuffers(c_PIXEL_BUFFER_COUNT, m_pixelBuffers);
+}
+
+ModelHandle AssetManager::LoadModel(const std::string& path)
+{
+    auto found = m_modelIndices.find(path);
+    if (found != m_modelIndices.end())
+        return { found->second };
+
+    const std::uint32_t index = static_cast<std::uint32_t>(m_models.size());
+    m_models.push_back(std::make_unique<ModelSlot>());
+    m_models.back()->path = path;
+    m_modelIndices.emplace(path, index);
+    m_pendingCount++;
+
+    m_loaders.Submit([this, index, path](int) {
+        LoadResult result{ AssetType::Model, index, false, {}, {}, {} };
+        if (!m_stopping)
+        {
+            // a table's cushions are read or baked here too, so the GL thread never waits on them
+            auto rails = std::make_shared<RailGeometry>();
+            result.succeeded = ModelLoader::LoadMeshData(path, result.meshes, rails.get());
+            if (!rails->IsEmpty())
+                result.rails = std::move(rails);
+        }
+        PushResult(std::move(result));
+    });
+    return { index };
+}
+
+TextureHandle AssetManager::LoadTexture(const std::string& path)
+{
+    auto found = m_textureIndices.find(path);
+    if (found != m_textureIndices.end())
+        return { found->second };
+
+    const std::uint32_t index = static_cast<std::uint32_t>(m_textures.size());
+    m_textures.push_back(std::make_unique<TextureSlot>());
+    m_textures.back()->path = path;
+    m_textureIndices.emplace(path, index);
+    m_pendingCount++;
+
+    m_loaders.Submit([this, index, path](int) {
+        LoadResult result{ AssetType::Texture, index, false, {}, {}, {} };
+        if (!m_stopping)
+            result.succeeded = Texture::Decode(path, result.image);
+        PushResult(std::move(result));
+    });
+    return { index };
+}
+
+void AssetManager::Update()
+{
+    CollectResults();
+
+    std::size_t uploaded = 0;
+    while (!m_uploads.empty() && (uploaded == 0 || uploaded < m_uploadBudget))
+        uploaded += UploadNext();
+}
+
+void AssetManager::Finish()
+{
+    m_loaders.Wait();
+    CollectResults();
+    while (!m_uploads.empty())
+        UploadNext();
+}
+
+AssetState AssetManager::GetState(ModelHandle handle) const
+{
+    return handle.index < m_models.size() ? m_models[handle.index]->state : AssetState::Failed;
+}
+
+AssetState AssetManager::GetState(TextureHandle handle) const
+{
+    return handle.index < m_textures.size() ? m_textures[handle.index]->state : AssetState::Failed;
+}
+
+const Model& AssetManager::GetModel(ModelHandle handle) const
+{
+    if (handle.index < m_models.size() && m_models[handle.index]->model)
+        return *m_models[handle.index]->model;
+    return *m_placeholderModel;
+}
+
+const Texture& AssetManager::GetTexture(TextureHandle handle) const
+{
+    if (handle.index < m_textures.size() && m_textures[handle.index]->state == AssetState::Ready)
+        return m_textures[handle.index]->texture;
+    return m_placeholderTexture;
+}
+
+std::shared_ptr<const RailGeometry> AssetManager::GetRailGeometry(ModelHandle handle) const
+{
+    return handle.index < m_models.size() ? m_models[handle.index]->rails : nullptr;
+}
+
+void AssetManager::PushResult(LoadResult&& result)
+{
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    m_results.push_back(std::move(result));
+}
+
+// move decoded assets into their slots and queue them for upload, in the order they finished
+void AssetManager::CollectResults()
+{
+    std::vector<LoadResult> results;
+    {
+        std::lock_guard<std::mutex> lock(m_resultMutex);
+        results.swap(m_results);
+    }
+
+    for (LoadResult& result : results)
+    {
+        if (result.type == AssetType::Model)
+        {
+            ModelSlot& slot = *m_models[result.index];
+            if (!result.succeeded)
+            {
+                Finished(slot.state, AssetState::Failed, slot.path);
+                continue;
+            }
+            slot.staging = std::move(result.meshes);
+            slot.rails = std::move(result.rails);
+            slot.meshes.reserve(slot.staging.size());
+            slot.state = AssetState::Uploading;
+        }
+        else
+        {
+            TextureSlot& slot = *m_textures[result.index];
+            if (!result.succeeded)
+            {
+                Finished(slot.state, AssetState::Failed, slot.path);
+                continue;
+            }
+            slot.staging = std::move(result.image);
+            slot.state = AssetState::Uploading;
+        }
+        m_uploads.push_back({ result.type, result.index });
+    }
+}
+
+std::size_t AssetManager::UploadNext()
+{
+    const Upload upload = m_uploads.front();
+    if (upload.type == AssetType::Model)
+    {
+        ModelSlot& slot = *m_models[upload.index];
+        const std::size_t bytes = UploadModelMesh(slot);
+        if (slot.state == AssetState::Ready)
+            m_uploads.pop_front();
+        return bytes;
+    }
+
+    m_uploads.pop_front();
+    return UploadTexture(*m_textures[upload.index]);
+}
+
+// one mesh per call so a large model is spread over several frames, it is swapped in once complete
+std::size_t AssetManager::UploadModelMesh(ModelSlot& slot)
+{
+    std::size_t bytes = 0;
+    if (slot.meshes.size() < slot.staging.size())
+    {
+        MeshData& data = slot.staging[slot.meshes.size()];
+        slot.meshes.emplace_back(data.GetView());
+        bytes = slot.meshes.back().GetMemorySize();
+        data = MeshData(); // the GL has its own copy now
+    }
+
+    if (slot.meshes.size() == slot.staging.size())
+    {
+        slot.model = std::make_unique<Model>(std::move(slot.meshes), slot.path.substr(0, slot.path.find_last_of('/')));
+        slot.staging.clear();
+        slot.staging.shrink_to_fit();
+        Finished(slot.state, AssetState::Ready, slot.path);
+    }
+    return bytes;
+}
+
+// the pixels are copied into an orphaned unpack buffer, so glTexImage2D returns without waiting for the transfer
+std::size_t AssetManager::UploadTexture(TextureSlot& slot)
+{
+    const TextureData& image = slot.staging;
+    const std::size_t bytes = image.GetSize();
+
+    const GLuint buffer = m_pixelBuffers[m_nextPixelBuffer];
+    m_nextPixelBuffer = (m_nextPixelBuffer + 1) % c_PIXEL_BUFFER_COUNT;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    bool staged = false;
+    if (mapped)
+    {
+        std::memcpy(mapped, image.pixels.data(), bytes);
+        staged = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+    }
+    if (staged)
+        slot.texture = Texture(image.width, image.height, image.channels, nullptr); // offset 0 of the unpack buffer
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // the buffer could not be mapped or lost its contents, upload from client memory instead
+    if (!staged)
+        slot.texture = Texture(image.width, image.height, image.channels, image.pixels.data());
+
+    slot.staging = TextureData();
+    Finished(slot.state, AssetState::Ready, slot.path);
+    return bytes;
+}
+
+void AssetManager::Finished(AssetState& state, AssetState result, const std::string& path)
+{
+    state = result;
+    m_pendingCount--;
+    if (result == AssetState::Ready)
+        std::cout << "Asset streamed in: " << path << std::endl;
+    else
+        std::cerr << "Failed to load asset: " << path << std::endl;
+}
@@ -0,0 +1,165 @@
+#include "BallTrajectories.h"
+#include "PhysicsWorld.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void BallTrajectories::Build(const PhysicsWorld& world)
+{
+    Build(world, world.GetTime());
+}
+
+void BallTrajectories::Build(const PhysicsWorld& world, double time)
+{
+    m_ballCount = std::min(world.GetBallCount(), c_BALL_COUNT);
+    for (int i = 0; i < m_ballCount; i++)
+        Rebuild(world, i, time);
+    m_validUntil = std::numeric_limits<double>::infinity();
+}
+
+void BallTrajectories::Rebuild(const PhysicsWorld& world, int ball, double time)
+{
+    if (ball >= c_BALL_COUNT)
+        return;
+    Segment* segments = m_segments[ball];
+    int count = 0;
+
+    BallState state = world.GetStates()[ball];
+    double px = world.GetPositionsX()[ball];
+    double py = world.GetPositionsY()[ball];
+    double vx = world.GetVelocitiesX()[ball];
+    double vy = world.GetVelocitiesY()[ball];
+    const bool resting = state == BallState::Stationary || state == BallState::Pocketed;
+    const double spin = resting ? 0.0 : world.GetAngularZ()[ball];
+    m_spin[ball] = spin;
+    double t = time;
+
+    if (state == BallState::Sliding)
+    {
+        // the same phase the event solver predicts: friction against the contact point velocity until it
+        // stops slipping after 2 / 7 of the slip speed's worth of deceleration
+        Segment& segment = segments[count++];
+        segment = Segment{ t, px, py, vx, vy, 0.0, 0.0, world.GetAngularX()[ball], world.GetAngularY()[ball], state };
+        const double ux = vx - c_BALL_RADIUS * segment.angY;
+        const double uy = vy + c_BALL_RADIUS * segment.angX;
+        const double slip = std::sqrt(ux * ux + uy * uy);
+        const double decel = c_FRICTION_SLIDE * c_GRAVITY;
+        if (slip > 0.0)
+        {
+            segment.ax = -decel * ux / slip;
+            segment.ay = -decel * uy / slip;
+        }
+        const double duration = 2.0 * slip / (7.0 * decel);
+        px += vx * duration + 0.5 * segment.ax * duration * duration;
+        py += vy * duration + 0.5 * segment.ay * duration * duration;
+        vx += segment.ax * duration;
+        vy += segment.ay * duration;
+        t += duration;
+        state = BallState::Rolling;
+    }
+
+    if (state == BallState::Rolling)
+    {
+        Segment& segment = segments[count++];
+        segment = Segment{ t, px, py, vx, vy, 0.0, 0.0, -vy / c_BALL_RADIUS, vx / c_BALL_RADIUS, state };
+        const double speed = std::sqrt(vx * vx + vy * vy);
+        const double decel = c_FRICTION_ROLL * c_GRAVITY;
+        if (speed > 0.0)
+        {
+            segment.ax = -decel * vx / speed;
+            segment.ay = -decel * vy / speed;
+        }
+        const double duration = speed / decel;
+        px += vx * duration + 0.5 * segment.ax * duration * duration;
+        py += vy * duration + 0.5 * segment.ay * duration * duration;
+        t += duration;
+        state = BallState::Spinning; // stays only if there is spin left
+    }
+
+    if (state == BallState::Spinning)
+    {
+        const double spinLeft = std::fabs(spin) - c_SPIN_DECELERATION * (t - time);
+        if (spinLeft > 0.0)
+        {
+            segments[count++] = Segment{ t, px, py, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, state };
+            t += spinLeft / c_SPIN_DECELERATION;
+        }
+        state = BallState::Stationary;
+    }
+
+    // every trajectory ends at rest, a pocketed ball is at rest from the start
+    segments[count++] = Segment{ t, px, py, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, state };
+    m_segmentCounts[ball] = static_cast<std::uint8_t>(count);
+}
+
+void BallTrajectories::Evaluate(int ball, double time, Sample& out) const
+{
+    const Segment* segments = m_segments[ball];
+    time = std::max(time, segments[0].start);
+    int k = m_segmentCounts[ball] - 1;
+    while (k > 0 && segments[k].start > time)
+        k--;
+
+    const Segment& segment = segments[k];
+    const double dt = time - segment.start;
+    const double velX = segment.vx + segment.ax * dt;
+    const double velY = segment.vy + segment.ay * dt;
+    out.posX = static_cast<float>(segment.px + segment.vx * dt + 0.5 * segment.ax * dt * dt);
+    out.posY = static_cast<float>(segment.py + segment.vy * dt + 0.5 * segment.ay * dt * dt);
+    out.velX = static_cast<float>(velX);
+    out.velY = static_cast<float>(velY);
+    out.state = segment.state;
+
+    if (segment.state == BallState::Sliding)
+    {
+        // the friction torque turns w along the fixed direction of the contact point velocity
+        const double scale = 2.5 / c_BALL_RADIUS * dt;
+        out.angX = static_cast<float>(segment.angX + segment.ay * scale);
+        out.angY = static_cast<float>(segment.angY - segment.ax * scale);
+    }
+    else if (segment.state == BallState::Rolling)
+    {
+        out.angX = static_cast<float>(-velY / c_BALL_RADIUS);
+        out.angY = static_cast<float>(velX / c_BALL_RADIUS);
+    }
+    else
+    {
+        out.angX = out.angY = 0.0f;
+    }
+
+    const double spinLeft = std::max(std::fabs(m_spin[ball]) - c_SPIN_DECELERATION * (time - segments[0].start), 0.0);
+    out.angZ = segment.state == BallState::Stationary || segment.state == BallState::Pocketed ? 0.0f
+        : static_cast<float>(std::copysign(spinLeft, m_spin[ball]));
+}
+
+void BallTrajectories::Evaluate(double time, PhysicsSnapshot& out) const
+{
+    out.ballCount = static_cast<std::uint8_t>(m_ballCount);
+    Sample sample;
+    for (int i = 0; i < m_ballCount; i++)
+    {
+        Evaluate(i, time, sample);
+        out.posX[i] = sample.posX;
+        out.posY[i] = sample.posY;
+        out.angX[i] = sample.angX;
+        out.angY[i] = sample.angY;
+        out.angZ[i] = sample.angZ;
+        out.state[i] = sample.state;
+    }
+    out.time = static_cast<float>(time);
+    out.atRest = time >= GetRestTime();
+}
+
+double BallTrajectories::GetRestTime(int ball) const
+{
+    return m_segments[ball][m_segmentCounts[ball] - 1].start;
+}
+
+double BallTrajectories::GetRestTime() const
+{
+    double rest = -std::numeric_limits<double>::infinity();
+    for (int i = 0; i < m_ballCount; i++)
+        rest = std::max(rest, GetRestTime(i));
+    return rest;
+}
@@ -0,0 +1,164 @@
+#include "BallTransforms.h"
+#include "PhysicsWorld.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BALL_TRANSFORMS_SSE 1
+#include <xmmintrin.h>
+#endif
+
+void BallTransforms::Resize(int ballCount)
+{
+    m_rotW.assign(ballCount, 1.0f);
+    m_rotX.assign(ballCount, 0.0f);
+    m_rotY.assign(ballCount, 0.0f);
+    m_rotZ.assign(ballCount, 0.0f);
+    // NaN never compares equal, so every ball is rebuilt on the first update
+    m_lastX.assign(ballCount, std::nanf(""));
+    m_lastY.assign(ballCount, std::nanf(""));
+    m_matrices.assign(ballCount, glm::mat4(1.0f));
+}
+
+void BallTransforms::Update(const PhysicsSnapshot& snapshot, float deltaTime)
+{
+    const int ballCount = snapshot.ballCount;
+    if (ballCount != GetBallCount())
+        Resize(ballCount);
+
+    const float* posX = snapshot.posX;
+    const float* posY = snapshot.posY;
+    const float* angX = snapshot.angX;
+    const float* angY = snapshot.angY;
+    const float* angZ = snapshot.angZ;
+    const BallState* states = snapshot.state;
+
+    m_dirty.clear();
+    for (int i = 0; i < ballCount; i++)
+    {
+        const bool turning = states[i] != BallState::Stationary && states[i] != BallState::Pocketed;
+        if (turning)
+        {
+            // q += dt / 2 * (0, w) * q, then renormalise
+            const float h = 0.5f * deltaTime;
+            const float w = m_rotW[i], x = m_rotX[i], y = m_rotY[i], z = m_rotZ[i];
+            const float wx = angX[i] * h, wy = angY[i] * h, wz = angZ[i] * h;
+            const float nw = w - wx * x - wy * y - wz * z;
+            const float nx = x + wx * w + wy * z - wz * y;
+            const float ny = y - wx * z + wy * w + wz * x;
+            const float nz = z + wx * y - wy * x + wz * w;
+            const float invLength = 1.0f / std::sqrt(nw * nw + nx * nx + ny * ny + nz * nz);
+            m_rotW[i] = nw * invLength;
+            m_rotX[i] = nx * invLength;
+            m_rotY[i] = ny * invLength;
+            m_rotZ[i] = nz * invLength;
+        }
+
+        if (turning || posX[i] != m_lastX[i] || posY[i] != m_lastY[i])
+        {
+            m_lastX[i] = posX[i];
+            m_lastY[i] = posY[i];
+            m_dirty.push_back(i);
+        }
+    }
+
+    m_rebuiltCount = static_cast<int>(m_dirty.size());
+    if (m_dirty.empty())
+        return;
+
+    // gather, padded to a multiple of four by repeating the last dirty ball
+    const size_t padded = (m_dirty.size() + 3) & ~size_t(3);
+    m_gatherX.resize(padded);
+    m_gatherY.resize(padded);
+    m_gatherW.resize(padded);
+    m_gatherQx.resize(padded);
+    m_gatherQy.resize(padded);
+    m_gatherQz.resize(padded);
+    for (size_t k = 0; k < padded; k++)
+    {
+        const int i = m_dirty[std::min(k, m_dirty.size() - 1)];
+        m_gatherX[k] = posX[i];
+        m_gatherY[k] = posY[i];
+        m_gatherW[k] = m_rotW[i];
+        m_gatherQx[k] = m_rotX[i];
+        m_gatherQy[k] = m_rotY[i];
+        m_gatherQz[k] = m_rotZ[i];
+    }
+
+    BuildMatrices(static_cast<int>(m_dirty.size()));
+}
+
+void BallTransforms::BuildMatrices(int count)
+{
+#if defined(BALL_TRANSFORMS_SSE)
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 height = _mm_set1_ps(c_BALL_RADIUS);
+
+    // the gathered arrays are padded, so the last block can always load four lanes
+    for (int k = 0; k < count; k += 4)
+    {
+        const __m128 w = _mm_loadu_ps(&m_gatherW[k]);
+        const __m128 x = _mm_loadu_ps(&m_gatherQx[k]);
+        const __m128 y = _mm_loadu_ps(&m_gatherQy[k]);
+        const __m128 z = _mm_loadu_ps(&m_gatherQz[k]);
+
+        const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        const __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        // rotation matrix entries for four balls, column major like glm
+        __m128 c0x = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+        __m128 c0y = _mm_mul_ps(two, _mm_add_ps(xy, wz));
+        __m128 c0z = _mm_mul_ps(two, _mm_sub_ps(xz, wy));
+        __m128 c0w = _mm_setzero_ps();
+        __m128 c1x = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+        __m128 c1y = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+        __m128 c1z = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+        __m128 c1w = _mm_setzero_ps();
+        __m128 c2x = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+        __m128 c2y = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+        __m128 c2z = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+        __m128 c2w = _mm_setzero_ps();
+        __m128 c3x = _mm_loadu_ps(&m_gatherX[k]);
+        __m128 c3y = _mm_loadu_ps(&m_gatherY[k]);
+        __m128 c3z = height;
+        __m128 c3w = one;
+
+        // lanes hold balls, transpose so each register holds one column of one ball
+        _MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+        _MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+        _MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+        _MM_TRANSPOSE4_PS(c3x, c3y, c3z, c3w);
+
+        const __m128 columns[4][4] = {
+            { c0x, c1x, c2x, c3x },
+            { c0y, c1y, c2y, c3y },
+            { c0z, c1z, c2z, c3z },
+            { c0w, c1w, c2w, c3w },
+        };
+        for (int lane = 0; lane < 4 && k + lane < count; lane++)
+        {
+            float* matrix = &m_matrices[m_dirty[k + lane]][0][0];
+            for (int column = 0; column < 4; column++)
+                _mm_storeu_ps(matrix + 4 * column, columns[lane][column]);
+        }
+    }
+#else
+    BuildMatricesScalar(count);
+#endif
+}
+
+void BallTransforms::BuildMatricesScalar(int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        const float w = m_gatherW[k], x = m_gatherQx[k], y = m_gatherQy[k], z = m_gatherQz[k];
+        glm::mat4& matrix = m_matrices[m_dirty[k]];
+        matrix[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y), 0.0f);
+        matrix[1] = glm::vec4(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x), 0.0f);
+        matrix[2] = glm::vec4(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y), 0.0f);
+        matrix[3] = glm::vec4(m_gatherX[k], m_gatherY[k], c_BALL_RADIUS, 1.0f);
+    }
+}
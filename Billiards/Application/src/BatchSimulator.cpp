@@ -0,0 +1,47 @@
+#include "BatchSimulator.h"
+
+#include <algorithm>
+
+namespace
+{
+    // chunks per worker, enough to even out shots that run much longer than others without drowning in tasks
+    constexpr int c_CHUNKS_PER_WORKER = 8;
+}
+
+BatchSimulator::BatchSimulator(unsigned threadCount)
+    : m_pool(threadCount)
+    , m_arenas(static_cast<size_t>(m_pool.GetWorkerCount()))
+{
+}
+
+std::vector<ShotResult> BatchSimulator::Simulate(const std::vector<TableState>& tables, const std::vector<ShotRequest>& shots)
+{
+    std::vector<ShotResult> results(shots.size());
+    Simulate(tables.data(), shots.data(), static_cast<int>(shots.size()), results.data());
+    return results;
+}
+
+void BatchSimulator::Simulate(const TableState* tables, const ShotRequest* shots, int shotCount, ShotResult* results)
+{
+    const int grain = std::max(1, shotCount / (GetWorkerCount() * c_CHUNKS_PER_WORKER));
+    m_pool.ParallelFor(shotCount, grain, [&](int begin, int end, int worker)
+    {
+        PhysicsWorld& world = m_arenas[worker].world;
+        world.SetSolverMode(m_solverMode);
+        world.SetRailGeometry(m_rails);
+
+        for (int k = begin; k < end; k++)
+        {
+            const ShotRequest& request = shots[k];
+            ShotResult& result = results[k];
+
+            world.LoadState(tables[request.table]);
+            world.Strike(request.ball, request.shot);
+
+            const std::uint64_t eventsBefore = world.GetEventSolver().GetEventCount();
+            result.duration = world.SimulateUntilRest(m_maxShotTime);
+            result.events = static_cast<std::uint32_t>(world.GetEventSolver().GetEventCount() - eventsBefore);
+            world.SaveState(result.finalState);
+        }
+    });
+}
@@ -0,0 +1,193 @@
+#include "CollisionKernel.h"
+#include "StrictFloat.h"
+
+// the SIMD paths only exist on x86, everything else runs the scalar reference
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define COLLISION_KERNEL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// a fused multiply-add rounds once instead of twice and would break exact agreement between the paths
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+// GCC and Clang need the AVX2 function marked so it compiles without -mavx2, MSVC emits AVX2 intrinsics as is
+#if defined(COLLISION_KERNEL_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+namespace
+{
+#if defined(COLLISION_KERNEL_X86)
+    bool CpuSupportsAvx2()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        __cpuid(info, 1);
+        const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0;
+        if (!osSavesYmm || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }
+#endif
+
+    // append the pair indices base + bit for every set bit of mask
+    int AppendMask(unsigned mask, int base, int* outIndices)
+    {
+        int count = 0;
+        for (int bit = 0; mask != 0; bit++, mask >>= 1)
+        {
+            if (mask & 1u)
+                outIndices[count++] = base + bit;
+        }
+        return count;
+    }
+}
+
+KernelPath CollisionKernel::GetBestPath()
+{
+#if defined(COLLISION_KERNEL_X86)
+    static const KernelPath s_best = CpuSupportsAvx2() ? KernelPath::Avx2 : KernelPath::Sse;
+    return s_best;
+#else
+    return KernelPath::Scalar;
+#endif
+}
+
+const char* CollisionKernel::GetPathName(KernelPath path)
+{
+    switch (path)
+    {
+    case KernelPath::Scalar: return "Scalar";
+    case KernelPath::Sse: return "SSE";
+    case KernelPath::Avx2: return "AVX2";
+    }
+    return "Unknown";
+}
+
+int CollisionKernel::FindOverlaps(KernelPath path, const float* posX, const float* posY,
+                                  const int* pairA, const int* pairB, int pairCount,
+                                  float distance, int* outIndices)
+{
+    const float distanceSq = distance * distance;
+#if defined(COLLISION_KERNEL_X86)
+    if (path == KernelPath::Avx2)
+        return FindOverlapsAvx2(posX, posY, pairA, pairB, pairCount, distanceSq, outIndices);
+    if (path == KernelPath::Sse)
+        return FindOverlapsSse(posX, posY, pairA, pairB, pairCount, distanceSq, outIndices);
+#endif
+    return FindOverlapsScalar(posX, posY, pairA, pairB, 0, pairCount, distanceSq, outIndices);
+}
+
+int CollisionKernel::FindOverlapsScalar(const float* posX, const float* posY, const int* pairA, const int* pairB,
+                                        int begin, int end, float distanceSq, int* outIndices)
+{
+    int count = 0;
+    for (int k = begin; k < end; k++)
+    {
+        const float dx = posX[pairB[k]] - posX[pairA[k]];
+        const float dy = posY[pairB[k]] - posY[pairA[k]];
+        const float dxSq = dx * dx;
+        const float dySq = dy * dy;
+        if (dxSq + dySq < distanceSq)
+            outIndices[count++] = k;
+    }
+    return count;
+}
+
+#if defined(COLLISION_KERNEL_X86)
+
+int CollisionKernel::FindOverlapsSse(const float* posX, const float* posY, const int* pairA, const int* pairB,
+                                     int pairCount, float distanceSq, int* outIndices)
+{
+    const __m128 limit = _mm_set1_ps(distanceSq);
+    const int blockEnd = pairCount & ~7;
+
+    int count = 0;
+    for (int k = 0; k < blockEnd; k += 8)
+    {
+        // SSE has no gather, so each block of 8 is two groups of 4 filled lane by lane
+        for (int half = 0; half < 8; half += 4)
+        {
+            const int* a = pairA + k + half;
+            const int* b = pairB + k + half;
+            const __m128 ax = _mm_set_ps(posX[a[3]], posX[a[2]], posX[a[1]], posX[a[0]]);
+            const __m128 ay = _mm_set_ps(posY[a[3]], posY[a[2]], posY[a[1]], posY[a[0]]);
+            const __m128 bx = _mm_set_ps(posX[b[3]], posX[b[2]], posX[b[1]], posX[b[0]]);
+            const __m128 by = _mm_set_ps(posY[b[3]], posY[b[2]], posY[b[1]], posY[b[0]]);
+
+            const __m128 dx = _mm_sub_ps(bx, ax);
+            const __m128 dy = _mm_sub_ps(by, ay);
+            const __m128 distSq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+            const unsigned mask = static_cast<unsigned>(_mm_movemask_ps(_mm_cmplt_ps(distSq, limit)));
+            count += AppendMask(mask, k + half, outIndices + count);
+        }
+    }
+
+    count += FindOverlapsScalar(posX, posY, pairA, pairB, blockEnd, pairCount, distanceSq, outIndices + count);
+    return count;
+}
+
+TARGET_AVX2
+int CollisionKernel::FindOverlapsAvx2(const float* posX, const float* posY, const int* pairA, const int* pairB,
+                                      int pairCount, float distanceSq, int* outIndices)
+{
+    const __m256 limit = _mm256_set1_ps(distanceSq);
+    const int blockEnd = pairCount & ~7;
+
+    int count = 0;
+    for (int k = 0; k < blockEnd; k += 8)
+    {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pairA + k));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pairB + k));
+        const __m256 ax = _mm256_i32gather_ps(posX, a, 4);
+        const __m256 ay = _mm256_i32gather_ps(posY, a, 4);
+        const __m256 bx = _mm256_i32gather_ps(posX, b, 4);
+        const __m256 by = _mm256_i32gather_ps(posY, b, 4);
+
+        const __m256 dx = _mm256_sub_ps(bx, ax);
+        const __m256 dy = _mm256_sub_ps(by, ay);
+        const __m256 distSq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        const unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(distSq, limit, _CMP_LT_OQ)));
+        count += AppendMask(mask, k, outIndices + count);
+    }
+
+    count += FindOverlapsScalar(posX, posY, pairA, pairB, blockEnd, pairCount, distanceSq, outIndices + count);
+    return count;
+}
+
+#else
+
+int CollisionKernel::FindOverlapsSse(const float* posX, const float* posY, const int* pairA, const int* pairB,
+                                     int pairCount, float distanceSq, int* outIndices)
+{
+    return FindOverlapsScalar(posX, posY, pairA, pairB, 0, pairCount, distanceSq, outIndices);
+}
+
+int CollisionKernel::FindOverlapsAvx2(const float* posX, const float* posY, const int* pairA, const int* pairB,
+                                      int pairCount, float distanceSq, int* outIndices)
+{
+    return FindOverlapsScalar(posX, posY, pairA, pairB, 0, pairCount, distanceSq, outIndices);
+}
+
+#endif
@@ -0,0 +1,662 @@
+#include "EventSolver.h"
+#include "PhysicsWorld.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    constexpr double c_NEVER = std::numeric_limits<double>::infinity();
+    constexpr int c_MAX_EVENTS_PER_ADVANCE = 100000; // guards against a runaway chain of zero-time events
+    // touching objects closing in slower than this are float rounding noise left over from the previous
+    // response, treating them as a new contact would resolve the same zero-time event forever
+    constexpr double c_MIN_CLOSING_RATE = 1e-6;
+    // baked rails count as touched this far in, so a ball that rounding left just inside a rail, with too little
+    // closing rate to count, still gets a contact once its path turns into the rail, as it does along a curve
+    constexpr double c_RAIL_SLOP = 1e-6; // m
+
+    // ball trajectory until its next transition: p(t) = p + v t + a t^2 / 2
+    struct BallMotion
+    {
+        double px = 0.0, py = 0.0;
+        double vx = 0.0, vy = 0.0;
+        double ax = 0.0, ay = 0.0;
+        double duration = c_NEVER; // time until the next state transition
+        bool moving = false;
+    };
+
+    BallMotion GetMotion(const PhysicsWorld& world, int i)
+    {
+        BallMotion motion;
+        motion.px = world.GetPositionsX()[i];
+        motion.py = world.GetPositionsY()[i];
+
+        const double vx = world.GetVelocitiesX()[i];
+        const double vy = world.GetVelocitiesY()[i];
+        switch (world.GetStates()[i])
+        {
+        case BallState::Sliding:
+        {
+            // friction acts against the contact point velocity, whose direction stays constant while sliding
+            const double ux = vx - c_BALL_RADIUS * world.GetAngularY()[i];
+            const double uy = vy + c_BALL_RADIUS * world.GetAngularX()[i];
+            const double slip = std::sqrt(ux * ux + uy * uy);
+            const double decel = c_FRICTION_SLIDE * c_GRAVITY;
+            motion.vx = vx;
+            motion.vy = vy;
+            if (slip > 0.0)
+            {
+                motion.ax = -decel * ux / slip;
+                motion.ay = -decel * uy / slip;
+            }
+            motion.duration = 2.0 * slip / (7.0 * decel);
+            motion.moving = true;
+            break;
+        }
+        case BallState::Rolling:
+        {
+            const double speed = std::sqrt(vx * vx + vy * vy);
+            const double decel = c_FRICTION_ROLL * c_GRAVITY;
+            motion.vx = vx;
+            motion.vy = vy;
+            if (speed > 0.0)
+            {
+                motion.ax = -decel * vx / speed;
+                motion.ay = -decel * vy / speed;
+            }
+            motion.duration = speed / decel;
+            motion.moving = true;
+            break;
+        }
+        case BallState::Spinning:
+            motion.duration = std::fabs(world.GetAngularZ()[i]) / c_SPIN_DECELERATION;
+            break;
+        case BallState::Stationary:
+        case BallState::Pocketed:
+            break;
+        }
+        return motion;
+    }
+
+    // polynomial with c[k] the coefficient of t^k
+    double Evaluate(const double* c, int degree, double t)
+    {
+        double result = c[degree];
+        for (int k = degree - 1; k >= 0; k--)
+            result = result * t + c[k];
+        return result;
+    }
+
+    double Bisect(const double* c, int degree, double lo, double hi)
+    {
+        double fLo = Evaluate(c, degree, lo);
+        for (int iteration = 0; iteration < 64; iteration++)
+        {
+            const double mid = 0.5 * (lo + hi);
+            if (mid <= lo || mid >= hi)
+                break;
+            const double fMid = Evaluate(c, degree, mid);
+            if ((fMid > 0.0) == (fLo > 0.0))
+            {
+                lo = mid;
+                fLo = fMid;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        return hi;
+    }
+
+    // sorted real roots of a polynomial of degree <= 4 inside [lo, hi].
+    // The roots of the derivative split the range into monotonic pieces which hold at most one root each.
+    int FindRoots(const double* c, int degree, double lo, double hi, double* roots)
+    {
+        while (degree > 0 && c[degree] == 0.0)
+            --degree;
+        if (degree == 0)
+            return 0;
+        if (degree == 1)
+        {
+            const double root = -c[0] / c[1];
+            if (root < lo || root > hi)
+                return 0;
+            roots[0] = root;
+            return 1;
+        }
+
+        double derivative[4] = {};
+        for (int k = 1; k <= degree; k++)
+            derivative[k - 1] = k * c[k];
+
+        double bounds[5];
+        const int criticalCount = FindRoots(derivative, degree - 1, lo, hi, bounds);
+        bounds[criticalCount] = hi;
+
+        int count = 0;
+        double a = lo;
+        double fa = Evaluate(c, degree, a);
+        for (int k = 0; k <= criticalCount; k++)
+        {
+            const double b = bounds[k];
+            const double fb = Evaluate(c, degree, b);
+            if (fa == 0.0 && (count == 0 || roots[count - 1] != a))
+                roots[count++] = a;
+            else if ((fa > 0.0 && fb < 0.0) || (fa < 0.0 && fb > 0.0))
+                roots[count++] = Bisect(c, degree, a, b);
+            a = b;
+            fa = fb;
+        }
+        if (fa == 0.0 && (count == 0 || roots[count - 1] != a))
+            roots[count++] = a;
+        return count;
+    }
+
+    // earliest root in [0, horizon] where f decreases through zero, whatever its sign at 0
+    double FirstCrossing(const double* c, int degree, double horizon)
+    {
+        if (!(horizon > 0.0))
+            return c_NEVER;
+
+        double roots[4];
+        const int count = FindRoots(c, degree, 0.0, horizon, roots);
+        for (int k = 0; k < count; k++)
+        {
+            double slope = 0.0;
+            for (int d = degree; d >= 1; d--)
+                slope = slope * roots[k] + d * c[d];
+            if (slope <= 0.0)
+                return roots[k];
+        }
+        return c_NEVER;
+    }
+
+    // earliest time in [0, horizon] where f goes from positive (apart) to zero while decreasing (closing in)
+    double FirstContact(const double* c, int degree, double horizon)
+    {
+        if (!(horizon > 0.0))
+            return c_NEVER;
+
+        // already touching or overlapping and still closing in
+        if (c[0] <= 0.0 && c[1] < -c_MIN_CLOSING_RATE)
+            return 0.0;
+
+        return FirstCrossing(c, degree, horizon);
+    }
+
+    // |dp + dv t + da t^2 / 2|^2 - radius^2 as a quartic in t
+    void DistanceQuartic(double dpx, double dpy, double dvx, double dvy, double dax, double day,
+                         double radius, double* c)
+    {
+        c[4] = 0.25 * (dax * dax + day * day);
+        c[3] = dvx * dax + dvy * day;
+        c[2] = dvx * dvx + dvy * dvy + dpx * dax + dpy * day;
+        c[1] = 2.0 * (dpx * dvx + dpy * dvy);
+        c[0] = dpx * dpx + dpy * dpy - radius * radius;
+    }
+
+    // earliest contact with a baked rail before the next transition, primitive is set to the one touched
+    double FirstRailContact(const RailGeometry& rails, const BallMotion& motion, std::vector<int>& candidates,
+                            int& primitive)
+    {
+        // box around the path, the grid cells already reach a ball radius beyond their primitives
+        double minX = motion.px, maxX = motion.px;
+        double minY = motion.py, maxY = motion.py;
+        auto extend = [&](double t)
+        {
+            const double x = motion.px + motion.vx * t + 0.5 * motion.ax * t * t;
+            const double y = motion.py + motion.vy * t + 0.5 * motion.ay * t * t;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+        };
+        extend(motion.duration);
+        if (motion.ax != 0.0 && -motion.vx / motion.ax > 0.0 && -motion.vx / motion.ax < motion.duration)
+            extend(-motion.vx / motion.ax);
+        if (motion.ay != 0.0 && -motion.vy / motion.ay > 0.0 && -motion.vy / motion.ay < motion.duration)
+            extend(-motion.vy / motion.ay);
+        rails.Query(static_cast<float>(minX), static_cast<float>(minY), static_cast<float>(maxX),
+                    static_cast<float>(maxY), candidates);
+
+        double best = c_NEVER;
+        auto at = [&](double t, double& x, double& y)
+        {
+            x = motion.px + motion.vx * t + 0.5 * motion.ax * t * t;
+            y = motion.py + motion.vy * t + 0.5 * motion.ay * t * t;
+        };
+        auto corner = [&](int index, double cx, double cy)
+        {
+            double c[5];
+            DistanceQuartic(motion.px - cx, motion.py - cy, motion.vx, motion.vy, motion.ax, motion.ay,
+                            c_BALL_RADIUS, c);
+            c[0] += 2.0 * c_BALL_RADIUS * c_RAIL_SLOP;
+            const double time = FirstContact(c, 4, std::min(motion.duration, best));
+            if (time < best)
+            {
+                best = time;
+                primitive = index;
+            }
+        };
+
+        for (int index : candidates)
+        {
+            const RailPrimitive& rail = rails.GetPrimitives()[index];
+            if (rail.shape == RailShape::Segment)
+            {
+                // distance to the line on the side the ball starts from, a quadratic like the box cushions
+                const double ex = rail.x1 - rail.x0;
+                const double ey = rail.y1 - rail.y0;
+                const double lengthSq = ex * ex + ey * ey;
+                if (lengthSq > 0.0)
+                {
+                    const double length = std::sqrt(lengthSq);
+                    double nx = -ey / length;
+                    double ny = ex / length;
+                    if (nx * (motion.px - rail.x0) + ny * (motion.py - rail.y0) < 0.0)
+                    {
+                        nx = -nx;
+                        ny = -ny;
+                    }
+                    const double line[3] = {
+                        nx * (motion.px - rail.x0) + ny * (motion.py - rail.y0) - c_BALL_RADIUS + c_RAIL_SLOP,
+                        nx * motion.vx + ny * motion.vy,
+                        0.5 * (nx * motion.ax + ny * motion.ay),
+                    };
+                    const double time = FirstContact(line, 2, std::min(motion.duration, best));
+                    if (time < best)
+                    {
+                        double x, y;
+                        at(time, x, y);
+                        const double u = (x - rail.x0) * ex + (y - rail.y0) * ey;
+                        if (u >= 0.0 && u <= lengthSq)
+                        {
+                            best = time;
+                            primitive = index;
+                        }
+                    }
+                }
+                corner(index, rail.x0, rail.y0);
+                corner(index, rail.x1, rail.y1);
+            }
+            else
+            {
+                // distance to the centre, against the convex side from outside the circle and against the concave
+                // side from inside, which a ball that starts outside reaches once it has crossed into the circle
+                const double dx = motion.px - rail.x0;
+                const double dy = motion.py - rail.y0;
+                const bool outside = dx * dx + dy * dy >= double(rail.radius) * rail.radius;
+                auto arcContact = [&](double time)
+                {
+                    if (time >= best)
+                        return;
+                    double x, y;
+                    at(time, x, y);
+                    if (RailGeometry::IsWithinArc(rail, static_cast<float>(x), static_cast<float>(y)))
+                    {
+                        best = time;
+                        primitive = index;
+                    }
+                };
+
+                double c[5];
+                if (outside)
+                {
+                    DistanceQuartic(dx, dy, motion.vx, motion.vy, motion.ax, motion.ay, rail.radius + c_BALL_RADIUS, c);
+                    c[0] += 2.0 * (rail.radius + c_BALL_RADIUS) * c_RAIL_SLOP;
+                    arcContact(FirstContact(c, 4, std::min(motion.duration, best)));
+                }
+                if (rail.radius > c_BALL_RADIUS)
+                {
+                    DistanceQuartic(dx, dy, motion.vx, motion.vy, motion.ax, motion.ay, rail.radius - c_BALL_RADIUS, c);
+                    for (double& coefficient : c)
+                        coefficient = -coefficient;
+                    c[0] += 2.0 * (rail.radius - c_BALL_RADIUS) * c_RAIL_SLOP;
+                    const double horizon = std::min(motion.duration, best);
+                    arcContact(outside ? FirstCrossing(c, 4, horizon) : FirstContact(c, 4, horizon));
+                }
+
+                float endX, endY;
+                RailGeometry::GetArcEnd(rail, false, endX, endY);
+                corner(index, endX, endY);
+                RailGeometry::GetArcEnd(rail, true, endX, endY);
+                corner(index, endX, endY);
+            }
+        }
+        return best;
+    }
+}
+
+int EventSolver::Advance(PhysicsWorld& world, float deltaTime)
+{
+    if (!IsCurrent(world))
+        Rebuild(world);
+    return Run(world, m_now + deltaTime, false);
+}
+
+int EventSolver::AdvanceUntilRest(PhysicsWorld& world, float maxTime)
+{
+    if (!IsCurrent(world))
+        Rebuild(world);
+    return Run(world, m_now + maxTime, true);
+}
+
+int EventSolver::Run(PhysicsWorld& world, double endTime, bool stopAtRest)
+{
+    int events = 0;
+    while (events < c_MAX_EVENTS_PER_ADVANCE)
+    {
+        const PhysicsEvent event = NextEvent();
+        if (event.type == EventType::None || event.time > endTime)
+            break;
+
+        AdvanceTo(world, event.time);
+        Resolve(world, event);
+        ++events;
+    }
+
+    if (!(stopAtRest && world.IsAtRest()))
+        AdvanceTo(world, endTime);
+
+    m_eventCount += events;
+    m_revision = world.m_revision;
+    m_trajectories.SetValidUntil(NextCollisionTime());
+    return events;
+}
+
+bool EventSolver::IsCurrent(const PhysicsWorld& world) const
+{
+    return m_valid && world.m_revision == m_revision && world.GetBallCount() == m_ballCount;
+}
+
+void EventSolver::Rebuild(const PhysicsWorld& world)
+{
+    m_ballCount = world.GetBallCount();
+    m_now = world.m_time;
+    m_transitionTimes.assign(m_ballCount, c_NEVER);
+    m_boundEvents.assign(m_ballCount, PhysicsEvent{});
+    m_pairTimes.assign(static_cast<size_t>(m_ballCount) * m_ballCount, c_NEVER);
+
+    for (int i = 0; i < m_ballCount; i++)
+        PredictBall(world, i);
+    for (int a = 0; a < m_ballCount; a++)
+    {
+        for (int b = a + 1; b < m_ballCount; b++)
+            PredictPair(world, a, b);
+    }
+
+    m_trajectories.Build(world, m_now);
+    m_revision = world.m_revision;
+    m_valid = true;
+}
+
+void EventSolver::PredictBall(const PhysicsWorld& world, int ball)
+{
+    const BallMotion motion = GetMotion(world, ball);
+    m_transitionTimes[ball] = m_now + motion.duration;
+
+    PhysicsEvent bound;
+    bound.time = c_NEVER;
+    bound.ball = ball;
+    if (!motion.moving)
+    {
+        m_boundEvents[ball] = bound;
+        return;
+    }
+
+    // baked cushions of a table model replace the box
+    const RailGeometry* railGeometry = world.GetRailGeometry();
+    if (railGeometry)
+    {
+        int primitive = -1;
+        const double time = FirstRailContact(*railGeometry, motion, m_railCandidates, primitive);
+        if (time < c_NEVER)
+        {
+            bound.type = EventType::Rail;
+            bound.time = m_now + time;
+            bound.other = primitive;
+        }
+    }
+
+    // cushions, distance to each rail as a quadratic that is positive while the ball is inside
+    const double maxX = 0.5 * c_TABLE_LENGTH - c_BALL_RADIUS;
+    const double maxY = 0.5 * c_TABLE_WIDTH - c_BALL_RADIUS;
+    const double rails[4][3] = {
+        { maxX - motion.px, -motion.vx, -0.5 * motion.ax },
+        { maxX + motion.px, motion.vx, 0.5 * motion.ax },
+        { maxY - motion.py, -motion.vy, -0.5 * motion.ay },
+        { maxY + motion.py, motion.vy, 0.5 * motion.ay },
+    };
+    for (int rail = 0; rail < 4 && !railGeometry; rail++)
+    {
+        const double time = FirstContact(rails[rail], 2, motion.duration);
+        if (time < c_NEVER && m_now + time < bound.time)
+        {
+            bound.type = EventType::Cushion;
+            bound.time = m_now + time;
+            bound.other = rail / 2;
+        }
+    }
+
+    // pockets, the ball drops once its centre comes within the capture radius
+    for (int pocket = 0; pocket < c_POCKET_COUNT; pocket++)
+    {
+        float pocketX, pocketY;
+        PhysicsWorld::GetPocketPosition(pocket, pocketX, pocketY);
+
+        double c[5];
+        DistanceQuartic(motion.px - pocketX, motion.py - pocketY, motion.vx, motion.vy, motion.ax, motion.ay,
+                        c_POCKET_RADIUS, c);
+        const double time = FirstContact(c, 4, motion.duration);
+        if (time < c_NEVER && m_now + time <= bound.time)
+        {
+            bound.type = EventType::Pocket;
+            bound.time = m_now + time;
+            bound.other = pocket;
+        }
+    }
+
+    m_boundEvents[ball] = bound;
+}
+
+void EventSolver::PredictPair(const PhysicsWorld& world, int a, int b)
+{
+    if (a > b)
+        std::swap(a, b);
+    double& pairTime = m_pairTimes[static_cast<size_t>(a) * m_ballCount + b];
+    pairTime = c_NEVER;
+
+    const BallState* states = world.GetStates();
+    if (states[a] == BallState::Pocketed || states[b] == BallState::Pocketed)
+        return;
+
+    const BallMotion motionA = GetMotion(world, a);
+    const BallMotion motionB = GetMotion(world, b);
+    if (!motionA.moving && !motionB.moving)
+        return;
+
+    double c[5];
+    DistanceQuartic(motionB.px - motionA.px, motionB.py - motionA.py,
+                    motionB.vx - motionA.vx, motionB.vy - motionA.vy,
+                    motionB.ax - motionA.ax, motionB.ay - motionA.ay,
+                    c_BALL_DIAMETER, c);
+
+    // both trajectories only hold until the first of the two transitions
+    const double horizon = std::min(motionA.duration, motionB.duration);
+    const double time = FirstContact(c, 4, horizon);
+    if (time < c_NEVER)
+        pairTime = m_now + time;
+}
+
+void EventSolver::PredictAllPairs(const PhysicsWorld& world, int ball)
+{
+    for (int other = 0; other < m_ballCount; other++)
+    {
+        if (other != ball)
+            PredictPair(world, ball, other);
+    }
+}
+
+double EventSolver::NextCollisionTime() const
+{
+    double time = c_NEVER;
+    for (int i = 0; i < m_ballCount; i++)
+        time = std::min(time, m_boundEvents[i].time);
+    for (int a = 0; a < m_ballCount; a++)
+    {
+        const double* row = &m_pairTimes[static_cast<size_t>(a) * m_ballCount];
+        for (int b = a + 1; b < m_ballCount; b++)
+            time = std::min(time, row[b]);
+    }
+    return time;
+}
+
+PhysicsEvent EventSolver::NextEvent() const
+{
+    PhysicsEvent next;
+    next.time = c_NEVER;
+
+    for (int i = 0; i < m_ballCount; i++)
+    {
+        if (m_transitionTimes[i] < next.time)
+        {
+            next.type = EventType::Transition;
+            next.time = m_transitionTimes[i];
+            next.ball = i;
+            next.other = -1;
+        }
+        if (m_boundEvents[i].time < next.time)
+            next = m_boundEvents[i];
+    }
+
+    for (int a = 0; a < m_ballCount; a++)
+    {
+        const double* row = &m_pairTimes[static_cast<size_t>(a) * m_ballCount];
+        for (int b = a + 1; b < m_ballCount; b++)
+        {
+            if (row[b] < next.time)
+            {
+                next.type = EventType::BallBall;
+                next.time = row[b];
+                next.ball = a;
+                next.other = b;
+            }
+        }
+    }
+    return next;
+}
+
+// move every ball along its current trajectory, the state transitions themselves are events
+void EventSolver::AdvanceTo(PhysicsWorld& world, double time)
+{
+    const double dt = time - m_now;
+    if (dt <= 0.0)
+        return;
+
+    for (int i = 0; i < m_ballCount; i++)
+    {
+        const BallState state = world.m_state[i];
+        if (state == BallState::Stationary || state == BallState::Pocketed)
+            continue;
+
+        const BallMotion motion = GetMotion(world, i);
+        const double t = std::min(dt, motion.duration);
+        if (motion.moving)
+        {
+            world.m_posX[i] = static_cast<float>(motion.px + motion.vx * t + 0.5 * motion.ax * t * t);
+            world.m_posY[i] = static_cast<float>(motion.py + motion.vy * t + 0.5 * motion.ay * t * t);
+            world.m_velX[i] = static_cast<float>(motion.vx + motion.ax * t);
+            world.m_velY[i] = static_cast<float>(motion.vy + motion.ay * t);
+        }
+
+        if (state == BallState::Sliding)
+        {
+            // the friction torque turns w along the same fixed direction the contact velocity points
+            const double scale = 2.5 / c_BALL_RADIUS * t;
+            world.m_angX[i] += static_cast<float>(motion.ay * scale);
+            world.m_angY[i] -= static_cast<float>(motion.ax * scale);
+        }
+        else if (state == BallState::Rolling)
+        {
+            world.m_angX[i] = -world.m_velY[i] / c_BALL_RADIUS;
+            world.m_angY[i] = world.m_velX[i] / c_BALL_RADIUS;
+        }
+
+        const float spinDecay = static_cast<float>(c_SPIN_DECELERATION * dt);
+        float& spin = world.m_angZ[i];
+        spin = std::fabs(spin) <= spinDecay ? 0.0f : (spin > 0.0f ? spin - spinDecay : spin + spinDecay);
+    }
+
+    m_now = time;
+    world.m_time = static_cast<float>(time);
+}
+
+void EventSolver::Resolve(PhysicsWorld& world, const PhysicsEvent& event)
+{
+    const int a = event.ball;
+    switch (event.type)
+    {
+    case EventType::Transition:
+    {
+        BallState& state = world.m_state[a];
+        if (state == BallState::Sliding)
+        {
+            // contact point stopped slipping, snap w to exact rolling
+            state = BallState::Rolling;
+            world.m_angX[a] = -world.m_velY[a] / c_BALL_RADIUS;
+            world.m_angY[a] = world.m_velX[a] / c_BALL_RADIUS;
+        }
+        else if (state == BallState::Rolling)
+        {
+            world.m_velX[a] = world.m_velY[a] = 0.0f;
+            world.m_angX[a] = world.m_angY[a] = 0.0f;
+            state = world.m_angZ[a] != 0.0f ? BallState::Spinning : BallState::Stationary;
+        }
+        else
+        {
+            world.m_angZ[a] = 0.0f;
+            state = BallState::Stationary;
+        }
+        break;
+    }
+    case EventType::BallBall:
+    {
+        const int b = event.other;
+        float nx = world.m_posX[b] - world.m_posX[a];
+        float ny = world.m_posY[b] - world.m_posY[a];
+        const float dist = std::sqrt(nx * nx + ny * ny);
+        if (dist > 0.0f)
+            world.ApplyBallImpulse(a, b, nx / dist, ny / dist);
+
+        m_trajectories.Rebuild(world, b, m_now);
+        PredictBall(world, b);
+        PredictAllPairs(world, b);
+        break;
+    }
+    case EventType::Cushion:
+        world.ReboundFromCushion(a, event.other == 0);
+        break;
+    case EventType::Rail:
+    {
+        // contacts are found a little inside the rail, put the ball back on it so the next one gets the whole slop
+        float nx, ny;
+        const float distance = world.GetRailGeometry()->GetNormal(event.other, world.m_posX[a], world.m_posY[a], nx, ny);
+        world.m_posX[a] += (c_BALL_RADIUS - distance) * nx;
+        world.m_posY[a] += (c_BALL_RADIUS - distance) * ny;
+        world.ReboundFromRail(a, nx, ny);
+        break;
+    }
+    case EventType::Pocket:
+        world.PocketBall(a);
+        break;
+    case EventType::None:
+        return;
+    }
+
+    if (event.type != EventType::Transition)
+        m_trajectories.Rebuild(world, a, m_now);
+    PredictBall(world, a);
+    PredictAllPairs(world, a);
+}
@@ -0,0 +1,138 @@
+#include "FramePacer.h"
+#include "../Window.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+FramePacer::FramePacer(Window* window, PacingMode mode, double targetRate)
+    : m_window(window), m_mode(mode), m_targetRate(targetRate > 0.0 ? targetRate : 60.0),
+    m_frameTimes(c_HISTORY_SIZE, 0.0f), m_workTimes(c_HISTORY_SIZE, 0.0f)
+{
+    m_adaptiveVsync = m_window && m_window->SupportsAdaptiveVsync();
+    ApplySwapInterval();
+}
+
+void FramePacer::SetMode(PacingMode mode)
+{
+    m_mode = mode;
+    m_nextDeadline = Clock::now();
+    ApplySwapInterval();
+}
+
+void FramePacer::SetTargetRate(double rate)
+{
+    if (rate > 0.0)
+        m_targetRate = rate;
+}
+
+void FramePacer::ApplySwapInterval() const
+{
+    if (!m_window)
+        return;
+
+    // a negative interval is the tear control extension, swaps that miss vblank happen immediately
+    int interval = 0;
+    if (m_mode == PacingMode::AdaptiveVsync)
+        interval = m_adaptiveVsync ? -1 : 1;
+    m_window->SetSwapInterval(interval);
+}
+
+float FramePacer::BeginFrame()
+{
+    const Clock::time_point now = Clock::now();
+    float deltaTime = 0.0f;
+    if (m_started)
+    {
+        deltaTime = std::chrono::duration<float>(now - m_frameStart).count();
+        m_frameTimes[m_historyNext] = deltaTime * 1000.0f;
+        m_historyNext = (m_historyNext + 1) % c_HISTORY_SIZE;
+        m_historyCount = std::min(m_historyCount + 1, c_HISTORY_SIZE);
+    }
+    else
+    {
+        m_nextDeadline = now;
+        m_started = true;
+    }
+    m_frameStart = now;
+    return deltaTime;
+}
+
+void FramePacer::EndFrame()
+{
+    const Clock::time_point now = Clock::now();
+    // the work time belongs to the frame BeginFrame will record next
+    m_workTimes[m_historyNext] = std::chrono::duration<float, std::milli>(now - m_frameStart).count();
+
+    if (m_mode != PacingMode::FixedRate)
+        return;
+
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_targetRate));
+    m_nextDeadline += period;
+    // a frame more than a period late starts a new schedule instead of rushing to catch up
+    if (now > m_nextDeadline + period)
+        m_nextDeadline = now;
+    WaitUntil(m_nextDeadline);
+}
+
+void FramePacer::WaitUntil(Clock::time_point deadline)
+{
+    double remaining = std::chrono::duration<double>(deadline - Clock::now()).count();
+    while (remaining > m_sleepEstimate)
+    {
+        const Clock::time_point start = Clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        const double observed = std::chrono::duration<double>(Clock::now() - start).count();
+        remaining -= observed;
+
+        // Welford's update of the sleep duration's mean and variance
+        m_sleepCount++;
+        const double delta = observed - m_sleepMean;
+        m_sleepMean += delta / static_cast<double>(m_sleepCount);
+        m_sleepM2 += delta * (observed - m_sleepMean);
+        m_sleepEstimate = m_sleepMean + std::sqrt(m_sleepM2 / static_cast<double>(m_sleepCount - 1));
+    }
+
+    while (Clock::now() < deadline)
+        std::this_thread::yield();
+}
+
+FramePacer::Stats FramePacer::GetStats() const
+{
+    Stats stats;
+    stats.frames = m_historyCount;
+    if (m_historyCount == 0)
+        return stats;
+
+    // the newest entries are the m_historyCount before m_historyNext, wrapping around
+    std::vector<float> frameTimes(m_historyCount);
+    float frameSum = 0.0f;
+    float workSum = 0.0f;
+    for (int i = 0; i < m_historyCount; i++)
+    {
+        const int index = (m_historyNext - 1 - i + c_HISTORY_SIZE) % c_HISTORY_SIZE;
+        frameTimes[i] = m_frameTimes[index];
+        frameSum += m_frameTimes[index];
+        workSum += m_workTimes[index];
+    }
+
+    stats.averageFrameTime = frameSum / static_cast<float>(m_historyCount);
+    stats.averageWorkTime = workSum / static_cast<float>(m_historyCount);
+    stats.minFrameTime = *std::min_element(frameTimes.begin(), frameTimes.end());
+    stats.maxFrameTime = *std::max_element(frameTimes.begin(), frameTimes.end());
+    const size_t percentile = std::min(frameTimes.size() - 1, frameTimes.size() * 99 / 100);
+    std::nth_element(frameTimes.begin(), frameTimes.begin() + percentile, frameTimes.end());
+    stats.percentile99FrameTime = frameTimes[percentile];
+    return stats;
+}
+
+const char* FramePacer::GetModeName(PacingMode mode)
+{
+    switch (mode)
+    {
+    case PacingMode::Uncapped: return "uncapped";
+    case PacingMode::AdaptiveVsync: return "adaptive vsync";
+    case PacingMode::FixedRate: return "fixed rate";
+    }
+    return "unknown";
+}
@@ -0,0 +1,130 @@
+#include "Frustum.h"
+#include "BoundingBox.h"
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FRUSTUM_SSE 1
+#include <xmmintrin.h>
+#endif
+
+void Frustum::Update(const glm::mat4& viewProjection)
+{
+    // glm is column major, row i of the matrix is element i of every column
+    auto row = [&](int i) {
+        return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    };
+    const glm::vec4 x = row(0), y = row(1), z = row(2), w = row(3);
+
+    // left, right, bottom, top, near, far, for GL clip space where -w <= z <= w
+    const glm::vec4 planes[c_PLANE_COUNT] = { w + x, w - x, w + y, w - y, w + z, w - z };
+    for (int i = 0; i < c_PLANE_COUNT; i++)
+    {
+        const float length = std::sqrt(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+        const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+        m_a[i] = planes[i].x * scale;
+        m_b[i] = planes[i].y * scale;
+        m_c[i] = planes[i].z * scale;
+        m_d[i] = planes[i].w * scale;
+    }
+}
+
+void Frustum::CullBoxes(const float* centerX, const float* centerY, const float* centerZ,
+                        const float* extentX, const float* extentY, const float* extentZ,
+                        int count, std::uint8_t* outVisible) const
+{
+    int k = 0;
+#if defined(FRUSTUM_SSE)
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    for (; k + 4 <= count; k += 4)
+    {
+        const __m128 cx = _mm_loadu_ps(centerX + k), cy = _mm_loadu_ps(centerY + k), cz = _mm_loadu_ps(centerZ + k);
+        const __m128 ex = _mm_loadu_ps(extentX + k), ey = _mm_loadu_ps(extentY + k), ez = _mm_loadu_ps(extentZ + k);
+
+        // a box is outside a plane when even its corner furthest along the normal is behind it
+        __m128 inside = _mm_cmpeq_ps(cx, cx);
+        for (int i = 0; i < c_PLANE_COUNT; i++)
+        {
+            const __m128 a = _mm_set1_ps(m_a[i]), b = _mm_set1_ps(m_b[i]), c = _mm_set1_ps(m_c[i]);
+            const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, cx), _mm_mul_ps(b, cy)),
+                                               _mm_add_ps(_mm_mul_ps(c, cz), _mm_set1_ps(m_d[i])));
+            const __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, a), ex),
+                                                        _mm_mul_ps(_mm_andnot_ps(signMask, b), ey)),
+                                             _mm_mul_ps(_mm_andnot_ps(signMask, c), ez));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+
+        const int mask = _mm_movemask_ps(inside);
+        for (int lane = 0; lane < 4; lane++)
+            outVisible[k + lane] = static_cast<std::uint8_t>((mask >> lane) & 1);
+    }
+#endif
+    CullBoxesScalar(centerX, centerY, centerZ, extentX, extentY, extentZ, k, count, outVisible);
+}
+
+void Frustum::CullSpheres(const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+                          int count, std::uint8_t* outVisible) const
+{
+    int k = 0;
+#if defined(FRUSTUM_SSE)
+    for (; k + 4 <= count; k += 4)
+    {
+        const __m128 cx = _mm_loadu_ps(centerX + k), cy = _mm_loadu_ps(centerY + k), cz = _mm_loadu_ps(centerZ + k);
+        const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + k));
+
+        __m128 inside = _mm_cmpeq_ps(cx, cx);
+        for (int i = 0; i < c_PLANE_COUNT; i++)
+        {
+            const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m_a[i]), cx), _mm_mul_ps(_mm_set1_ps(m_b[i]), cy)),
+                                               _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m_c[i]), cz), _mm_set1_ps(m_d[i])));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+        }
+
+        const int mask = _mm_movemask_ps(inside);
+        for (int lane = 0; lane < 4; lane++)
+            outVisible[k + lane] = static_cast<std::uint8_t>((mask >> lane) & 1);
+    }
+#endif
+    CullSpheresScalar(centerX, centerY, centerZ, radius, k, count, outVisible);
+}
+
+bool Frustum::IsVisible(const BoundingBox& box) const
+{
+    if (box.IsEmpty())
+        return false;
+
+    const glm::vec3 center = box.GetCenter();
+    const glm::vec3 extent = box.GetExtent();
+    std::uint8_t visible = 0;
+    CullBoxesScalar(&center.x, &center.y, &center.z, &extent.x, &extent.y, &extent.z, 0, 1, &visible);
+    return visible != 0;
+}
+
+void Frustum::CullBoxesScalar(const float* centerX, const float* centerY, const float* centerZ,
+                              const float* extentX, const float* extentY, const float* extentZ,
+                              int begin, int count, std::uint8_t* outVisible) const
+{
+    for (int k = begin; k < count; k++)
+    {
+        bool inside = true;
+        for (int i = 0; i < c_PLANE_COUNT && inside; i++)
+        {
+            const float distance = m_a[i] * centerX[k] + m_b[i] * centerY[k] + m_c[i] * centerZ[k] + m_d[i];
+            const float radius = std::abs(m_a[i]) * extentX[k] + std::abs(m_b[i]) * extentY[k] + std::abs(m_c[i]) * extentZ[k];
+            inside = distance + radius >= 0.0f;
+        }
+        outVisible[k] = inside ? 1 : 0;
+    }
+}
+
+void Frustum::CullSpheresScalar(const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+                                int begin, int count, std::uint8_t* outVisible) const
+{
+    for (int k = begin; k < count; k++)
+    {
+        bool inside = true;
+        for (int i = 0; i < c_PLANE_COUNT && inside; i++)
+            inside = m_a[i] * centerX[k] + m_b[i] * centerY[k] + m_c[i] * centerZ[k] + m_d[i] >= -radius[k];
+        outVisible[k] = inside ? 1 : 0;
+    }
+}
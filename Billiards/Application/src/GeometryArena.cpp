@@ -0,0 +1,357 @@
+#include "GeometryArena.h"
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cstddef> // offsetof
+#include <cstdint>
+#include <utility>
+
+std::unique_ptr<GeometryArena> GeometryArena::s_instance;
+
+GLuint GeometryArena::Allocation::GetFirstIndex() const
+{
+    return static_cast<GLuint>(indexOffset / (indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(GLuint)));
+}
+
+void GeometryArena::Initialize()
+{
+    if (!s_instance)
+        s_instance.reset(new GeometryArena());
+}
+
+void GeometryArena::Shutdown()
+{
+    s_instance.reset();
+}
+
+GeometryArena::GeometryArena()
+    : m_vertexRanges(c_INITIAL_VERTEX_BYTES), m_indexRanges(c_INITIAL_INDEX_BYTES)
+{
+    glGenVertexArrays(2, m_vertexArrays);
+    glGenBuffers(1, &m_vertexBuffer);
+    glGenBuffers(1, &m_indexBuffer);
+
+    // the copy targets are used for every upload, binding GL_ELEMENT_ARRAY_BUFFER would change the bound VAO
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, c_INITIAL_VERTEX_BYTES, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, c_INITIAL_INDEX_BYTES, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    SetupVertexArrays();
+}
+
+GeometryArena::~GeometryArena()
+{
+    glDeleteVertexArrays(2, m_vertexArrays);
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteBuffers(1, &m_indexBuffer);
+}
+
+GeometryArena::Allocation GeometryArena::Allocate(GLsizei vertexCount, GLsizei indexCount, GLenum indexType)
+{
+    const std::size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(GLuint);
+
+    std::size_t vertexOffset = 0;
+    Allocate(m_vertexRanges, m_vertexBuffer, vertexCount * sizeof(PackedVertex), sizeof(PackedVertex), vertexOffset);
+
+    Allocation allocation;
+    allocation.baseVertex = static_cast<GLint>(vertexOffset / sizeof(PackedVertex));
+    allocation.vertexCount = vertexCount;
+    allocation.indexCount = indexCount;
+    allocation.indexType = indexType;
+    Allocate(m_indexRanges, m_indexBuffer, indexCount * indexSize, sizeof(GLuint), allocation.indexOffset);
+    return allocation;
+}
+
+void GeometryArena::Free(const Allocation& allocation)
+{
+    if (!allocation.IsValid())
+        return;
+
+    const std::size_t indexSize = allocation.indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(GLuint);
+    m_vertexRanges.Free(allocation.baseVertex * sizeof(PackedVertex), allocation.vertexCount * sizeof(PackedVertex));
+    m_indexRanges.Free(allocation.indexOffset, allocation.indexCount * indexSize);
+}
+
+void GeometryArena::Write(const Allocation& allocation, const PackedVertex* vertices, const GLsizei* indices)
+{
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.baseVertex * sizeof(PackedVertex),
+                    allocation.vertexCount * sizeof(PackedVertex), vertices);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexBuffer);
+    if (allocation.indexType == GL_UNSIGNED_SHORT)
+    {
+        std::vector<std::uint16_t> shortIndices(allocation.indexCount);
+        for (GLsizei i = 0; i < allocation.indexCount; i++)
+            shortIndices[i] = static_cast<std::uint16_t>(indices[i]);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset, allocation.indexCount * sizeof(std::uint16_t),
+                        shortIndices.data());
+    }
+    else
+    {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset, allocation.indexCount * sizeof(GLuint), indices);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// allocate from ranges, growing buffer to at least twice its size when it is full
+void GeometryArena::Allocate(RangeAllocator& ranges, GLuint& buffer, std::size_t size, std::size_t alignment,
+                             std::size_t& outOffset)
+{
+    if (ranges.Allocate(size, alignment, outOffset))
+        return;
+
+    const std::size_t oldCapacity = ranges.GetCapacity();
+    const std::size_t capacity = std::max(oldCapacity * 2, oldCapacity + size + alignment);
+
+    // offsets survive the copy, so existing allocations and draw batches stay valid
+    GLuint grown = 0;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldCapacity);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+    buffer = grown;
+
+    ranges.Grow(capacity);
+    SetupVertexArrays();
+    ranges.Allocate(size, alignment, outOffset);
+}
+
+void GeometryArena::SetupVertexArrays() const
+{
+    for (GLuint vertexArray : m_vertexArrays)
+    {
+        glBindVertexArray(vertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+
+        // vertex attributes, locations as declared in model.vert
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoord));
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GeometryArena::RangeAllocator::RangeAllocator(std::size_t capacity)
+    : m_capacity(capacity)
+{
+    m_free.push_back({ 0, capacity });
+}
+
+bool GeometryArena::RangeAllocator::Allocate(std::size_t size, std::size_t alignment, std::size_t& outOffset)
+{
+    for (size_t i = 0; i < m_free.size(); i++)
+    {
+        const Range range = m_free[i];
+        const std::size_t aligned = (range.offset + alignment - 1) / alignment * alignment;
+        const std::size_t padding = aligned - range.offset;
+        if (range.size < padding + size)
+            continue;
+
+        // keep the padding in front and the rest behind as free ranges
+        const Range tail = { aligned + size, range.size - padding - size };
+        if (padding > 0)
+        {
+            m_free[i].size = padding;
+            if (tail.size > 0)
+                m_free.insert(m_free.begin() + i + 1, tail);
+        }
+        else if (tail.size > 0)
+        {
+            m_free[i] = tail;
+        }
+        else
+        {
+            m_free.erase(m_free.begin() + i);
+        }
+
+        m_used += size;
+        outOffset = aligned;
+        return true;
+    }
+    return false;
+}
+
+void GeometryArena::RangeAllocator::Free(std::size_t offset, std::size_t size)
+{
+    if (size == 0)
+        return;
+    m_used -= size;
+
+    auto next = std::lower_bound(m_free.begin(), m_free.end(), offset,
+                                 [](const Range& range, std::size_t value) { return range.offset < value; });
+    auto inserted = m_free.insert(next, { offset, size });
+
+    // merge with the following range, then with the preceding one
+    auto following = inserted + 1;
+    if (following != m_free.end() && inserted->offset + inserted->size == following->offset)
+    {
+        inserted->size += following->size;
+        m_free.erase(following);
+    }
+    if (inserted != m_free.begin())
+    {
+        auto preceding = inserted - 1;
+        if (preceding->offset + preceding->size == inserted->offset)
+        {
+            preceding->size += inserted->size;
+            m_free.erase(inserted);
+        }
+    }
+}
+
+void GeometryArena::RangeAllocator::Grow(std::size_t capacity)
+{
+    const std::size_t oldCapacity = m_capacity;
+    m_capacity = capacity;
+    m_used += capacity - oldCapacity; // Free takes it off again
+    Free(oldCapacity, capacity - oldCapacity);
+}
+
+DrawBatch::DrawBatch(const std::vector<Mesh>& meshes)
+{
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        const GeometryArena::Allocation& allocation = meshes[i].GetAllocation();
+        if (!allocation.IsValid() || allocation.indexCount == 0)
+            continue;
+
+        auto group = std::find_if(m_groups.begin(), m_groups.end(),
+                                  [&](const Group& g) { return g.indexType == allocation.indexType; });
+        if (group == m_groups.end())
+        {
+            Group added;
+            added.indexType = allocation.indexType;
+            m_groups.push_back(std::move(added));
+            group = m_groups.end() - 1;
+        }
+        group->counts.push_back(allocation.indexCount);
+        group->offsets.push_back(reinterpret_cast<const void*>(allocation.indexOffset));
+        group->baseVertices.push_back(allocation.baseVertex);
+        group->meshes.push_back(static_cast<int>(i));
+    }
+
+    if (!GLAD_GL_VERSION_4_3 || m_groups.empty())
+        return;
+
+    // one command per mesh, grouped by index type so every group is a single indirect call
+    std::vector<IndirectCommand> commands;
+    for (Group& group : m_groups)
+    {
+        group.indirectOffset = commands.size() * sizeof(IndirectCommand);
+        for (size_t i = 0; i < group.counts.size(); i++)
+        {
+            GeometryArena::Allocation allocation;
+            allocation.indexOffset = reinterpret_cast<std::size_t>(group.offsets[i]);
+            allocation.indexType = group.indexType;
+            commands.push_back({ static_cast<GLuint>(group.counts[i]), 1, allocation.GetFirstIndex(),
+                                 group.baseVertices[i], 0 });
+        }
+    }
+
+    glGenBuffers(1, &m_indirectBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(IndirectCommand), commands.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+DrawBatch::~DrawBatch()
+{
+    if (m_indirectBuffer != 0)
+        glDeleteBuffers(1, &m_indirectBuffer);
+}
+
+DrawBatch::DrawBatch(DrawBatch&& batch) noexcept
+    : m_groups(std::move(batch.m_groups)), m_indirectBuffer(batch.m_indirectBuffer)
+{
+    batch.m_indirectBuffer = 0;
+}
+
+DrawBatch& DrawBatch::operator=(DrawBatch&& batch) noexcept
+{
+    if (this != &batch)
+    {
+        if (m_indirectBuffer != 0)
+            glDeleteBuffers(1, &m_indirectBuffer);
+        m_groups = std::move(batch.m_groups);
+        m_indirectBuffer = batch.m_indirectBuffer;
+        batch.m_indirectBuffer = 0;
+    }
+    return *this;
+}
+
+void DrawBatch::Draw() const
+{
+    if (m_groups.empty())
+        return;
+
+    GeometryArena::Get().BindVertexArray();
+    Submit();
+}
+
+void DrawBatch::Submit() const
+{
+    if (m_indirectBuffer != 0)
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+        for (const Group& group : m_groups)
+        {
+            glMultiDrawElementsIndirect(GL_TRIANGLES, group.indexType, reinterpret_cast<const void*>(group.indirectOffset),
+                                        static_cast<GLsizei>(group.counts.size()), 0);
+        }
+        return; // the indirect binding is left in place, only indirect draws read it
+    }
+
+    for (const Group& group : m_groups)
+    {
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, group.counts.data(), group.indexType, group.offsets.data(),
+                                      static_cast<GLsizei>(group.counts.size()), group.baseVertices.data());
+    }
+}
+
+int DrawBatch::SubmitVisible(const std::uint8_t* meshVisible) const
+{
+    // partially visible batches are rare enough that compacting the client side arrays beats rewriting the
+    // indirect buffer, glMultiDrawElementsBaseVertex takes them on every version
+    int calls = 0;
+    for (const Group& group : m_groups)
+    {
+        m_visibleCounts.clear();
+        m_visibleOffsets.clear();
+        m_visibleBaseVertices.clear();
+        for (size_t i = 0; i < group.meshes.size(); i++)
+        {
+            if (!meshVisible[group.meshes[i]])
+                continue;
+            m_visibleCounts.push_back(group.counts[i]);
+            m_visibleOffsets.push_back(group.offsets[i]);
+            m_visibleBaseVertices.push_back(group.baseVertices[i]);
+        }
+        if (m_visibleCounts.empty())
+            continue;
+
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_visibleCounts.data(), group.indexType, m_visibleOffsets.data(),
+                                      static_cast<GLsizei>(m_visibleCounts.size()), m_visibleBaseVertices.data());
+        calls++;
+    }
+    return calls;
+}
+
+int DrawBatch::GetCallCount() const
+{
+    return static_cast<int>(m_groups.size());
+}
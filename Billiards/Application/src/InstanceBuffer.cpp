@@ -0,0 +1,140 @@
+#include "InstanceBuffer.h"
+
+#include <cstddef>
+#include <stdexcept>
+
+InstanceBuffer::InstanceBuffer(GLsizei capacity)
+    : m_capacity(capacity)
+{
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+
+    if (GLAD_GL_VERSION_4_4)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLsizeiptr size = static_cast<GLsizeiptr>(sizeof(BallInstance)) * capacity * c_REGION_COUNT;
+        glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        m_persistent = static_cast<BallInstance*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+        if (!m_persistent)
+            throw std::runtime_error("Failed to persistently map the instance buffer");
+    }
+    else
+    {
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(sizeof(BallInstance)) * capacity, nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    for (GLsync& fence : m_fences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+    }
+
+    if (m_buffer != 0)
+    {
+        if (m_persistent)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &m_buffer);
+    }
+}
+
+BallInstance* InstanceBuffer::Map(GLsizei count)
+{
+    if (count > m_capacity)
+        throw std::runtime_error("Instance count exceeds the instance buffer capacity");
+    m_count = count;
+
+    if (m_persistent)
+    {
+        m_region = (m_region + 1) % c_REGION_COUNT;
+
+        // the region was last used c_REGION_COUNT frames ago, normally this fence has long been signalled
+        if (GLsync& fence = m_fences[m_region])
+        {
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+            {
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        return m_persistent + static_cast<std::size_t>(m_region) * m_capacity;
+    }
+
+    // orphan the old storage so the driver does not stall on draws still reading it
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    void* data = glMapBufferRange(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(sizeof(BallInstance)) * m_capacity,
+                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (!data)
+        throw std::runtime_error("Failed to map the instance buffer");
+    return static_cast<BallInstance*>(data);
+}
+
+void InstanceBuffer::Unmap()
+{
+    // coherent persistent mappings need no unmap or flush
+    if (m_persistent)
+        return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::Fence()
+{
+    if (!m_persistent)
+        return;
+
+    if (m_fences[m_region])
+        glDeleteSync(m_fences[m_region]);
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void InstanceBuffer::BindAttributes() const
+{
+    const std::size_t base = m_persistent ? sizeof(BallInstance) * static_cast<std::size_t>(m_region) * m_capacity : 0;
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    for (GLuint column = 0; column < 4; column++)
+    {
+        const GLuint location = c_INSTANCE_TRANSFORM_LOCATION + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(BallInstance),
+                              (void*)(base + offsetof(BallInstance, transform) + sizeof(glm::vec4) * column));
+        glVertexAttribDivisor(location, 1);
+    }
+
+    for (GLuint column = 0; column < 3; column++)
+    {
+        const GLuint location = c_INSTANCE_NORMAL_LOCATION + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(BallInstance),
+                              (void*)(base + offsetof(BallInstance, normalMatrix) + sizeof(glm::vec4) * column));
+        glVertexAttribDivisor(location, 1);
+    }
+
+    glEnableVertexAttribArray(c_INSTANCE_BALL_ID_LOCATION);
+    glVertexAttribIPointer(c_INSTANCE_BALL_ID_LOCATION, 1, GL_UNSIGNED_INT, sizeof(BallInstance),
+                           (void*)(base + offsetof(BallInstance, ballId)));
+    glVertexAttribDivisor(c_INSTANCE_BALL_ID_LOCATION, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::SetSingleInstance(const glm::mat4& transform, const glm::mat3& normalMatrix, std::uint32_t ballId)
+{
+    // attributes without an enabled array read these current values for every vertex
+    for (GLuint column = 0; column < 4; column++)
+        glVertexAttrib4fv(c_INSTANCE_TRANSFORM_LOCATION + column, &transform[column][0]);
+    for (GLuint column = 0; column < 3; column++)
+        glVertexAttrib3fv(c_INSTANCE_NORMAL_LOCATION + column, &normalMatrix[column][0]);
+    glVertexAttribI4ui(c_INSTANCE_BALL_ID_LOCATION, ballId, 0, 0, 0);
+}
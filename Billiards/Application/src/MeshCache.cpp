@@ -0,0 +1,291 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    constexpr char c_MAGIC[4] = { 'B', 'M', 'S', 'H' };
+    constexpr std::uint64_t c_FNV_OFFSET = 14695981039346656037ull;
+    constexpr std::uint64_t c_FNV_PRIME = 1099511628211ull;
+    constexpr std::size_t c_ALIGNMENT = 16; // buffer offsets, keeps the mapped vertices aligned
+    const char* const c_CACHE_DIRECTORY = "cache/meshes";
+
+    struct FileHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t vertexSize; // sizeof(PackedVertex) when written
+        std::uint32_t meshCount;
+        std::uint64_t sourceSize;
+        std::int64_t sourceModifiedTime;
+        std::uint64_t sourceHash;
+        std::uint32_t pathLength; // source path stored right after the header, guards against name collisions
+        std::uint32_t reserved;
+        std::uint64_t railOffset; // collision blob after the mesh buffers
+        std::uint64_t railSize;
+    };
+
+    struct MeshEntry
+    {
+        std::uint64_t vertexOffset;
+        std::uint64_t indexOffset;
+        std::uint32_t vertexCount;
+        std::uint32_t indexCount;
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    std::uint64_t AlignUp(std::uint64_t value)
+    {
+        return (value + c_ALIGNMENT - 1) & ~std::uint64_t(c_ALIGNMENT - 1);
+    }
+}
+
+std::string MeshCache::GetCachePath(const std::string& sourcePath)
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx",
+                  static_cast<unsigned long long>(Hash(sourcePath.data(), sourcePath.size(), c_FNV_OFFSET)));
+    return std::string(c_CACHE_DIRECTORY) + "/" + name + ".meshcache";
+}
+
+bool MeshCache::Load(const std::string& sourcePath, std::vector<Mesh>& outMeshes)
+{
+    MappedFile file;
+    std::vector<MeshView> views;
+    bool stale = false;
+    if (!Map(sourcePath, file, views, stale))
+        return false;
+
+    outMeshes = Mesh::CreateBatch(views);
+    file.Close();
+    if (stale)
+        RefreshSourceTime(sourcePath);
+    return true;
+}
+
+bool MeshCache::Read(const std::string& sourcePath, std::vector<MeshData>& outMeshes,
+                     std::vector<std::uint8_t>* outRails)
+{
+    MappedFile file;
+    std::vector<MeshView> views;
+    bool stale = false;
+    if (!Map(sourcePath, file, views, stale, outRails))
+        return false;
+
+    outMeshes.resize(views.size());
+    for (size_t i = 0; i < views.size(); i++)
+    {
+        outMeshes[i].vertices.assign(views[i].vertices, views[i].vertices + views[i].vertexCount);
+        outMeshes[i].indices.assign(views[i].indices, views[i].indices + views[i].indexCount);
+        outMeshes[i].bounds = views[i].bounds;
+    }
+    file.Close();
+    if (stale)
+        RefreshSourceTime(sourcePath);
+    return true;
+}
+
+bool MeshCache::Map(const std::string& sourcePath, MappedFile& file, std::vector<MeshView>& outViews,
+                    bool& outStale, std::vector<std::uint8_t>* outRails)
+{
+    const std::string cachePath = GetCachePath(sourcePath);
+    if (!file.Open(cachePath) || file.GetSize() < sizeof(FileHeader))
+        return false;
+
+    FileHeader header;
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    if (std::memcmp(header.magic, c_MAGIC, sizeof(c_MAGIC)) != 0 || header.version != c_VERSION
+        || header.vertexSize != sizeof(PackedVertex) || header.pathLength != sourcePath.size())
+        return false;
+
+    const std::size_t tableOffset = sizeof(FileHeader) + header.pathLength;
+    const std::size_t dataOffset = tableOffset + sizeof(MeshEntry) * header.meshCount;
+    if (dataOffset > file.GetSize()
+        || std::memcmp(file.GetData() + sizeof(FileHeader), sourcePath.data(), header.pathLength) != 0)
+        return false;
+
+    // a stale modification time alone (checkout, copy) does not invalidate the entry if the content is unchanged,
+    // the caller then stores the new time so later starts skip the hash again
+    outStale = false;
+    SourceStamp stamp;
+    if (ReadSourceStamp(sourcePath, stamp))
+    {
+        if (stamp.size != header.sourceSize)
+            return false;
+        if (stamp.modifiedTime != header.sourceModifiedTime)
+        {
+            std::uint64_t hash = 0;
+            if (!HashSource(sourcePath, hash) || hash != header.sourceHash)
+                return false;
+            outStale = true;
+        }
+    }
+
+    std::vector<MeshEntry> entries(header.meshCount);
+    if (header.meshCount > 0)
+        std::memcpy(entries.data(), file.GetData() + tableOffset, sizeof(MeshEntry) * header.meshCount);
+    for (const MeshEntry& entry : entries)
+    {
+        if (entry.vertexOffset + std::uint64_t(entry.vertexCount) * sizeof(PackedVertex) > file.GetSize()
+            || entry.indexOffset + std::uint64_t(entry.indexCount) * sizeof(GLsizei) > file.GetSize())
+            return false;
+    }
+    if (header.railOffset + header.railSize > file.GetSize())
+        return false;
+
+    outViews.clear();
+    outViews.reserve(entries.size());
+    for (const MeshEntry& entry : entries)
+    {
+        MeshView view;
+        view.vertices = reinterpret_cast<const PackedVertex*>(file.GetData() + entry.vertexOffset);
+        view.indices = reinterpret_cast<const GLsizei*>(file.GetData() + entry.indexOffset);
+        view.vertexCount = static_cast<GLsizei>(entry.vertexCount);
+        view.indexCount = static_cast<GLsizei>(entry.indexCount);
+        view.bounds.min = glm::vec3(entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2]);
+        view.bounds.max = glm::vec3(entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2]);
+        outViews.push_back(view);
+    }
+
+    if (outRails)
+        outRails->assign(file.GetData() + header.railOffset, file.GetData() + header.railOffset + header.railSize);
+    return true;
+}
+
+bool MeshCache::Store(const std::string& sourcePath, const std::vector<MeshData>& meshes,
+                      const std::vector<std::uint8_t>& rails)
+{
+    FileHeader header = {};
+    std::memcpy(header.magic, c_MAGIC, sizeof(c_MAGIC));
+    header.version = c_VERSION;
+    header.vertexSize = sizeof(PackedVertex);
+    header.meshCount = static_cast<std::uint32_t>(meshes.size());
+    header.pathLength = static_cast<std::uint32_t>(sourcePath.size());
+
+    SourceStamp stamp;
+    if (!ReadSourceStamp(sourcePath, stamp) || !HashSource(sourcePath, header.sourceHash))
+        return false;
+    header.sourceSize = stamp.size;
+    header.sourceModifiedTime = stamp.modifiedTime;
+
+    std::vector<MeshEntry> entries(meshes.size());
+    std::uint64_t offset = AlignUp(sizeof(FileHeader) + sourcePath.size() + sizeof(MeshEntry) * meshes.size());
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        entries[i].vertexCount = static_cast<std::uint32_t>(meshes[i].vertices.size());
+        entries[i].indexCount = static_cast<std::uint32_t>(meshes[i].indices.size());
+        for (int axis = 0; axis < 3; axis++)
+        {
+            entries[i].boundsMin[axis] = meshes[i].bounds.min[axis];
+            entries[i].boundsMax[axis] = meshes[i].bounds.max[axis];
+        }
+        entries[i].vertexOffset = offset;
+        offset = AlignUp(offset + sizeof(PackedVertex) * meshes[i].vertices.size());
+        entries[i].indexOffset = offset;
+        offset = AlignUp(offset + sizeof(GLsizei) * meshes[i].indices.size());
+    }
+    header.railOffset = offset;
+    header.railSize = rails.size();
+
+    std::error_code error;
+    std::filesystem::create_directories(c_CACHE_DIRECTORY, error);
+
+    // write next to the entry and rename, so a crash never leaves a half written entry behind
+    const std::string cachePath = GetCachePath(sourcePath);
+    const std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+
+        const char padding[c_ALIGNMENT] = {};
+        auto padTo = [&](std::uint64_t position) {
+            const std::uint64_t current = static_cast<std::uint64_t>(out.tellp());
+            out.write(padding, static_cast<std::streamsize>(position - current));
+        };
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(sourcePath.data(), static_cast<std::streamsize>(sourcePath.size()));
+        out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(sizeof(MeshEntry) * entries.size()));
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            padTo(entries[i].vertexOffset);
+            out.write(reinterpret_cast<const char*>(meshes[i].vertices.data()),
+                      static_cast<std::streamsize>(sizeof(PackedVertex) * meshes[i].vertices.size()));
+            padTo(entries[i].indexOffset);
+            out.write(reinterpret_cast<const char*>(meshes[i].indices.data()),
+                      static_cast<std::streamsize>(sizeof(GLsizei) * meshes[i].indices.size()));
+        }
+        padTo(header.railOffset);
+        out.write(reinterpret_cast<const char*>(rails.data()), static_cast<std::streamsize>(rails.size()));
+        if (!out)
+            return false;
+    }
+
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error)
+    {
+        std::cerr << "Failed to write mesh cache " << cachePath << ": " << error.message() << std::endl;
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+void MeshCache::RefreshSourceTime(const std::string& sourcePath)
+{
+    SourceStamp stamp;
+    if (!ReadSourceStamp(sourcePath, stamp))
+        return;
+
+    // only the one field changes, so it is patched in place instead of rewriting the entry
+    std::fstream file(GetCachePath(sourcePath), std::ios::binary | std::ios::in | std::ios::out);
+    if (!file)
+        return;
+    file.seekp(static_cast<std::streamoff>(offsetof(FileHeader, sourceModifiedTime)));
+    file.write(reinterpret_cast<const char*>(&stamp.modifiedTime), sizeof(stamp.modifiedTime));
+}
+
+bool MeshCache::ReadSourceStamp(const std::string& sourcePath, SourceStamp& outStamp)
+{
+    std::error_code error;
+    const std::uintmax_t size = std::filesystem::file_size(sourcePath, error);
+    if (error)
+        return false;
+    const auto modifiedTime = std::filesystem::last_write_time(sourcePath, error);
+    if (error)
+        return false;
+
+    outStamp.size = static_cast<std::uint64_t>(size);
+    outStamp.modifiedTime = static_cast<std::int64_t>(modifiedTime.time_since_epoch().count());
+    return true;
+}
+
+bool MeshCache::HashSource(const std::string& sourcePath, std::uint64_t& outHash)
+{
+    MappedFile source;
+    if (!source.Open(sourcePath))
+        return false;
+    outHash = Hash(source.GetData(), source.GetSize(), c_FNV_OFFSET);
+    return true;
+}
+
+// FNV-1a, 64 bit
+std::uint64_t MeshCache::Hash(const void* data, std::size_t size, std::uint64_t seed)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    std::uint64_t hash = seed;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= c_FNV_PRIME;
+    }
+    return hash;
+}
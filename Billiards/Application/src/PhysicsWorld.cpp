@@ -0,0 +1,796 @@
+#include "PhysicsWorld.h"
+#include "StrictFloat.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+    // a ball falls asleep once friction would stop it within 1/120 s, eight fixed steps at the default 1/960 s,
+    // so the thresholds follow from the rolling friction of table 3 and the spin deceleration of table 4. It is a
+    // constant rather than a multiple of the step, so changing the step does not move the thresholds.
+    constexpr float c_SLEEP_TIME = 1.0f / 120.0f; // s
+    constexpr float c_SLEEP_SPEED = c_FRICTION_ROLL * c_GRAVITY * c_SLEEP_TIME; // m/s, under 1 mm/s
+    constexpr float c_SLEEP_SPIN = c_SPIN_DECELERATION * c_SLEEP_TIME; // rad/s
+
+    // islands are rebuilt whenever a moving ball has covered half the skin, and on a crowded table some ball always
+    // has, so from this many balls on the grid pairs them up every step instead. Measured on random breaks: a
+    // 16 ball break took 0.95 ms with islands and 3.5 ms with the grid every step, 512 balls were even at about
+    // 0.045 ms per step, and 640 balls took 0.09 ms with islands and 0.07 ms with the grid
+    constexpr int c_GRID_MIN_BALLS = 576;
+    // room around a ball's reach, islands last until a moving ball has covered half of it
+    constexpr float c_ISLAND_SKIN = c_BALL_RADIUS;
+
+    bool IsMoving(BallState state)
+    {
+        return state == BallState::Sliding || state == BallState::Rolling;
+    }
+
+    // pocket centres: four corners and the two side pockets
+    constexpr float c_POCKETS[c_POCKET_COUNT][2] = {
+        { -0.5f * c_TABLE_LENGTH, -0.5f * c_TABLE_WIDTH },
+        { 0.0f, -0.5f * c_TABLE_WIDTH },
+        { 0.5f * c_TABLE_LENGTH, -0.5f * c_TABLE_WIDTH },
+        { -0.5f * c_TABLE_LENGTH, 0.5f * c_TABLE_WIDTH },
+        { 0.0f, 0.5f * c_TABLE_WIDTH },
+        { 0.5f * c_TABLE_LENGTH, 0.5f * c_TABLE_WIDTH },
+    };
+
+    // move the spin around the vertical axis towards zero
+    float DecaySpin(float spin, float dt)
+    {
+        const float decay = c_SPIN_DECELERATION * dt;
+        if (std::fabs(spin) <= decay)
+            return 0.0f;
+        return spin > 0.0f ? spin - decay : spin + decay;
+    }
+}
+
+PhysicsWorld::PhysicsWorld(float fixedStep, int maxSubsteps)
+    : m_fixedStep(fixedStep), m_maxSubsteps(maxSubsteps),
+    m_grid(-0.5f * c_TABLE_LENGTH, -0.5f * c_TABLE_WIDTH, 0.5f * c_TABLE_LENGTH, 0.5f * c_TABLE_WIDTH, c_BALL_DIAMETER),
+    m_islandGrid(-0.5f * c_TABLE_LENGTH, -0.5f * c_TABLE_WIDTH, 0.5f * c_TABLE_LENGTH, 0.5f * c_TABLE_WIDTH, c_BALL_DIAMETER + c_ISLAND_SKIN),
+    m_kernelPath(CollisionKernel::GetBestPath())
+{
+    m_posX.reserve(c_BALL_COUNT);
+    m_posY.reserve(c_BALL_COUNT);
+    m_velX.reserve(c_BALL_COUNT);
+    m_velY.reserve(c_BALL_COUNT);
+    m_angX.reserve(c_BALL_COUNT);
+    m_angY.reserve(c_BALL_COUNT);
+    m_angZ.reserve(c_BALL_COUNT);
+    m_state.reserve(c_BALL_COUNT);
+    m_awake.reserve(c_BALL_COUNT);
+}
+
+void PhysicsWorld::Update(float deltaTime)
+{
+    if (m_solverMode == SolverMode::EventDriven)
+    {
+        m_eventSolver.Advance(*this, deltaTime);
+        m_islandsValid = false; // the solver moves balls without bumping the revision
+        return;
+    }
+
+    m_accumulator += deltaTime;
+
+    int substeps = 0;
+    while (m_accumulator >= m_fixedStep && substeps < m_maxSubsteps)
+    {
+        Step(m_fixedStep);
+        m_accumulator -= m_fixedStep;
+        ++substeps;
+    }
+
+    // drop the time we could not catch up on instead of carrying it into the next frame
+    if (substeps == m_maxSubsteps)
+        m_accumulator = std::min(m_accumulator, m_fixedStep);
+}
+
+void PhysicsWorld::Step(float dt)
+{
+    m_time += dt;
+    ++m_stepCount;
+
+    // anything but a step since the last one may have woken or moved balls behind the islands' back
+    const bool touched = m_revision != m_stepRevision;
+    if (touched)
+        m_islandsValid = false;
+    // a table that slept through the last step sleeps on until something touches it
+    if (m_awake.empty() && !touched)
+        return;
+    if (!UpdateAwakeSet())
+    {
+        m_stepRevision = m_revision;
+        return;
+    }
+
+    ++m_revision;
+    if (m_rails)
+    {
+        m_stepStartX.resize(m_posX.size());
+        m_stepStartY.resize(m_posY.size());
+        for (int i : m_awake)
+        {
+            m_stepStartX[i] = m_posX[i];
+            m_stepStartY[i] = m_posY[i];
+        }
+    }
+    IntegrateBalls(dt);
+    CheckPockets();
+    ResolveCushionCollisions();
+    ResolveBallCollisions();
+    m_stepRevision = m_revision;
+}
+
+float PhysicsWorld::SimulateUntilRest(float maxTime)
+{
+    const float startTime = m_time;
+    if (m_solverMode == SolverMode::EventDriven)
+    {
+        m_eventSolver.AdvanceUntilRest(*this, maxTime);
+        m_islandsValid = false;
+        return m_time - startTime;
+    }
+
+    while (!IsAtRest() && m_time - startTime < maxTime)
+        Step(m_fixedStep);
+    return m_time - startTime;
+}
+
+int PhysicsWorld::AddBall(float x, float y)
+{
+    m_posX.push_back(x);
+    m_posY.push_back(y);
+    m_velX.push_back(0.0f);
+    m_velY.push_back(0.0f);
+    m_angX.push_back(0.0f);
+    m_angY.push_back(0.0f);
+    m_angZ.push_back(0.0f);
+    m_state.push_back(BallState::Stationary);
+    ++m_revision;
+    return GetBallCount() - 1;
+}
+
+void PhysicsWorld::Clear()
+{
+    m_posX.clear();
+    m_posY.clear();
+    m_velX.clear();
+    m_velY.clear();
+    m_angX.clear();
+    m_angY.clear();
+    m_angZ.clear();
+    m_state.clear();
+    m_accumulator = 0.0f;
+    m_time = 0.0f;
+    ++m_revision;
+}
+
+void PhysicsWorld::RackBalls()
+{
+    Clear();
+
+    // cue ball on the head spot
+    AddBall(-0.25f * c_TABLE_LENGTH, 0.0f);
+
+    // triangle with its apex on the foot spot, a tiny gap keeps the balls from starting in contact
+    const float spacing = c_BALL_DIAMETER * 1.001f;
+    const float rowSpacing = spacing * 0.8660254f; // sqrt(3) / 2
+    const float footX = 0.25f * c_TABLE_LENGTH;
+    for (int row = 0; row < 5; row++)
+    {
+        for (int i = 0; i <= row; i++)
+        {
+            AddBall(footX + row * rowSpacing, (i - 0.5f * row) * spacing);
+        }
+    }
+}
+
+void PhysicsWorld::Strike(int ball, const CueShot& shot)
+{
+    if (ball < 0 || ball >= GetBallCount() || m_state[ball] == BallState::Pocketed)
+        return;
+
+    const float dirX = std::cos(shot.angle);
+    const float dirY = std::sin(shot.angle);
+    m_velX[ball] = dirX * shot.speed;
+    m_velY[ball] = dirY * shot.speed;
+
+    // angular impulse from an off-centre hit: w = m * v * offset * R / I = 5 * v * offset / (2 * R)
+    const float spinScale = 2.5f * shot.speed / c_BALL_RADIUS;
+    m_angX[ball] = -dirY * spinScale * shot.topSpin;
+    m_angY[ball] = dirX * spinScale * shot.topSpin;
+    m_angZ[ball] = -spinScale * shot.sideSpin; // right english spins clockwise seen from above
+
+    m_state[ball] = BallState::Sliding;
+    ++m_revision;
+}
+
+void PhysicsWorld::LoadState(const TableState& table)
+{
+    Clear();
+    for (int i = 0; i < table.ballCount; i++)
+    {
+        AddBall(table.posX[i], table.posY[i]);
+        m_state[i] = table.state[i] == BallState::Pocketed ? BallState::Pocketed : BallState::Stationary;
+    }
+}
+
+void PhysicsWorld::SaveState(TableState& table) const
+{
+    const int count = std::min(GetBallCount(), c_BALL_COUNT);
+    table.ballCount = static_cast<std::uint8_t>(count);
+    std::copy_n(m_posX.begin(), count, table.posX);
+    std::copy_n(m_posY.begin(), count, table.posY);
+    std::copy_n(m_state.begin(), count, table.state);
+}
+
+void PhysicsWorld::SetDeterministic(bool deterministic)
+{
+    m_deterministic = deterministic;
+    if (!deterministic)
+        return;
+
+    // the event solver's step lengths depend on root finding in double precision, and although the SIMD
+    // kernels report the same pairs, the scalar one does not even depend on the CPU
+    m_solverMode = SolverMode::FixedStep;
+    m_kernelPath = KernelPath::Scalar;
+}
+
+void PhysicsWorld::SetRailGeometry(std::shared_ptr<const RailGeometry> rails)
+{
+    m_rails = rails && !rails->IsEmpty() ? std::move(rails) : nullptr;
+    ++m_revision; // event predictions were made against the old cushions
+}
+
+void PhysicsWorld::SaveWorldState(WorldState& state) const
+{
+    const int count = std::min(GetBallCount(), c_BALL_COUNT);
+    state.ballCount = static_cast<std::uint8_t>(count);
+    std::copy_n(m_posX.begin(), count, state.posX);
+    std::copy_n(m_posY.begin(), count, state.posY);
+    std::copy_n(m_velX.begin(), count, state.velX);
+    std::copy_n(m_velY.begin(), count, state.velY);
+    std::copy_n(m_angX.begin(), count, state.angX);
+    std::copy_n(m_angY.begin(), count, state.angY);
+    std::copy_n(m_angZ.begin(), count, state.angZ);
+    std::copy_n(m_state.begin(), count, state.state);
+    state.time = m_time;
+    state.accumulator = m_accumulator;
+    state.stepCount = m_stepCount;
+}
+
+void PhysicsWorld::LoadWorldState(const WorldState& state)
+{
+    const int count = state.ballCount;
+    m_posX.assign(state.posX, state.posX + count);
+    m_posY.assign(state.posY, state.posY + count);
+    m_velX.assign(state.velX, state.velX + count);
+    m_velY.assign(state.velY, state.velY + count);
+    m_angX.assign(state.angX, state.angX + count);
+    m_angY.assign(state.angY, state.angY + count);
+    m_angZ.assign(state.angZ, state.angZ + count);
+    m_state.assign(state.state, state.state + count);
+    m_time = state.time;
+    m_accumulator = state.accumulator;
+    m_stepCount = state.stepCount;
+    ++m_revision;
+}
+
+void PhysicsWorld::SaveSnapshot(PhysicsSnapshot& snapshot) const
+{
+    const int count = std::min(GetBallCount(), c_BALL_COUNT);
+    snapshot.ballCount = static_cast<std::uint8_t>(count);
+    std::copy_n(m_posX.begin(), count, snapshot.posX);
+    std::copy_n(m_posY.begin(), count, snapshot.posY);
+    std::copy_n(m_angX.begin(), count, snapshot.angX);
+    std::copy_n(m_angY.begin(), count, snapshot.angY);
+    std::copy_n(m_angZ.begin(), count, snapshot.angZ);
+    std::copy_n(m_state.begin(), count, snapshot.state);
+    snapshot.time = m_time;
+    snapshot.atRest = IsAtRest();
+    snapshot.solverMode = m_solverMode;
+    snapshot.kernelPath = m_kernelPath;
+    snapshot.awakeCount = static_cast<std::uint8_t>(std::min(GetAwakeCount(), 255));
+    snapshot.islandCount = static_cast<std::uint8_t>(std::min(GetIslandCount(), 255));
+    snapshot.analytic = m_solverMode == SolverMode::EventDriven && m_eventSolver.IsCurrent(*this);
+    if (snapshot.analytic)
+        snapshot.trajectories = m_eventSolver.GetTrajectories();
+}
+
+void PhysicsSnapshot::Interpolate(const PhysicsSnapshot& a, const PhysicsSnapshot& b, float alpha, PhysicsSnapshot& out)
+{
+    out = b;
+    if (a.ballCount != b.ballCount || alpha >= 1.0f)
+        return;
+
+    // a ball further away than it could have rolled was placed by hand, blending would slide it over the table
+    constexpr float c_MAX_SPEED = 20.0f; // m/s
+    const float maxDistance = c_MAX_SPEED * std::max(b.time - a.time, 0.0f);
+    for (int i = 0; i < b.ballCount; i++)
+    {
+        if (a.state[i] == BallState::Pocketed || b.state[i] == BallState::Pocketed)
+            continue;
+        const float dx = b.posX[i] - a.posX[i];
+        const float dy = b.posY[i] - a.posY[i];
+        if (dx * dx + dy * dy > maxDistance * maxDistance)
+            continue;
+
+        out.posX[i] = a.posX[i] + dx * alpha;
+        out.posY[i] = a.posY[i] + dy * alpha;
+        out.angX[i] = a.angX[i] + (b.angX[i] - a.angX[i]) * alpha;
+        out.angY[i] = a.angY[i] + (b.angY[i] - a.angY[i]) * alpha;
+        out.angZ[i] = a.angZ[i] + (b.angZ[i] - a.angZ[i]) * alpha;
+        // a ball that comes to rest in b is still moving between the two
+        if (b.state[i] == BallState::Stationary && a.state[i] != BallState::Stationary)
+            out.state[i] = a.state[i];
+    }
+    out.time = a.time + (b.time - a.time) * alpha;
+    out.atRest = a.atRest && b.atRest;
+}
+
+bool PhysicsWorld::IsAtRest() const
+{
+    for (BallState state : m_state)
+    {
+        if (state != BallState::Stationary && state != BallState::Pocketed)
+            return false;
+    }
+    return true;
+}
+
+void PhysicsWorld::GetPocketPosition(int pocket, float& x, float& y)
+{
+    x = c_POCKETS[pocket][0];
+    y = c_POCKETS[pocket][1];
+}
+
+bool PhysicsWorld::UpdateAwakeSet()
+{
+    m_awake.clear();
+    const int count = GetBallCount();
+    for (int i = 0; i < count; i++)
+    {
+        if (m_state[i] != BallState::Stationary && m_state[i] != BallState::Pocketed)
+            m_awake.push_back(i);
+    }
+    return !m_awake.empty();
+}
+
+// Friction model, with the contact point at -R on the vertical axis:
+// - sliding: friction opposes the contact point velocity u = v + w x r, and u decelerates
+//   7/2 times faster than v, so the slip ends after 2|u| / (7 * mu_s * g)
+// - rolling: friction decelerates v along its own direction and w follows v / R
+// - the spin around the vertical axis decays at a constant rate in every moving state
+void PhysicsWorld::IntegrateBalls(float dt)
+{
+    const float slideDecel = c_FRICTION_SLIDE * c_GRAVITY;
+    const float rollDecel = c_FRICTION_ROLL * c_GRAVITY;
+    const float angularSlideScale = 2.5f * slideDecel / c_BALL_RADIUS;
+
+    for (int i : m_awake)
+    {
+        switch (m_state[i])
+        {
+        case BallState::Sliding:
+        {
+            const float ux = m_velX[i] - c_BALL_RADIUS * m_angY[i];
+            const float uy = m_velY[i] + c_BALL_RADIUS * m_angX[i];
+            const float slip = std::sqrt(ux * ux + uy * uy);
+            const float startVelX = m_velX[i];
+            const float startVelY = m_velY[i];
+
+            if (slip <= 3.5f * slideDecel * dt)
+            {
+                // the slip ends inside this substep, the total change of v is -2/7 u
+                m_velX[i] -= (2.0f / 7.0f) * ux;
+                m_velY[i] -= (2.0f / 7.0f) * uy;
+                m_angX[i] = -m_velY[i] / c_BALL_RADIUS;
+                m_angY[i] = m_velX[i] / c_BALL_RADIUS;
+                m_state[i] = BallState::Rolling;
+            }
+            else
+            {
+                const float dirX = ux / slip;
+                const float dirY = uy / slip;
+                m_velX[i] -= slideDecel * dt * dirX;
+                m_velY[i] -= slideDecel * dt * dirY;
+                m_angX[i] -= angularSlideScale * dt * dirY;
+                m_angY[i] += angularSlideScale * dt * dirX;
+            }
+
+            m_posX[i] += 0.5f * (startVelX + m_velX[i]) * dt;
+            m_posY[i] += 0.5f * (startVelY + m_velY[i]) * dt;
+            m_angZ[i] = DecaySpin(m_angZ[i], dt);
+            break;
+        }
+        case BallState::Rolling:
+        {
+            const float speed = std::sqrt(m_velX[i] * m_velX[i] + m_velY[i] * m_velY[i]);
+            const float startVelX = m_velX[i];
+            const float startVelY = m_velY[i];
+            float moveTime = dt;
+
+            if (speed <= rollDecel * dt + c_SLEEP_SPEED)
+            {
+                // comes to a stop inside this substep
+                moveTime = std::min(dt, speed / rollDecel);
+                m_velX[i] = m_velY[i] = 0.0f;
+            }
+            else
+            {
+                const float scale = (speed - rollDecel * dt) / speed;
+                m_velX[i] *= scale;
+                m_velY[i] *= scale;
+            }
+
+            m_posX[i] += 0.5f * (startVelX + m_velX[i]) * moveTime;
+            m_posY[i] += 0.5f * (startVelY + m_velY[i]) * moveTime;
+            m_angX[i] = -m_velY[i] / c_BALL_RADIUS;
+            m_angY[i] = m_velX[i] / c_BALL_RADIUS;
+            m_angZ[i] = DecaySpin(m_angZ[i], dt);
+
+            if (m_velX[i] == 0.0f && m_velY[i] == 0.0f)
+            {
+                if (std::fabs(m_angZ[i]) > c_SLEEP_SPIN)
+                    m_state[i] = BallState::Spinning;
+                else
+                {
+                    m_angZ[i] = 0.0f;
+                    m_state[i] = BallState::Stationary;
+                }
+            }
+            break;
+        }
+        case BallState::Spinning:
+        {
+            m_angZ[i] = DecaySpin(m_angZ[i], dt);
+            if (std::fabs(m_angZ[i]) <= c_SLEEP_SPIN)
+            {
+                m_angZ[i] = 0.0f;
+                m_state[i] = BallState::Stationary;
+            }
+            break;
+        }
+        case BallState::Stationary:
+        case BallState::Pocketed:
+            break;
+        }
+    }
+}
+
+void PhysicsWorld::CheckPockets()
+{
+    const float captureSq = c_POCKET_RADIUS * c_POCKET_RADIUS;
+
+    for (int i : m_awake)
+    {
+        if (m_state[i] == BallState::Pocketed || m_state[i] == BallState::Stationary)
+            continue;
+
+        for (int p = 0; p < c_POCKET_COUNT; p++)
+        {
+            const float dx = m_posX[i] - c_POCKETS[p][0];
+            const float dy = m_posY[i] - c_POCKETS[p][1];
+            if (dx * dx + dy * dy < captureSq)
+            {
+                PocketBall(i);
+                break;
+            }
+        }
+    }
+}
+
+void PhysicsWorld::ResolveCushionCollisions()
+{
+    if (m_rails)
+    {
+        ResolveRailCollisions();
+        return;
+    }
+
+    const float maxX = 0.5f * c_TABLE_LENGTH - c_BALL_RADIUS;
+    const float maxY = 0.5f * c_TABLE_WIDTH - c_BALL_RADIUS;
+
+    for (int i : m_awake)
+    {
+        if (m_state[i] == BallState::Pocketed || m_state[i] == BallState::Stationary)
+            continue;
+
+        if ((m_posX[i] > maxX && m_velX[i] > 0.0f) || (m_posX[i] < -maxX && m_velX[i] < 0.0f))
+        {
+            m_posX[i] = std::clamp(m_posX[i], -maxX, maxX);
+            ReboundFromCushion(i, true);
+        }
+        if ((m_posY[i] > maxY && m_velY[i] > 0.0f) || (m_posY[i] < -maxY && m_velY[i] < 0.0f))
+        {
+            m_posY[i] = std::clamp(m_posY[i], -maxY, maxY);
+            ReboundFromCushion(i, false);
+        }
+    }
+}
+
+// sweep every moving ball from where its step started, it stops against the first rail in its way and bounces
+void PhysicsWorld::ResolveRailCollisions()
+{
+    RailGeometry::Hit hit;
+    for (int i : m_awake)
+    {
+        if (m_state[i] == BallState::Pocketed || m_state[i] == BallState::Stationary)
+            continue;
+
+        const float dx = m_posX[i] - m_stepStartX[i];
+        const float dy = m_posY[i] - m_stepStartY[i];
+        if (m_rails->SweepCircle(m_stepStartX[i], m_stepStartY[i], dx, dy, c_BALL_RADIUS, hit))
+        {
+            m_posX[i] = m_stepStartX[i] + dx * hit.time;
+            m_posY[i] = m_stepStartY[i] + dy * hit.time;
+            ReboundFromRail(i, hit.normalX, hit.normalY);
+        }
+    }
+}
+
+void PhysicsWorld::ResolveBallCollisions()
+{
+    const int count = GetBallCount();
+    m_contacts.clear();
+    if (count >= c_GRID_MIN_BALLS)
+    {
+        m_grid.Build(m_posX.data(), m_posY.data(), m_state.data(), count);
+        m_grid.FindCandidatePairs(m_pairA, m_pairB);
+        m_islandsValid = false; // the grid reuses the pair lists
+        m_islandCount = 0;
+        FindOverlappingPairs(0, static_cast<int>(m_pairA.size()));
+    }
+    else
+    {
+        if (!AreIslandsCurrent())
+            BuildIslands();
+
+        // only islands with a ball in motion are tested, the rest of the table costs nothing
+        std::fill(m_islandActive.begin(), m_islandActive.end(), std::uint8_t(0));
+        for (int i : m_awake)
+        {
+            if (IsMoving(m_state[i]) && m_islandOf[i] >= 0)
+                m_islandActive[m_islandOf[i]] = 1;
+        }
+        for (int island = 0; island < m_islandCount; island++)
+        {
+            if (m_islandActive[island])
+                FindOverlappingPairs(m_islandPairStart[island], m_islandPairStart[island + 1]);
+        }
+    }
+
+    // resolved in ball order, so the result does not depend on how the pairs were grouped when they were found
+    std::sort(m_contacts.begin(), m_contacts.end());
+    for (std::uint64_t contact : m_contacts)
+        ResolveBallPair(static_cast<int>(contact >> 32), static_cast<int>(contact & 0xFFFFFFFFu));
+}
+
+void PhysicsWorld::FindOverlappingPairs(int begin, int end)
+{
+    const int pairCount = end - begin;
+    if (pairCount <= 0)
+        return;
+    const int* pairA = m_pairA.data() + begin;
+    const int* pairB = m_pairB.data() + begin;
+    m_overlaps.resize(pairCount);
+    const int overlapCount = CollisionKernel::FindOverlaps(m_kernelPath, m_posX.data(), m_posY.data(),
+        pairA, pairB, pairCount, c_BALL_DIAMETER, m_overlaps.data());
+
+#ifdef _DEBUG
+    // the SIMD paths must agree exactly with the scalar reference
+    std::vector<int> reference(pairCount);
+    const int referenceCount = CollisionKernel::FindOverlaps(KernelPath::Scalar, m_posX.data(), m_posY.data(),
+        pairA, pairB, pairCount, c_BALL_DIAMETER, reference.data());
+    assert(referenceCount == overlapCount && std::equal(reference.begin(), reference.begin() + referenceCount, m_overlaps.begin()));
+#endif
+
+    for (int k = 0; k < overlapCount; k++)
+    {
+        const int i = std::min(pairA[m_overlaps[k]], pairB[m_overlaps[k]]);
+        const int j = std::max(pairA[m_overlaps[k]], pairB[m_overlaps[k]]);
+        if (m_state[i] == BallState::Pocketed || m_state[j] == BallState::Pocketed)
+            continue;
+        // balls only start a collision while one of them rolls or slides
+        if (!IsMoving(m_state[i]) && !IsMoving(m_state[j]))
+            continue;
+        m_contacts.push_back(static_cast<std::uint64_t>(i) << 32 | static_cast<std::uint32_t>(j));
+    }
+}
+
+void PhysicsWorld::BuildIslands()
+{
+    const int count = GetBallCount();
+    m_islandOf.assign(count, -1);
+    m_islandX.assign(m_posX.begin(), m_posX.end());
+    m_islandY.assign(m_posY.begin(), m_posY.end());
+    m_islandMoving.resize(count);
+    m_islandParent.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        m_islandMoving[i] = IsMoving(m_state[i]);
+        m_islandParent[i] = i;
+    }
+
+    const auto find = [this](int i)
+    {
+        while (m_islandParent[i] != i)
+        {
+            m_islandParent[i] = m_islandParent[m_islandParent[i]];
+            i = m_islandParent[i];
+        }
+        return i;
+    };
+
+    // every pair with a moving ball in reach, two resting balls never start a collision. The grid's cells are
+    // as wide as the reach, so each moving ball only measures the balls in the cells around it.
+    const float reach = c_BALL_DIAMETER + c_ISLAND_SKIN;
+    m_islandGrid.Build(m_posX.data(), m_posY.data(), m_state.data(), count);
+    m_contacts.clear(); // holds the pairs until they are sorted by island
+    for (int i = 0; i < count; i++)
+    {
+        if (!m_islandMoving[i])
+            continue;
+        m_islandGrid.FindNear(m_posX[i], m_posY[i], m_nearby);
+        for (int j : m_nearby)
+        {
+            // pairs of two moving balls are taken once, from the lower one
+            if (j == i || (m_islandMoving[j] && j < i))
+                continue;
+            const float dx = m_posX[j] - m_posX[i];
+            const float dy = m_posY[j] - m_posY[i];
+            if (dx * dx + dy * dy >= reach * reach)
+                continue;
+            m_contacts.push_back(static_cast<std::uint64_t>(std::min(i, j)) << 32 | static_cast<std::uint32_t>(std::max(i, j)));
+            m_islandParent[find(i)] = find(j);
+        }
+    }
+
+    // number the islands in the order their first pair was found
+    m_islandCount = 0;
+    for (std::uint64_t pair : m_contacts)
+    {
+        const int root = find(static_cast<int>(pair >> 32));
+        if (m_islandOf[root] < 0)
+            m_islandOf[root] = m_islandCount++;
+    }
+    for (int i = 0; i < count; i++)
+        m_islandOf[i] = m_islandOf[find(i)];
+
+    // counting sort by island, filled back to front so the pairs keep their order within an island and
+    // every island's end offset has moved down to its start by the time it is done
+    const int pairCount = static_cast<int>(m_contacts.size());
+    m_islandPairStart.assign(m_islandCount + 1, 0);
+    for (std::uint64_t pair : m_contacts)
+        m_islandPairStart[m_islandOf[pair >> 32] + 1]++;
+    for (int island = 0; island < m_islandCount; island++)
+        m_islandPairStart[island + 1] += m_islandPairStart[island];
+    m_pairA.resize(pairCount);
+    m_pairB.resize(pairCount);
+    for (int k = pairCount - 1; k >= 0; k--)
+    {
+        const int a = static_cast<int>(m_contacts[k] >> 32);
+        const int slot = --m_islandPairStart[m_islandOf[a] + 1];
+        m_pairA[slot] = a;
+        m_pairB[slot] = static_cast<int>(m_contacts[k] & 0xFFFFFFFFu);
+    }
+    m_islandPairStart.erase(m_islandPairStart.begin());
+    m_islandPairStart.push_back(pairCount);
+    m_contacts.clear();
+
+    m_islandActive.resize(m_islandCount);
+    m_islandsValid = true;
+}
+
+bool PhysicsWorld::AreIslandsCurrent() const
+{
+    if (!m_islandsValid || static_cast<int>(m_islandOf.size()) != GetBallCount())
+        return false;
+
+    // a ball that moved less than half the skin can not have closed the gap to a ball outside its island
+    const float limitSq = 0.25f * c_ISLAND_SKIN * c_ISLAND_SKIN;
+    for (int i : m_awake)
+    {
+        if (!IsMoving(m_state[i]))
+            continue;
+        if (!m_islandMoving[i])
+            return false;
+        const float dx = m_posX[i] - m_islandX[i];
+        const float dy = m_posY[i] - m_islandY[i];
+        if (dx * dx + dy * dy > limitSq)
+            return false;
+    }
+    return true;
+}
+
+void PhysicsWorld::ResolveBallPair(int i, int j)
+{
+    float nx = m_posX[j] - m_posX[i];
+    float ny = m_posY[j] - m_posY[i];
+    const float distSq = nx * nx + ny * ny;
+    if (distSq >= c_BALL_DIAMETER * c_BALL_DIAMETER || distSq == 0.0f)
+        return;
+
+    const float dist = std::sqrt(distSq);
+    nx /= dist;
+    ny /= dist;
+
+    // push the balls apart so they are touching
+    const float overlap = 0.5f * (c_BALL_DIAMETER - dist);
+    m_posX[i] -= nx * overlap;
+    m_posY[i] -= ny * overlap;
+    m_posX[j] += nx * overlap;
+    m_posY[j] += ny * overlap;
+
+    ApplyBallImpulse(i, j, nx, ny);
+}
+
+// Equal mass collision with restitution along the line of centres, plus a friction impulse
+// along the tangent (throw) capped by the ball-ball friction coefficient.
+// (nx, ny) is the unit normal pointing from ball i to ball j.
+void PhysicsWorld::ApplyBallImpulse(int i, int j, float nx, float ny)
+{
+    const float approach = (m_velX[j] - m_velX[i]) * nx + (m_velY[j] - m_velY[i]) * ny;
+    if (approach >= 0.0f)
+        return; // already separating
+
+    // normal impulse per unit mass
+    const float normalImpulse = -0.5f * (1.0f + c_RESTITUTION_BALL) * approach;
+    m_velX[i] -= normalImpulse * nx;
+    m_velY[i] -= normalImpulse * ny;
+    m_velX[j] += normalImpulse * nx;
+    m_velY[j] += normalImpulse * ny;
+
+    // slip of the contact points along the tangent, the linear and angular effective mass add up to 7/m
+    const float tx = -ny;
+    const float ty = nx;
+    const float slip = (m_velX[i] - m_velX[j]) * tx + (m_velY[i] - m_velY[j]) * ty
+        + c_BALL_RADIUS * (m_angZ[i] + m_angZ[j]);
+    float tangentImpulse = std::min(c_FRICTION_BALL * normalImpulse, std::fabs(slip) / 7.0f);
+    if (slip < 0.0f)
+        tangentImpulse = -tangentImpulse;
+
+    m_velX[i] -= tangentImpulse * tx;
+    m_velY[i] -= tangentImpulse * ty;
+    m_velX[j] += tangentImpulse * tx;
+    m_velY[j] += tangentImpulse * ty;
+    m_angZ[i] -= 2.5f * tangentImpulse / c_BALL_RADIUS;
+    m_angZ[j] -= 2.5f * tangentImpulse / c_BALL_RADIUS;
+
+    m_state[i] = BallState::Sliding;
+    m_state[j] = BallState::Sliding;
+}
+
+// reflect the velocity component into the cushion, the rebound breaks the rolling condition
+// so the ball slides until friction brings it back
+void PhysicsWorld::ReboundFromCushion(int i, bool alongX)
+{
+    if (alongX)
+        m_velX[i] = -c_RESTITUTION_RAIL * m_velX[i];
+    else
+        m_velY[i] = -c_RESTITUTION_RAIL * m_velY[i];
+    m_state[i] = BallState::Sliding;
+}
+
+// the same rebound against a rail of any direction, n points from the rail to the ball
+void PhysicsWorld::ReboundFromRail(int i, float nx, float ny)
+{
+    const float approach = m_velX[i] * nx + m_velY[i] * ny;
+    if (approach < 0.0f)
+    {
+        const float impulse = (1.0f + c_RESTITUTION_RAIL) * approach;
+        m_velX[i] -= impulse * nx;
+        m_velY[i] -= impulse * ny;
+    }
+    m_state[i] = BallState::Sliding;
+}
+
+void PhysicsWorld::PocketBall(int i)
+{
+    m_velX[i] = m_velY[i] = 0.0f;
+    m_angX[i] = m_angY[i] = m_angZ[i] = 0.0f;
+    m_state[i] = BallState::Pocketed;
+}
@@ -0,0 +1,85 @@
+#include "Primitives.h"
+
+#include <cmath>
+#include <vector>
+
+#include <glm/ext/scalar_constants.hpp>
+
+Mesh Primitives::CreateSphere(float radius, int rings, int segments)
+{
+    std::vector<Vertex> vertices;
+    std::vector<GLsizei> indices;
+    vertices.reserve(static_cast<size_t>(rings + 1) * (segments + 1));
+    indices.reserve(static_cast<size_t>(rings) * segments * 6);
+
+    // the seam column is duplicated so texture coordinates wrap cleanly
+    for (int ring = 0; ring <= rings; ring++)
+    {
+        const float v = static_cast<float>(ring) / rings;
+        const float polar = v * glm::pi<float>();
+        for (int segment = 0; segment <= segments; segment++)
+        {
+            const float u = static_cast<float>(segment) / segments;
+            const float azimuth = u * 2.0f * glm::pi<float>();
+
+            Vertex vertex;
+            vertex.normal = glm::vec3(std::sin(polar) * std::cos(azimuth), std::cos(polar), std::sin(polar) * std::sin(azimuth));
+            vertex.position = vertex.normal * radius;
+            vertex.texCoord = glm::vec2(u, v);
+            vertices.push_back(vertex);
+        }
+    }
+
+    const int stride = segments + 1;
+    for (int ring = 0; ring < rings; ring++)
+    {
+        for (int segment = 0; segment < segments; segment++)
+        {
+            const GLsizei first = ring * stride + segment;
+            const GLsizei below = first + stride;
+            indices.insert(indices.end(), { first, first + 1, below, below, first + 1, below + 1 });
+        }
+    }
+
+    return Mesh(vertices.data(), indices.data(), static_cast<GLsizei>(vertices.size()), static_cast<GLsizei>(indices.size()));
+}
+
+Mesh Primitives::CreateBox(float width, float height, float depth)
+{
+    const glm::vec3 halfSize(width * 0.5f, height * 0.5f, depth * 0.5f);
+    // face normal followed by the two in-plane axes, ordered so the triangles wind counter clockwise
+    static const glm::vec3 s_faces[6][3] = {
+        { {  1,  0,  0 }, {  0,  0, -1 }, { 0, 1, 0 } },
+        { { -1,  0,  0 }, {  0,  0,  1 }, { 0, 1, 0 } },
+        { {  0,  1,  0 }, {  1,  0,  0 }, { 0, 0, -1 } },
+        { {  0, -1,  0 }, {  1,  0,  0 }, { 0, 0, 1 } },
+        { {  0,  0,  1 }, {  1,  0,  0 }, { 0, 1, 0 } },
+        { {  0,  0, -1 }, { -1,  0,  0 }, { 0, 1, 0 } },
+    };
+    static const glm::vec2 s_corners[4] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+
+    std::vector<Vertex> vertices;
+    std::vector<GLsizei> indices;
+    vertices.reserve(24);
+    indices.reserve(36);
+
+    for (int face = 0; face < 6; face++)
+    {
+        const glm::vec3& normal = s_faces[face][0];
+        const glm::vec3& right = s_faces[face][1];
+        const glm::vec3& up = s_faces[face][2];
+
+        const GLsizei first = static_cast<GLsizei>(vertices.size());
+        for (const glm::vec2& corner : s_corners)
+        {
+            Vertex vertex;
+            vertex.normal = normal;
+            vertex.position = (normal + right * (corner.x * 2.0f - 1.0f) + up * (corner.y * 2.0f - 1.0f)) * halfSize;
+            vertex.texCoord = corner;
+            vertices.push_back(vertex);
+        }
+        indices.insert(indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+    }
+
+    return Mesh(vertices.data(), indices.data(), static_cast<GLsizei>(vertices.size()), static_cast<GLsizei>(indices.size()));
+}
@@ -0,0 +1,319 @@
+#include "Profiler.h"
+
+#include <glad/gl.h>
+#include <imgui.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+namespace
+{
+    constexpr int c_AVERAGE_FRAMES = 60; // per-scope averages in the panel
+    constexpr ImU32 c_SCOPE_COLORS[] = {
+        IM_COL32(70, 130, 180, 255), IM_COL32(60, 160, 110, 255), IM_COL32(200, 140, 50, 255),
+        IM_COL32(160, 90, 170, 255), IM_COL32(190, 80, 80, 255), IM_COL32(90, 150, 160, 255),
+    };
+
+    ImU32 ScopeColor(const char* name)
+    {
+        // the same literal always gets the same colour
+        const std::size_t hash = std::hash<const void*>()(name);
+        return c_SCOPE_COLORS[hash % (sizeof(c_SCOPE_COLORS) / sizeof(c_SCOPE_COLORS[0]))];
+    }
+
+    void WriteEvent(std::ofstream& out, bool& first, const char* name, double start, double duration, int track)
+    {
+        // scope names are literals from the code, quotes and backslashes are the only characters to escape
+        out << (first ? "\n" : ",\n") << "{\"name\":\"";
+        for (const char* c = name; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+                out << '\\';
+            out << *c;
+        }
+        out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << track << ",\"ts\":" << start * 1000.0
+            << ",\"dur\":" << duration * 1000.0 << "}";
+        first = false;
+    }
+}
+
+Profiler::Profiler(bool gpuTiming)
+    : m_epoch(Clock::now()), m_gpuTiming(gpuTiming), m_frames(c_HISTORY_SIZE)
+{
+    if (m_gpuTiming)
+    {
+        for (QuerySet& set : m_querySets)
+            glGenQueries(c_MAX_GPU_SCOPES, set.queries);
+    }
+}
+
+Profiler::~Profiler()
+{
+    if (m_gpuTiming)
+    {
+        for (QuerySet& set : m_querySets)
+            glDeleteQueries(c_MAX_GPU_SCOPES, set.queries);
+    }
+}
+
+double Profiler::Now() const
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - m_epoch).count();
+}
+
+void Profiler::BeginFrame()
+{
+    m_current = -1;
+    if (m_paused)
+        return;
+
+    // the set this frame reuses was last issued c_GPU_LATENCY frames ago
+    QuerySet& set = m_querySets[m_frameNumber % c_GPU_LATENCY];
+    if (m_gpuTiming)
+        ReadGpuResults(set);
+
+    m_current = m_frameCount == 0 ? 0 : (m_latest + 1) % c_HISTORY_SIZE;
+    Frame& frame = m_frames[m_current];
+    frame.number = m_frameNumber;
+    frame.start = Now();
+    frame.duration = 0.0f;
+    frame.gpuDuration = 0.0f;
+    frame.scopeCount = 0;
+    m_depth = 0;
+
+    set.count = 0;
+    set.frame = m_current;
+    set.frameNumber = m_frameNumber;
+}
+
+void Profiler::EndFrame()
+{
+    if (m_current < 0)
+        return;
+
+    Frame& frame = m_frames[m_current];
+    frame.duration = static_cast<float>(Now() - frame.start);
+    m_latest = m_current;
+    m_frameCount = std::min(m_frameCount + 1, c_HISTORY_SIZE);
+    m_frameNumber++;
+    m_current = -1;
+}
+
+int Profiler::BeginCpu(const char* name)
+{
+    if (m_current < 0)
+        return -1;
+    Frame& frame = m_frames[m_current];
+    if (frame.scopeCount == c_MAX_SCOPES)
+        return -1;
+
+    const int index = frame.scopeCount++;
+    frame.scopes[index] = { name, static_cast<float>(Now() - frame.start), 0.0f, static_cast<std::uint8_t>(m_depth), false };
+    m_depth++;
+    return index;
+}
+
+void Profiler::EndCpu(int scope)
+{
+    if (scope < 0 || m_current < 0)
+        return;
+    Frame& frame = m_frames[m_current];
+    frame.scopes[scope].duration = static_cast<float>(Now() - frame.start) - frame.scopes[scope].start;
+    m_depth--;
+}
+
+int Profiler::BeginGpu(const char* name)
+{
+    if (!m_gpuTiming || m_current < 0 || m_activeGpuScope >= 0)
+        return -1;
+    Frame& frame = m_frames[m_current];
+    QuerySet& set = m_querySets[m_frameNumber % c_GPU_LATENCY];
+    if (frame.scopeCount == c_MAX_SCOPES || set.count == c_MAX_GPU_SCOPES)
+        return -1;
+
+    const int index = frame.scopeCount++;
+    frame.scopes[index] = { name, static_cast<float>(Now() - frame.start), -1.0f, static_cast<std::uint8_t>(m_depth), true };
+    glBeginQuery(GL_TIME_ELAPSED, set.queries[set.count]);
+    set.scopes[set.count++] = index;
+    m_activeGpuScope = index;
+    return index;
+}
+
+void Profiler::EndGpu(int scope)
+{
+    if (scope < 0 || scope != m_activeGpuScope)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    m_activeGpuScope = -1;
+}
+
+void Profiler::ReadGpuResults(QuerySet& set)
+{
+    // the ring may have moved past the frame if the history is shorter than the latency, then results are dropped
+    const bool frameAlive = set.frame >= 0 && m_frames[set.frame].number == set.frameNumber;
+    for (int i = 0; i < set.count; i++)
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(set.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            m_droppedGpuResults++;
+            continue;
+        }
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(set.queries[i], GL_QUERY_RESULT, &nanoseconds);
+        if (frameAlive)
+        {
+            Frame& frame = m_frames[set.frame];
+            const float milliseconds = static_cast<float>(nanoseconds) * 1e-6f;
+            frame.scopes[set.scopes[i]].duration = milliseconds;
+            frame.gpuDuration += milliseconds;
+        }
+    }
+    set.count = 0;
+}
+
+const Profiler::Frame& Profiler::GetFrame(int age) const
+{
+    age = std::clamp(age, 0, std::max(m_frameCount - 1, 0));
+    return m_frames[(m_latest - age + c_HISTORY_SIZE) % c_HISTORY_SIZE];
+}
+
+void Profiler::DrawPanel(bool* open)
+{
+    if (!ImGui::Begin("Profiler", open))
+    {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Checkbox("Pause", &m_paused);
+    ImGui::SameLine();
+    if (ImGui::Button("Export trace"))
+    {
+        const char* path = "frame_trace.json";
+        if (ExportChromeTrace(path))
+            std::cout << "Wrote " << m_frameCount << " frames to " << path << std::endl;
+        else
+            std::cerr << "Failed to write " << path << std::endl;
+    }
+    if (m_frameCount == 0)
+    {
+        ImGui::Text("No frames recorded.");
+        ImGui::End();
+        return;
+    }
+
+    // oldest to newest, as the graph is read from left to right
+    float cpuTimes[c_HISTORY_SIZE];
+    float gpuTimes[c_HISTORY_SIZE];
+    for (int i = 0; i < m_frameCount; i++)
+    {
+        const Frame& frame = GetFrame(m_frameCount - 1 - i);
+        cpuTimes[i] = frame.duration;
+        gpuTimes[i] = frame.gpuDuration;
+    }
+    const float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+    ImGui::PlotLines("CPU ms", cpuTimes, m_frameCount, 0, nullptr, 0.0f, FLT_MAX, ImVec2(width * 0.8f, 50.0f));
+    ImGui::PlotLines("GPU ms", gpuTimes, m_frameCount, 0, nullptr, 0.0f, FLT_MAX, ImVec2(width * 0.8f, 50.0f));
+
+    // GPU results arrive c_GPU_LATENCY frames late, so the default view is the newest frame that has them
+    m_selectedAge = std::clamp(m_selectedAge, 0, m_frameCount - 1);
+    ImGui::SliderInt("Frame", &m_selectedAge, 0, m_frameCount - 1, "%d frames ago");
+    const Frame& frame = GetFrame(m_selectedAge);
+    ImGui::Text("Frame %llu: %.2f ms CPU, %.2f ms GPU, %d GPU results dropped",
+        static_cast<unsigned long long>(frame.number), frame.duration, frame.gpuDuration, m_droppedGpuResults);
+    DrawFlame(frame, width);
+
+    ImGui::Separator();
+    const int averageFrames = std::min(c_AVERAGE_FRAMES, m_frameCount);
+    for (int i = 0; i < frame.scopeCount; i++)
+    {
+        const Scope& scope = frame.scopes[i];
+        float sum = 0.0f;
+        int count = 0;
+        for (int age = 0; age < averageFrames; age++)
+        {
+            const Frame& other = GetFrame(age);
+            for (int j = 0; j < other.scopeCount; j++)
+            {
+                const Scope& match = other.scopes[j];
+                if (match.name == scope.name && match.gpu == scope.gpu && match.duration >= 0.0f)
+                {
+                    sum += match.duration;
+                    count++;
+                }
+            }
+        }
+        ImGui::Text("%*s%s%s: %.3f ms, average %.3f ms", scope.depth * 2, "", scope.gpu ? "[GPU] " : "", scope.name,
+            std::max(scope.duration, 0.0f), count > 0 ? sum / static_cast<float>(count) : 0.0f);
+    }
+
+    ImGui::End();
+}
+
+void Profiler::DrawFlame(const Frame& frame, float width)
+{
+    // one row per CPU nesting level, GPU scopes on a row of their own below, at their submission time
+    int cpuRows = 0;
+    for (int i = 0; i < frame.scopeCount; i++)
+    {
+        if (!frame.scopes[i].gpu)
+            cpuRows = std::max(cpuRows, frame.scopes[i].depth + 1);
+    }
+
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    const float scale = width / std::max(frame.duration, 0.001f);
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+    for (int i = 0; i < frame.scopeCount; i++)
+    {
+        const Scope& scope = frame.scopes[i];
+        if (scope.duration < 0.0f)
+            continue;
+
+        const float row = scope.gpu ? static_cast<float>(cpuRows) : static_cast<float>(scope.depth);
+        const ImVec2 min(origin.x + scope.start * scale, origin.y + row * rowHeight);
+        const ImVec2 max(std::max(min.x + scope.duration * scale, min.x + 1.0f), min.y + rowHeight - 1.0f);
+        drawList->AddRectFilled(min, max, ScopeColor(scope.name));
+        drawList->PushClipRect(min, max, true);
+        drawList->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32(255, 255, 255, 255), scope.name);
+        drawList->PopClipRect();
+    }
+    ImGui::Dummy(ImVec2(width, rowHeight * static_cast<float>(cpuRows + 1)));
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+        return false;
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}}";
+    out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+    bool first = false;
+
+    // timestamps in microseconds, as the format expects
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    for (int age = m_frameCount - 1; age >= 0; age--)
+    {
+        const Frame& frame = GetFrame(age);
+        WriteEvent(out, first, "Frame", frame.start, frame.duration, 1);
+        for (int i = 0; i < frame.scopeCount; i++)
+        {
+            const Scope& scope = frame.scopes[i];
+            if (scope.duration >= 0.0f)
+                WriteEvent(out, first, scope.name, frame.start + scope.start, scope.duration, scope.gpu ? 2 : 1);
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
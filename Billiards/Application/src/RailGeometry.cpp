@@ -0,0 +1,699 @@
+#include "RailGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace
+{
+    // ball centres travel this high above the bed, the cut at this height is the outline they collide with
+    constexpr double c_SLICE_HEIGHT = c_BALL_RADIUS;
+    // cut points closer than this are the same point, joins chains across mesh seams
+    constexpr double c_WELD_DISTANCE = 1e-5;
+    // how far a fitted segment or arc may stray from the cut
+    constexpr double c_FIT_TOLERANCE = 0.5e-3;
+    // flatter curves are fitted with segments, which are cheaper to test
+    constexpr double c_MAX_ARC_RADIUS = 0.5;
+    // around the playing surface, keeps the pocket jaws and drops the outside of the rails and the frame
+    constexpr float c_REGION_MARGIN = 2.0f * c_POCKET_RADIUS;
+
+    constexpr float c_CELL_SIZE = 2.0f * c_BALL_DIAMETER;
+    constexpr int c_MAX_CELLS_PER_AXIS = 256;
+    constexpr float c_TWO_PI = 6.28318530718f;
+
+    struct Point
+    {
+        double x, y;
+    };
+
+    // angle of (x, y) around the arc centre, from the start of the arc, in [0, 2 pi)
+    float ArcOffset(const RailPrimitive& arc, float x, float y)
+    {
+        float offset = std::atan2(y - arc.y0, x - arc.x0) - arc.angle;
+        offset = std::fmod(offset, c_TWO_PI);
+        return offset < 0.0f ? offset + c_TWO_PI : offset;
+    }
+
+    bool InArc(const RailPrimitive& arc, float x, float y)
+    {
+        return ArcOffset(arc, x, y) <= arc.sweep;
+    }
+
+    void ArcEnd(const RailPrimitive& arc, bool last, float& x, float& y)
+    {
+        const float angle = last ? arc.angle + arc.sweep : arc.angle;
+        x = arc.x0 + arc.radius * std::cos(angle);
+        y = arc.y0 + arc.radius * std::sin(angle);
+    }
+
+    void Keep(RailGeometry::Hit& hit, float time, float nx, float ny, int primitive)
+    {
+        if (time < hit.time || hit.primitive < 0)
+        {
+            hit.time = time;
+            hit.normalX = nx;
+            hit.normalY = ny;
+            hit.primitive = primitive;
+        }
+    }
+
+    // circle against a point, which is what the ends of segments and arcs are
+    void SweepPoint(float px, float py, float dx, float dy, float radius, float cx, float cy, int primitive,
+                    RailGeometry::Hit& hit)
+    {
+        const float mx = px - cx;
+        const float my = py - cy;
+        const float b = mx * dx + my * dy;
+        if (b >= 0.0f)
+            return; // moving away
+
+        const float c = mx * mx + my * my - radius * radius;
+        float time = 0.0f;
+        if (c > 0.0f)
+        {
+            const float a = dx * dx + dy * dy;
+            const float disc = b * b - a * c;
+            if (disc < 0.0f)
+                return;
+            time = (-b - std::sqrt(disc)) / a;
+            if (time > hit.time)
+                return;
+        }
+
+        const float qx = mx + dx * time;
+        const float qy = my + dy * time;
+        const float length = std::sqrt(qx * qx + qy * qy);
+        if (length > 0.0f)
+            Keep(hit, time, qx / length, qy / length, primitive);
+    }
+
+    void SweepSegment(float px, float py, float dx, float dy, float radius, const RailPrimitive& segment,
+                      int primitive, RailGeometry::Hit& hit)
+    {
+        const float ex = segment.x1 - segment.x0;
+        const float ey = segment.y1 - segment.y0;
+        const float lengthSq = ex * ex + ey * ey;
+        if (lengthSq > 0.0f)
+        {
+            // normal on the side the ball starts from
+            const float length = std::sqrt(lengthSq);
+            float nx = -ey / length;
+            float ny = ex / length;
+            float distance = nx * (px - segment.x0) + ny * (py - segment.y0);
+            if (distance < 0.0f)
+            {
+                nx = -nx;
+                ny = -ny;
+                distance = -distance;
+            }
+
+            const float closing = -(nx * dx + ny * dy);
+            if (closing > 0.0f)
+            {
+                const float time = std::max(0.0f, (distance - radius) / closing);
+                if (time <= hit.time)
+                {
+                    const float u = ((px + dx * time - segment.x0) * ex + (py + dy * time - segment.y0) * ey) / lengthSq;
+                    if (u >= 0.0f && u <= 1.0f)
+                        Keep(hit, time, nx, ny, primitive);
+                }
+            }
+        }
+
+        SweepPoint(px, py, dx, dy, radius, segment.x0, segment.y0, primitive, hit);
+        SweepPoint(px, py, dx, dy, radius, segment.x1, segment.y1, primitive, hit);
+    }
+
+    void SweepArc(float px, float py, float dx, float dy, float radius, const RailPrimitive& arc, int primitive,
+                  RailGeometry::Hit& hit)
+    {
+        const float mx = px - arc.x0;
+        const float my = py - arc.y0;
+        const float b = mx * dx + my * dy;
+        const float a = dx * dx + dy * dy;
+        const float distanceSq = mx * mx + my * my;
+        const bool outside = distanceSq >= arc.radius * arc.radius;
+
+        // sign is +1 against the convex side and -1 against the concave one
+        auto contact = [&](float time, float sign)
+        {
+            if (time < 0.0f || time > hit.time)
+                return;
+            const float qx = mx + dx * time;
+            const float qy = my + dy * time;
+            const float length = std::sqrt(qx * qx + qy * qy);
+            if (length > 0.0f && InArc(arc, arc.x0 + qx, arc.y0 + qy))
+                Keep(hit, time, sign * qx / length, sign * qy / length, primitive);
+        };
+
+        // convex side, contact when the centre comes within arc radius + ball radius
+        if (outside && b < 0.0f)
+        {
+            const float reach = arc.radius + radius;
+            const float c = distanceSq - reach * reach;
+            if (c <= 0.0f)
+                contact(0.0f, 1.0f);
+            else if (b * b - a * c >= 0.0f)
+                contact((-b - std::sqrt(b * b - a * c)) / a, 1.0f);
+        }
+
+        // concave side, contact when the centre leaves the disc of arc radius - ball radius, which a ball
+        // coming from outside the circle may have entered earlier in the same sweep
+        if (arc.radius > radius)
+        {
+            const float reach = arc.radius - radius;
+            const float c = distanceSq - reach * reach;
+            if (c >= 0.0f && !outside)
+            {
+                if (b > 0.0f)
+                    contact(0.0f, -1.0f);
+            }
+            else if (a > 0.0f && b * b - a * c >= 0.0f)
+            {
+                contact((-b + std::sqrt(b * b - a * c)) / a, -1.0f);
+            }
+        }
+
+        float ex, ey;
+        ArcEnd(arc, false, ex, ey);
+        SweepPoint(px, py, dx, dy, radius, ex, ey, primitive, hit);
+        ArcEnd(arc, true, ex, ey);
+        SweepPoint(px, py, dx, dy, radius, ex, ey, primitive, hit);
+    }
+
+    double DistanceToSegment(const Point& p, const Point& a, const Point& b)
+    {
+        const double ex = b.x - a.x;
+        const double ey = b.y - a.y;
+        const double lengthSq = ex * ex + ey * ey;
+        double u = lengthSq > 0.0 ? ((p.x - a.x) * ex + (p.y - a.y) * ey) / lengthSq : 0.0;
+        u = std::clamp(u, 0.0, 1.0);
+        return std::hypot(p.x - (a.x + u * ex), p.y - (a.y + u * ey));
+    }
+
+    RailPrimitive MakeSegment(const Point& a, const Point& b)
+    {
+        RailPrimitive segment;
+        segment.shape = RailShape::Segment;
+        segment.x0 = static_cast<float>(a.x);
+        segment.y0 = static_cast<float>(a.y);
+        segment.x1 = static_cast<float>(b.x);
+        segment.y1 = static_cast<float>(b.y);
+        return segment;
+    }
+
+    // circle through the first, middle and last point of chain[first .. last], if every point stays on it
+    bool FitArc(const std::vector<Point>& chain, int first, int last, RailPrimitive& arc)
+    {
+        const Point& p0 = chain[first];
+        const Point& pm = chain[(first + last) / 2];
+        const Point& p1 = chain[last];
+
+        // relative to p0 for precision
+        const double bx = pm.x - p0.x, by = pm.y - p0.y;
+        const double cx = p1.x - p0.x, cy = p1.y - p0.y;
+        const double d = 2.0 * (bx * cy - by * cx);
+        if (std::fabs(d) < 1e-12)
+            return false;
+        const double bSq = bx * bx + by * by;
+        const double cSq = cx * cx + cy * cy;
+        const double ux = (cy * bSq - by * cSq) / d;
+        const double uy = (bx * cSq - cx * bSq) / d;
+        const double radius = std::hypot(ux, uy);
+        if (radius > c_MAX_ARC_RADIUS)
+            return false;
+
+        const Point centre{ p0.x + ux, p0.y + uy };
+        for (int k = first; k <= last; k++)
+        {
+            if (std::fabs(std::hypot(chain[k].x - centre.x, chain[k].y - centre.y) - radius) > c_FIT_TOLERANCE)
+                return false;
+        }
+
+        // counter-clockwise from whichever end the turn starts at
+        const bool ccw = d > 0.0;
+        const Point& start = ccw ? p0 : p1;
+        const Point& end = ccw ? p1 : p0;
+        arc.shape = RailShape::Arc;
+        arc.x0 = static_cast<float>(centre.x);
+        arc.y0 = static_cast<float>(centre.y);
+        arc.radius = static_cast<float>(radius);
+        arc.angle = static_cast<float>(std::atan2(start.y - centre.y, start.x - centre.x));
+        arc.sweep = ArcOffset(arc, static_cast<float>(end.x), static_cast<float>(end.y));
+
+        // the points have to run along the arc, not around the rest of the circle
+        for (int k = first + 1; k < last; k++)
+        {
+            if (!InArc(arc, static_cast<float>(chain[k].x), static_cast<float>(chain[k].y)))
+                return false;
+        }
+        return true;
+    }
+
+    // fewest segments and arcs within the tolerance of a chain, splitting it at the point furthest off
+    // whatever did not fit
+    void FitChain(const std::vector<Point>& chain, std::vector<RailPrimitive>& out)
+    {
+        std::vector<std::pair<int, int>> pending{ { 0, static_cast<int>(chain.size()) - 1 } };
+        while (!pending.empty())
+        {
+            const auto [first, last] = pending.back();
+            pending.pop_back();
+
+            int furthest = first;
+            double deviation = 0.0;
+            for (int k = first + 1; k < last; k++)
+            {
+                const double distance = DistanceToSegment(chain[k], chain[first], chain[last]);
+                if (distance > deviation)
+                {
+                    deviation = distance;
+                    furthest = k;
+                }
+            }
+
+            RailPrimitive arc;
+            if (deviation <= c_FIT_TOLERANCE)
+            {
+                if (chain[first].x != chain[last].x || chain[first].y != chain[last].y)
+                    out.push_back(MakeSegment(chain[first], chain[last]));
+            }
+            else if (last - first >= 3 && FitArc(chain, first, last, arc))
+            {
+                out.push_back(arc);
+            }
+            else
+            {
+                pending.push_back({ furthest, last });
+                pending.push_back({ first, furthest });
+            }
+        }
+    }
+}
+
+bool RailGeometry::Bake(const std::vector<RailMeshView>& meshes, RailGeometry& out)
+{
+    const float maxX = 0.5f * c_TABLE_LENGTH + c_REGION_MARGIN;
+    const float maxY = 0.5f * c_TABLE_WIDTH + c_REGION_MARGIN;
+
+    // welded cut points and the segments between them
+    std::vector<Point> points;
+    std::vector<std::pair<int, int>> segments;
+    std::unordered_map<std::uint64_t, int> pointIds;
+    std::unordered_set<std::uint64_t> segmentIds;
+
+    auto weld = [&](const Point& p)
+    {
+        const auto qx = static_cast<std::uint32_t>(static_cast<std::int32_t>(std::llround(p.x / c_WELD_DISTANCE)));
+        const auto qy = static_cast<std::uint32_t>(static_cast<std::int32_t>(std::llround(p.y / c_WELD_DISTANCE)));
+        const auto [it, inserted] = pointIds.try_emplace(static_cast<std::uint64_t>(qx) << 32 | qy, static_cast<int>(points.size()));
+        if (inserted)
+            points.push_back(p);
+        return it->second;
+    };
+
+    for (const RailMeshView& mesh : meshes)
+    {
+        const auto* bytes = reinterpret_cast<const std::uint8_t*>(mesh.positions);
+        auto position = [&](int index, int axis)
+        {
+            float value;
+            std::memcpy(&value, bytes + static_cast<std::size_t>(index) * mesh.stride + axis * sizeof(float), sizeof(float));
+            return static_cast<double>(value);
+        };
+
+        for (std::size_t t = 0; t + 2 < mesh.indexCount; t += 3)
+        {
+            const int corners[3] = { mesh.indices[t], mesh.indices[t + 1], mesh.indices[t + 2] };
+            double height[3];
+            for (int k = 0; k < 3; k++)
+                height[k] = position(corners[k], 2) - c_SLICE_HEIGHT;
+
+            // corners on the plane count as above it, so both triangles of a shared edge cut it alike
+            Point cut[2];
+            int cutCount = 0;
+            for (int k = 0; k < 3; k++)
+            {
+                int a = corners[k];
+                int b = corners[(k + 1) % 3];
+                double ha = height[k];
+                double hb = height[(k + 1) % 3];
+                if ((ha >= 0.0) == (hb >= 0.0) || cutCount == 2)
+                    continue;
+
+                // the same edge from either triangle is cut from the same end, so the points come out identical
+                if (a > b)
+                {
+                    std::swap(a, b);
+                    std::swap(ha, hb);
+                }
+                const double s = ha / (ha - hb);
+                cut[cutCount++] = { position(a, 0) + s * (position(b, 0) - position(a, 0)),
+                                    position(a, 1) + s * (position(b, 1) - position(a, 1)) };
+            }
+            if (cutCount != 2)
+                continue;
+
+            const double midX = 0.5 * (cut[0].x + cut[1].x);
+            const double midY = 0.5 * (cut[0].y + cut[1].y);
+            if (std::fabs(midX) > maxX || std::fabs(midY) > maxY)
+                continue;
+
+            int a = weld(cut[0]);
+            int b = weld(cut[1]);
+            if (a == b)
+                continue;
+            if (a > b)
+                std::swap(a, b);
+            if (segmentIds.insert(static_cast<std::uint64_t>(a) << 32 | static_cast<std::uint32_t>(b)).second)
+                segments.push_back({ a, b });
+        }
+    }
+
+    // walk the segments into chains, from every end or branch first and then around the closed loops
+    std::vector<std::vector<int>> incident(points.size());
+    for (int s = 0; s < static_cast<int>(segments.size()); s++)
+    {
+        incident[segments[s].first].push_back(s);
+        incident[segments[s].second].push_back(s);
+    }
+
+    std::vector<RailPrimitive> primitives;
+    std::vector<std::uint8_t> used(segments.size(), 0);
+    std::vector<Point> chain;
+    auto follow = [&](int point, int segment)
+    {
+        chain.clear();
+        chain.push_back(points[point]);
+        while (segment >= 0)
+        {
+            used[segment] = 1;
+            point = segments[segment].first == point ? segments[segment].second : segments[segment].first;
+            chain.push_back(points[point]);
+
+            segment = -1;
+            if (incident[point].size() == 2)
+            {
+                for (int next : incident[point])
+                {
+                    if (!used[next])
+                        segment = next;
+                }
+            }
+        }
+        FitChain(chain, primitives);
+    };
+
+    for (int p = 0; p < static_cast<int>(points.size()); p++)
+    {
+        if (incident[p].size() == 2)
+            continue;
+        for (int s : incident[p])
+        {
+            if (!used[s])
+                follow(p, s);
+        }
+    }
+    for (int s = 0; s < static_cast<int>(segments.size()); s++)
+    {
+        if (!used[s])
+            follow(segments[s].first, s);
+    }
+
+    if (primitives.empty())
+        return false;
+
+    // a model that is not in table coordinates cuts somewhere else, or nowhere near the size of the table
+    float minX = primitives[0].x0, maxPX = primitives[0].x0;
+    float minY = primitives[0].y0, maxPY = primitives[0].y0;
+    for (const RailPrimitive& primitive : primitives)
+    {
+        const float reach = primitive.shape == RailShape::Arc ? primitive.radius : 0.0f;
+        const float x1 = primitive.shape == RailShape::Arc ? primitive.x0 : primitive.x1;
+        const float y1 = primitive.shape == RailShape::Arc ? primitive.y0 : primitive.y1;
+        minX = std::min({ minX, primitive.x0 - reach, x1 });
+        maxPX = std::max({ maxPX, primitive.x0 + reach, x1 });
+        minY = std::min({ minY, primitive.y0 - reach, y1 });
+        maxPY = std::max({ maxPY, primitive.y0 + reach, y1 });
+    }
+    if (maxPX - minX < 0.5f * c_TABLE_LENGTH || maxPY - minY < 0.5f * c_TABLE_WIDTH)
+        return false;
+
+    out.SetPrimitives(std::move(primitives));
+    return true;
+}
+
+void RailGeometry::SetPrimitives(std::vector<RailPrimitive> primitives)
+{
+    m_primitives = std::move(primitives);
+    BuildGrid();
+}
+
+bool RailGeometry::IsWithinArc(const RailPrimitive& arc, float x, float y)
+{
+    return InArc(arc, x, y);
+}
+
+void RailGeometry::GetArcEnd(const RailPrimitive& arc, bool last, float& x, float& y)
+{
+    ArcEnd(arc, last, x, y);
+}
+
+int RailGeometry::GetSegmentCount() const
+{
+    return static_cast<int>(std::count_if(m_primitives.begin(), m_primitives.end(),
+        [](const RailPrimitive& primitive) { return primitive.shape == RailShape::Segment; }));
+}
+
+int RailGeometry::GetArcCount() const
+{
+    return static_cast<int>(m_primitives.size()) - GetSegmentCount();
+}
+
+void RailGeometry::BuildGrid()
+{
+    m_cellStart.clear();
+    m_cellItems.clear();
+    m_columns = m_rows = 0;
+    if (m_primitives.empty())
+        return;
+
+    // bounds of every primitive, grown by a ball radius so a ball centre finds whatever it can touch in its own cell
+    const int count = static_cast<int>(m_primitives.size());
+    std::vector<float> bounds(static_cast<std::size_t>(count) * 4);
+    float minX = 0.0f, minY = 0.0f, maxX = 0.0f, maxY = 0.0f;
+    for (int i = 0; i < count; i++)
+    {
+        const RailPrimitive& primitive = m_primitives[i];
+        float* box = &bounds[static_cast<std::size_t>(i) * 4];
+        if (primitive.shape == RailShape::Arc)
+        {
+            box[0] = primitive.x0 - primitive.radius;
+            box[1] = primitive.y0 - primitive.radius;
+            box[2] = primitive.x0 + primitive.radius;
+            box[3] = primitive.y0 + primitive.radius;
+        }
+        else
+        {
+            box[0] = std::min(primitive.x0, primitive.x1);
+            box[1] = std::min(primitive.y0, primitive.y1);
+            box[2] = std::max(primitive.x0, primitive.x1);
+            box[3] = std::max(primitive.y0, primitive.y1);
+        }
+        box[0] -= c_BALL_RADIUS;
+        box[1] -= c_BALL_RADIUS;
+        box[2] += c_BALL_RADIUS;
+        box[3] += c_BALL_RADIUS;
+
+        minX = i == 0 ? box[0] : std::min(minX, box[0]);
+        minY = i == 0 ? box[1] : std::min(minY, box[1]);
+        maxX = i == 0 ? box[2] : std::max(maxX, box[2]);
+        maxY = i == 0 ? box[3] : std::max(maxY, box[3]);
+    }
+
+    const float cellSize = std::max(c_CELL_SIZE, std::max(maxX - minX, maxY - minY) / c_MAX_CELLS_PER_AXIS);
+    m_minX = minX;
+    m_minY = minY;
+    m_invCellSize = 1.0f / cellSize;
+    m_columns = std::max(1, static_cast<int>(std::ceil((maxX - minX) * m_invCellSize)));
+    m_rows = std::max(1, static_cast<int>(std::ceil((maxY - minY) * m_invCellSize)));
+
+    // count, prefix sum, fill
+    m_cellStart.assign(static_cast<std::size_t>(m_columns) * m_rows + 1, 0);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            const float* box = &bounds[static_cast<std::size_t>(i) * 4];
+            const int x1 = CellX(box[2]), y1 = CellY(box[3]);
+            for (int y = CellY(box[1]); y <= y1; y++)
+            {
+                for (int x = CellX(box[0]); x <= x1; x++)
+                {
+                    const std::size_t cell = static_cast<std::size_t>(y) * m_columns + x;
+                    if (pass == 0)
+                        ++m_cellStart[cell + 1];
+                    else
+                        m_cellItems[m_cellStart[cell]++] = static_cast<std::uint32_t>(i);
+                }
+            }
+        }
+
+        if (pass == 0)
+        {
+            for (std::size_t cell = 1; cell < m_cellStart.size(); cell++)
+                m_cellStart[cell] += m_cellStart[cell - 1];
+            m_cellItems.resize(m_cellStart.back());
+        }
+    }
+    // the fill moved every start to the next cell's
+    for (std::size_t cell = m_cellStart.size() - 1; cell > 0; cell--)
+        m_cellStart[cell] = m_cellStart[cell - 1];
+    m_cellStart[0] = 0;
+}
+
+int RailGeometry::CellX(float x) const
+{
+    return std::clamp(static_cast<int>(std::floor((x - m_minX) * m_invCellSize)), 0, m_columns - 1);
+}
+
+int RailGeometry::CellY(float y) const
+{
+    return std::clamp(static_cast<int>(std::floor((y - m_minY) * m_invCellSize)), 0, m_rows - 1);
+}
+
+bool RailGeometry::SweepCircle(float x, float y, float dx, float dy, float radius, Hit& hit) const
+{
+    hit = Hit();
+    if (m_primitives.empty())
+        return false;
+
+    // the cells already hold everything within a ball radius, larger circles look further
+    const float margin = std::max(0.0f, radius - c_BALL_RADIUS);
+    const int x0 = CellX(std::min(x, x + dx) - margin), x1 = CellX(std::max(x, x + dx) + margin);
+    const int y0 = CellY(std::min(y, y + dy) - margin), y1 = CellY(std::max(y, y + dy) + margin);
+
+    // a primitive spanning several cells is tested more than once, which costs less than remembering it
+    for (int cy = y0; cy <= y1; cy++)
+    {
+        for (int cx = x0; cx <= x1; cx++)
+        {
+            const std::size_t cell = static_cast<std::size_t>(cy) * m_columns + cx;
+            for (std::uint32_t k = m_cellStart[cell]; k < m_cellStart[cell + 1]; k++)
+            {
+                const int i = static_cast<int>(m_cellItems[k]);
+                const RailPrimitive& primitive = m_primitives[i];
+                if (primitive.shape == RailShape::Arc)
+                    SweepArc(x, y, dx, dy, radius, primitive, i, hit);
+                else
+                    SweepSegment(x, y, dx, dy, radius, primitive, i, hit);
+            }
+        }
+    }
+    return hit.primitive >= 0;
+}
+
+void RailGeometry::Query(float minX, float minY, float maxX, float maxY, std::vector<int>& out) const
+{
+    out.clear();
+    if (m_primitives.empty())
+        return;
+
+    const int x1 = CellX(maxX), y1 = CellY(maxY);
+    for (int cy = CellY(minY); cy <= y1; cy++)
+    {
+        for (int cx = CellX(minX); cx <= x1; cx++)
+        {
+            const std::size_t cell = static_cast<std::size_t>(cy) * m_columns + cx;
+            for (std::uint32_t k = m_cellStart[cell]; k < m_cellStart[cell + 1]; k++)
+                out.push_back(static_cast<int>(m_cellItems[k]));
+        }
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+float RailGeometry::GetNormal(int primitive, float x, float y, float& nx, float& ny) const
+{
+    const RailPrimitive& rail = m_primitives[primitive];
+    float cx, cy;
+    if (rail.shape == RailShape::Arc)
+    {
+        if (InArc(rail, x, y))
+        {
+            const float dx = x - rail.x0;
+            const float dy = y - rail.y0;
+            const float length = std::sqrt(dx * dx + dy * dy);
+            cx = length > 0.0f ? rail.x0 + rail.radius * dx / length : rail.x0 + rail.radius;
+            cy = length > 0.0f ? rail.y0 + rail.radius * dy / length : rail.y0;
+        }
+        else
+        {
+            float sx, sy, ex, ey;
+            ArcEnd(rail, false, sx, sy);
+            ArcEnd(rail, true, ex, ey);
+            const bool start = (x - sx) * (x - sx) + (y - sy) * (y - sy) <= (x - ex) * (x - ex) + (y - ey) * (y - ey);
+            cx = start ? sx : ex;
+            cy = start ? sy : ey;
+        }
+    }
+    else
+    {
+        const float ex = rail.x1 - rail.x0;
+        const float ey = rail.y1 - rail.y0;
+        const float lengthSq = ex * ex + ey * ey;
+        const float u = lengthSq > 0.0f ? std::clamp(((x - rail.x0) * ex + (y - rail.y0) * ey) / lengthSq, 0.0f, 1.0f) : 0.0f;
+        cx = rail.x0 + u * ex;
+        cy = rail.y0 + u * ey;
+    }
+
+    nx = x - cx;
+    ny = y - cy;
+    const float length = std::sqrt(nx * nx + ny * ny);
+    if (length > 0.0f)
+    {
+        nx /= length;
+        ny /= length;
+    }
+    else
+    {
+        nx = ny = 0.0f;
+    }
+    return length;
+}
+
+void RailGeometry::Serialize(std::vector<std::uint8_t>& out) const
+{
+    static_assert(std::is_trivially_copyable_v<RailPrimitive>);
+    const std::uint32_t header[2] = { c_VERSION, static_cast<std::uint32_t>(m_primitives.size()) };
+    const std::size_t bodySize = m_primitives.size() * sizeof(RailPrimitive);
+    out.resize(sizeof(header) + bodySize);
+    std::memcpy(out.data(), header, sizeof(header));
+    if (bodySize > 0)
+        std::memcpy(out.data() + sizeof(header), m_primitives.data(), bodySize);
+}
+
+bool RailGeometry::Deserialize(const std::uint8_t* data, std::size_t size)
+{
+    std::uint32_t header[2];
+    if (size < sizeof(header))
+        return false;
+    std::memcpy(header, data, sizeof(header));
+    if (header[0] != c_VERSION || size != sizeof(header) + static_cast<std::size_t>(header[1]) * sizeof(RailPrimitive))
+        return false;
+
+    std::vector<RailPrimitive> primitives(header[1]);
+    if (!primitives.empty())
+        std::memcpy(primitives.data(), data + sizeof(header), primitives.size() * sizeof(RailPrimitive));
+    for (const RailPrimitive& primitive : primitives)
+    {
+        if (primitive.shape != RailShape::Segment && primitive.shape != RailShape::Arc)
+            return false;
+    }
+    SetPrimitives(std::move(primitives));
+    return true;
+}
@@ -0,0 +1,361 @@
+#include "RenderQueue.h"
+#include "BoundingBox.h"
+#include "GeometryArena.h"
+#include "InstanceBuffer.h"
+#include "Model.h"
+#include "Primitives.h"
+#include "../Shader.h"
+
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+namespace
+{
+    // key layout, from the top: occlusion tested 1 bit, shader 8 bits, instanced 1 bit, material 16 bits,
+    // geometry 16 bits
+    constexpr int c_OCCLUSION_SHIFT = 63;
+    constexpr int c_SHADER_SHIFT = 55;
+    constexpr int c_INSTANCED_SHIFT = 54;
+    constexpr int c_MATERIAL_SHIFT = 38;
+    constexpr int c_GEOMETRY_SHIFT = 22;
+
+    constexpr std::uint32_t c_NO_STATE = 0xFFFFFFFFu;
+
+    // query boxes are grown a little so flat meshes do not z-fight with their own box
+    constexpr float c_OCCLUSION_BOX_MARGIN = 0.01f;
+    // a camera this close to a box may have it clipped by the near plane, the camera's near distance
+    constexpr float c_OCCLUSION_NEAR_MARGIN = 0.1f;
+}
+
+RenderQueue::RenderQueue() = default;
+RenderQueue::~RenderQueue() = default;
+
+std::uint8_t RenderQueue::AddShader(const Shader& shader)
+{
+    m_shaders.push_back({ shader.ID, shader.GetUniformLocation("objectColor"), shader.GetUniformLocation("uniformScale") });
+    return static_cast<std::uint8_t>(m_shaders.size() - 1);
+}
+
+std::uint16_t RenderQueue::AddMaterial(const Material& material)
+{
+    m_materials.push_back(material);
+    return static_cast<std::uint16_t>(m_materials.size() - 1);
+}
+
+std::uint16_t RenderQueue::AddOcclusionTest()
+{
+    m_occlusionTests.emplace_back();
+    return static_cast<std::uint16_t>(m_occlusionTests.size() - 1);
+}
+
+void RenderQueue::SetView(const glm::mat4& viewProjection, const glm::vec3& viewPosition)
+{
+    m_frustum.Update(viewProjection);
+    m_viewPosition = viewPosition;
+}
+
+void RenderQueue::Submit(std::uint8_t shader, std::uint16_t material, const Model& model,
+                         const glm::mat4& transform, const glm::mat3& normalMatrix, std::uint16_t occlusionTest)
+{
+    Record({ &model, nullptr, 0, transform, normalMatrix, shader, material, occlusionTest });
+}
+
+void RenderQueue::SubmitInstanced(std::uint8_t shader, std::uint16_t material, const Model& model,
+                                  const InstanceBuffer& instances, int instanceCount)
+{
+    if (instanceCount < 0 || instanceCount > instances.GetCount())
+        instanceCount = instances.GetCount();
+    if (instanceCount == 0)
+        return;
+    Record({ &model, &instances, instanceCount, glm::mat4(1.0f), glm::mat3(1.0f), shader, material, c_NO_OCCLUSION_TEST });
+}
+
+void RenderQueue::Record(const Item& item)
+{
+    m_order.push_back({ MakeKey(item), static_cast<std::uint32_t>(m_items.size()) });
+    m_items.push_back(item);
+}
+
+std::uint64_t RenderQueue::MakeKey(const Item& item)
+{
+    // only draws of the same model need equal geometry bits, a hash of the address is enough for that
+    const std::uint64_t geometry = std::hash<const Model*>()(item.model) & 0xFFFF;
+    // tested draws go last, so their queries see the depth of everything else
+    const std::uint64_t tested = item.occlusionTest != c_NO_OCCLUSION_TEST ? 1 : 0;
+    return (tested << c_OCCLUSION_SHIFT)
+        | (std::uint64_t(item.shader) << c_SHADER_SHIFT)
+        | (std::uint64_t(item.instances ? 1 : 0) << c_INSTANCED_SHIFT)
+        | (std::uint64_t(item.material) << c_MATERIAL_SHIFT)
+        | (geometry << c_GEOMETRY_SHIFT);
+}
+
+void RenderQueue::RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+{
+    scratch.resize(entries.size());
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        std::uint32_t counts[256] = {};
+        for (const SortEntry& entry : entries)
+            counts[(entry.key >> shift) & 0xFF]++;
+        if (counts[(entries[0].key >> shift) & 0xFF] == entries.size())
+            continue;
+
+        std::uint32_t offsets[256];
+        std::uint32_t total = 0;
+        for (int digit = 0; digit < 256; digit++)
+        {
+            offsets[digit] = total;
+            total += counts[digit];
+        }
+
+        // stable scatter, so earlier passes keep ordering the lower digits
+        for (const SortEntry& entry : entries)
+            scratch[offsets[(entry.key >> shift) & 0xFF]++] = entry;
+        entries.swap(scratch);
+    }
+}
+
+void RenderQueue::Flush()
+{
+    m_stats = Stats();
+    m_stats.items = static_cast<int>(m_items.size());
+    ReadOcclusionResults();
+    if (m_items.empty())
+        return;
+
+    RadixSort(m_order, m_scratch);
+
+    // nothing is assumed about the state before the flush, every kind of state is set once at least
+    std::uint32_t shader = c_NO_STATE;
+    std::uint32_t material = c_NO_STATE;
+    int vertexArray = -1; // 0 plain, 1 instanced
+    const InstanceBuffer* instances = nullptr;
+    GeometryArena& arena = GeometryArena::Get();
+
+    for (const SortEntry& entry : m_order)
+    {
+        const Item& item = m_items[entry.item];
+        const ShaderEntry& program = m_shaders[item.shader];
+
+        // culled before any state is bound, so a draw with nothing visible costs nothing at all
+        const int meshCount = item.model->GetMeshCount();
+        int visibleMeshes = meshCount;
+        if (!item.instances)
+        {
+            CullMeshes(item);
+            OcclusionTest* test = nullptr;
+            if (m_occlusionCulling && item.occlusionTest != c_NO_OCCLUSION_TEST)
+            {
+                test = &m_occlusionTests[item.occlusionTest];
+                ResizeOcclusionTest(*test, meshCount);
+                m_testedItems.push_back(entry.item);
+            }
+
+            visibleMeshes = 0;
+            for (int i = 0; i < meshCount; i++)
+            {
+                if (!m_meshVisible[i])
+                {
+                    // the result is stale by the time the mesh comes back, so it is drawn until queried again
+                    if (test)
+                        test->visible[i] = 1;
+                    m_stats.culledMeshes++;
+                }
+                else if (test && !test->visible[i])
+                {
+                    m_meshVisible[i] = 0;
+                    m_stats.occludedMeshes++;
+                }
+                else
+                {
+                    visibleMeshes++;
+                }
+            }
+            if (visibleMeshes == 0)
+                continue;
+        }
+
+        if (item.shader != shader)
+        {
+            glUseProgram(program.program);
+            shader = item.shader;
+            material = c_NO_STATE; // uniforms are per program
+            m_stats.shaderBinds++;
+        }
+
+        const int itemVertexArray = item.instances ? 1 : 0;
+        if (itemVertexArray != vertexArray)
+        {
+            if (item.instances)
+                arena.BindInstancedVertexArray();
+            else
+                arena.BindVertexArray();
+            vertexArray = itemVertexArray;
+            instances = nullptr;
+            m_stats.vertexArrayBinds++;
+        }
+
+        if (item.material != material)
+        {
+            const Material& values = m_materials[item.material];
+            glUniform3fv(program.colorLocation, 1, &values.color[0]);
+            glUniform1i(program.uniformScaleLocation, values.uniformScale ? 1 : 0);
+            material = item.material;
+            m_stats.materialChanges++;
+        }
+
+        if (item.instances)
+        {
+            if (item.instances != instances)
+            {
+                item.instances->BindAttributes();
+                instances = item.instances;
+            }
+            item.model->SubmitInstanced(item.instanceCount);
+            m_stats.drawCalls += meshCount;
+        }
+        else
+        {
+            InstanceBuffer::SetSingleInstance(item.transform, item.normalMatrix);
+            if (visibleMeshes == meshCount)
+            {
+                item.model->GetBatch().Submit();
+                m_stats.drawCalls += item.model->GetBatch().GetCallCount();
+            }
+            else
+            {
+                m_stats.drawCalls += item.model->GetBatch().SubmitVisible(m_meshVisible.data());
+            }
+        }
+    }
+
+    // the boxes only test against depth, nothing they cover may change
+    if (!m_testedItems.empty())
+    {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        glDepthFunc(GL_LEQUAL);
+        arena.BindVertexArray();
+        for (std::uint32_t index : m_testedItems)
+            IssueOcclusionQueries(m_items[index]);
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        m_testedItems.clear();
+    }
+
+    m_items.clear();
+    m_order.clear();
+}
+
+void RenderQueue::Shutdown()
+{
+    for (OcclusionTest& test : m_occlusionTests)
+        ResizeOcclusionTest(test, 0);
+    m_occlusionBox.reset();
+}
+
+void RenderQueue::CullMeshes(const Item& item)
+{
+    const int meshCount = item.model->GetMeshCount();
+    m_boxCenterX.resize(meshCount);
+    m_boxCenterY.resize(meshCount);
+    m_boxCenterZ.resize(meshCount);
+    m_boxExtentX.resize(meshCount);
+    m_boxExtentY.resize(meshCount);
+    m_boxExtentZ.resize(meshCount);
+    m_meshVisible.resize(meshCount);
+
+    for (int i = 0; i < meshCount; i++)
+    {
+        const BoundingBox box = item.model->GetMesh(i).GetBounds().Transformed(item.transform);
+        const glm::vec3 center = box.GetCenter();
+        const glm::vec3 extent = box.GetExtent();
+        m_boxCenterX[i] = center.x;
+        m_boxCenterY[i] = center.y;
+        m_boxCenterZ[i] = center.z;
+        m_boxExtentX[i] = extent.x;
+        m_boxExtentY[i] = extent.y;
+        m_boxExtentZ[i] = extent.z;
+    }
+    m_frustum.CullBoxes(m_boxCenterX.data(), m_boxCenterY.data(), m_boxCenterZ.data(),
+                        m_boxExtentX.data(), m_boxExtentY.data(), m_boxExtentZ.data(), meshCount, m_meshVisible.data());
+}
+
+void RenderQueue::ReadOcclusionResults()
+{
+    // queries from the last flush, any not finished yet keep their previous result for another frame
+    for (OcclusionTest& test : m_occlusionTests)
+    {
+        for (size_t i = 0; i < test.queries.size(); i++)
+        {
+            if (!test.pending[i])
+                continue;
+            GLuint available = 0;
+            glGetQueryObjectuiv(test.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                continue;
+            GLuint passed = 0;
+            glGetQueryObjectuiv(test.queries[i], GL_QUERY_RESULT, &passed);
+            test.visible[i] = passed ? 1 : 0;
+            test.pending[i] = 0;
+        }
+    }
+}
+
+void RenderQueue::IssueOcclusionQueries(const Item& item)
+{
+    if (!m_occlusionBox)
+    {
+        std::vector<Mesh> meshes;
+        meshes.push_back(Primitives::CreateBox(2.0f, 2.0f, 2.0f));
+        m_occlusionBox = std::make_unique<Model>(std::move(meshes), "");
+    }
+
+    CullMeshes(item);
+    OcclusionTest& test = m_occlusionTests[item.occlusionTest];
+    glUseProgram(m_shaders[item.shader].program);
+
+    for (int i = 0; i < item.model->GetMeshCount(); i++)
+    {
+        if (!m_meshVisible[i] || test.pending[i])
+            continue;
+
+        const glm::vec3 center(m_boxCenterX[i], m_boxCenterY[i], m_boxCenterZ[i]);
+        const glm::vec3 extent = glm::vec3(m_boxExtentX[i], m_boxExtentY[i], m_boxExtentZ[i]) + c_OCCLUSION_BOX_MARGIN;
+
+        // from inside its box only clipped back faces would be drawn, the mesh surrounds the camera and is visible
+        const glm::vec3 offset = m_viewPosition - center;
+        if (std::abs(offset.x) <= extent.x + c_OCCLUSION_NEAR_MARGIN && std::abs(offset.y) <= extent.y + c_OCCLUSION_NEAR_MARGIN
+            && std::abs(offset.z) <= extent.z + c_OCCLUSION_NEAR_MARGIN)
+        {
+            test.visible[i] = 1;
+            continue;
+        }
+
+        const glm::mat4 transform(glm::vec4(extent.x, 0.0f, 0.0f, 0.0f), glm::vec4(0.0f, extent.y, 0.0f, 0.0f),
+                                  glm::vec4(0.0f, 0.0f, extent.z, 0.0f), glm::vec4(center, 1.0f));
+        InstanceBuffer::SetSingleInstance(transform, glm::mat3(1.0f));
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, test.queries[i]);
+        m_occlusionBox->GetBatch().Submit();
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        test.pending[i] = 1;
+        m_stats.occlusionQueries++;
+    }
+}
+
+void RenderQueue::ResizeOcclusionTest(OcclusionTest& test, int meshCount)
+{
+    if (test.queries.size() == static_cast<size_t>(meshCount))
+        return;
+
+    // the model behind the id changed, a streamed in asset replacing its placeholder
+    if (!test.queries.empty())
+        glDeleteQueries(static_cast<GLsizei>(test.queries.size()), test.queries.data());
+    test.queries.assign(meshCount, 0);
+    if (meshCount > 0)
+        glGenQueries(meshCount, test.queries.data());
+    test.pending.assign(meshCount, 0);
+    test.visible.assign(meshCount, 1);
+}
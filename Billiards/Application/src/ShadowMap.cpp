@@ -0,0 +1,109 @@
+#include "ShadowMap.h"
+
+#include <glad/gl.h>
+
+#include <stdexcept>
+
+ShadowMap::ShadowMap(int size)
+    : m_size(size)
+{
+    glGenTextures(2, m_textures);
+    glGenFramebuffers(2, m_framebuffers);
+
+    // outside the map the border depth of 1 passes every comparison, so nothing there is shadowed
+    const float border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    GLenum status = GL_FRAMEBUFFER_COMPLETE;
+    for (int i = 0; i < 2 && status == GL_FRAMEBUFFER_COMPLETE; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+        // linear filtering of a comparison sampler gives 2x2 percentage closer filtering for free
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffers[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_textures[i], 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        glDeleteFramebuffers(2, m_framebuffers);
+        glDeleteTextures(2, m_textures);
+        throw std::runtime_error("Shadow map framebuffer is incomplete");
+    }
+}
+
+ShadowMap::~ShadowMap()
+{
+    glDeleteFramebuffers(2, m_framebuffers);
+    glDeleteTextures(2, m_textures);
+}
+
+void ShadowMap::BeginStatic()
+{
+    SaveState();
+    Begin(m_framebuffers[Static]);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    m_drawingStatic = true;
+}
+
+void ShadowMap::BeginDynamic()
+{
+    // before the blit below, which rebinds the draw framebuffer
+    SaveState();
+    if (GLAD_GL_VERSION_4_3)
+    {
+        glCopyImageSubData(m_textures[Static], GL_TEXTURE_2D, 0, 0, 0, 0,
+                           m_textures[Composite], GL_TEXTURE_2D, 0, 0, 0, 0, m_size, m_size, 1);
+    }
+    else
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffers[Static]);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffers[Composite]);
+        glBlitFramebuffer(0, 0, m_size, m_size, 0, 0, m_size, m_size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    }
+    Begin(m_framebuffers[Composite]);
+}
+
+void ShadowMap::SaveState()
+{
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, m_previousViewport);
+}
+
+void ShadowMap::Begin(unsigned int framebuffer)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, m_size, m_size);
+    // pushes the stored depth back along the slope, against acne on surfaces facing away from the light
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+}
+
+void ShadowMap::End()
+{
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(m_previousFramebuffer));
+    glViewport(m_previousViewport[0], m_previousViewport[1], m_previousViewport[2], m_previousViewport[3]);
+
+    if (m_drawingStatic)
+        m_staticValid = true;
+    m_drawingStatic = false;
+}
+
+void ShadowMap::Bind(unsigned int unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, m_textures[Composite]);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,357 @@
+#include "ShotLog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+    constexpr char c_MAGIC[4] = { 'B', 'S', 'H', 'L' };
+    constexpr std::size_t c_HEADER_SIZE = 14; // magic, version, fixed step, keyframe interval
+
+    // velocity fields of a keyframe ball, a bit each in the mask byte above the 3 state bits
+    constexpr int c_STATE_BITS = 3;
+    constexpr int c_VELOCITY_FIELDS = 5;
+    constexpr int c_SHOT_FIELDS = 4;
+
+    std::uint32_t FloatBits(float value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float BitsFloat(std::uint32_t bits)
+    {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    void WriteU8(std::vector<std::uint8_t>& out, std::uint8_t value)
+    {
+        out.push_back(value);
+    }
+
+    void WriteU32(std::vector<std::uint8_t>& out, std::uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+            out.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+    }
+
+    void WriteFloat(std::vector<std::uint8_t>& out, float value)
+    {
+        WriteU32(out, FloatBits(value));
+    }
+
+    void WriteVarint(std::vector<std::uint8_t>& out, std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    // bounds checked reads, every one fails once the data runs out
+    struct Reader
+    {
+        const std::vector<std::uint8_t>& data;
+        std::size_t offset;
+
+        bool U8(std::uint8_t& value)
+        {
+            if (offset + 1 > data.size())
+                return false;
+            value = data[offset++];
+            return true;
+        }
+
+        bool U32(std::uint32_t& value)
+        {
+            if (offset + 4 > data.size())
+                return false;
+            value = 0;
+            for (int i = 0; i < 4; i++)
+                value |= static_cast<std::uint32_t>(data[offset++]) << (8 * i);
+            return true;
+        }
+
+        bool Float(float& value)
+        {
+            std::uint32_t bits;
+            if (!U32(bits))
+                return false;
+            value = BitsFloat(bits);
+            return true;
+        }
+
+        bool Varint(std::uint64_t& value)
+        {
+            value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                std::uint8_t byte;
+                if (!U8(byte))
+                    return false;
+                value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80))
+                    return true;
+            }
+            return false;
+        }
+    };
+
+    float* ShotField(CueShot& shot, int field)
+    {
+        float* fields[c_SHOT_FIELDS] = { &shot.angle, &shot.speed, &shot.sideSpin, &shot.topSpin };
+        return fields[field];
+    }
+}
+
+void ShotLog::Begin(const PhysicsWorld& world, std::uint32_t keyframeInterval)
+{
+    m_data.clear();
+    m_keyframes.clear();
+    m_fixedStep = world.GetFixedStep();
+    m_keyframeInterval = std::max<std::uint32_t>(keyframeInterval, 1);
+    m_strikeCount = 0;
+    m_ended = false;
+
+    m_data.insert(m_data.end(), std::begin(c_MAGIC), std::end(c_MAGIC));
+    WriteU8(m_data, static_cast<std::uint8_t>(c_VERSION));
+    WriteU8(m_data, static_cast<std::uint8_t>(c_VERSION >> 8));
+    WriteFloat(m_data, m_fixedStep);
+    WriteU32(m_data, m_keyframeInterval);
+
+    // the starting table, every replay begins here
+    WriteKeyframe(world);
+}
+
+void ShotLog::WriteKeyframe(const PhysicsWorld& world)
+{
+    WorldState state;
+    world.SaveWorldState(state);
+
+    m_keyframes.push_back({ state.stepCount, m_data.size() });
+    WriteU8(m_data, static_cast<std::uint8_t>(RecordType::Keyframe));
+    WriteVarint(m_data, state.stepCount);
+    WriteU8(m_data, state.ballCount);
+    WriteFloat(m_data, state.time);
+    WriteFloat(m_data, state.accumulator);
+    for (int i = 0; i < state.ballCount; i++)
+    {
+        const float velocities[c_VELOCITY_FIELDS] = { state.velX[i], state.velY[i], state.angX[i], state.angY[i], state.angZ[i] };
+        std::uint8_t mask = 0;
+        for (int field = 0; field < c_VELOCITY_FIELDS; field++)
+        {
+            // bitwise, so -0.0f survives the round trip
+            if (FloatBits(velocities[field]) != 0)
+                mask |= static_cast<std::uint8_t>(1u << field);
+        }
+        WriteU8(m_data, static_cast<std::uint8_t>(static_cast<std::uint8_t>(state.state[i]) | (mask << c_STATE_BITS)));
+        WriteFloat(m_data, state.posX[i]);
+        WriteFloat(m_data, state.posY[i]);
+        for (int field = 0; field < c_VELOCITY_FIELDS; field++)
+        {
+            if (mask & (1u << field))
+                WriteFloat(m_data, velocities[field]);
+        }
+    }
+
+    m_lastStep = state.stepCount;
+    m_lastShot = CueShot();
+    m_nextKeyframe = state.stepCount + m_keyframeInterval;
+}
+
+void ShotLog::RecordStrike(const PhysicsWorld& world, int ball, const CueShot& shot)
+{
+    if (m_data.empty() || m_ended)
+        return;
+
+    const std::uint64_t step = world.GetStepCount();
+    WriteU8(m_data, static_cast<std::uint8_t>(RecordType::Strike));
+    WriteVarint(m_data, step - m_lastStep);
+    WriteU8(m_data, static_cast<std::uint8_t>(ball));
+
+    CueShot current = shot;
+    std::uint8_t mask = 0;
+    for (int field = 0; field < c_SHOT_FIELDS; field++)
+    {
+        if (FloatBits(*ShotField(current, field)) != FloatBits(*ShotField(m_lastShot, field)))
+            mask |= static_cast<std::uint8_t>(1u << field);
+    }
+    WriteU8(m_data, mask);
+    for (int field = 0; field < c_SHOT_FIELDS; field++)
+    {
+        if (mask & (1u << field))
+            WriteFloat(m_data, *ShotField(current, field));
+    }
+
+    m_lastStep = step;
+    m_lastShot = shot;
+    m_strikeCount++;
+}
+
+void ShotLog::RecordTick(const PhysicsWorld& world)
+{
+    if (m_data.empty() || m_ended)
+        return;
+    // a resting table replays by stepping alone, keyframes only pay off while something moves
+    if (world.GetStepCount() >= m_nextKeyframe && !world.IsAtRest())
+        WriteKeyframe(world);
+}
+
+void ShotLog::End(const PhysicsWorld& world)
+{
+    if (m_data.empty() || m_ended)
+        return;
+
+    const std::uint64_t step = world.GetStepCount();
+    WriteU8(m_data, static_cast<std::uint8_t>(RecordType::End));
+    WriteVarint(m_data, step - m_lastStep);
+    m_lastStep = step;
+    m_ended = true;
+}
+
+bool ShotLog::Save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    out.write(reinterpret_cast<const char*>(m_data.data()), static_cast<std::streamsize>(m_data.size()));
+    return static_cast<bool>(out);
+}
+
+bool ShotLog::Load(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.size() < c_HEADER_SIZE || std::memcmp(data.data(), c_MAGIC, sizeof(c_MAGIC)) != 0)
+        return false;
+
+    Reader reader{ data, sizeof(c_MAGIC) };
+    std::uint8_t versionLow, versionHigh;
+    reader.U8(versionLow);
+    reader.U8(versionHigh);
+    if ((versionLow | (versionHigh << 8)) != c_VERSION)
+        return false;
+    reader.Float(m_fixedStep);
+    reader.U32(m_keyframeInterval);
+
+    m_data = std::move(data);
+    m_keyframes.clear();
+    m_strikeCount = 0;
+    m_ended = true; // loaded logs are never appended to
+
+    // one pass over every record builds the keyframe index and rejects truncated files
+    Cursor cursor;
+    cursor.offset = c_HEADER_SIZE;
+    Record record;
+    bool ended = false;
+    while (cursor.offset < m_data.size())
+    {
+        const std::size_t offset = cursor.offset;
+        if (!ReadRecord(cursor, record))
+            break;
+        if (record.type == RecordType::Keyframe)
+            m_keyframes.push_back({ record.step, offset });
+        else if (record.type == RecordType::Strike)
+            m_strikeCount++;
+        else
+            ended = true;
+        m_lastStep = record.step;
+    }
+
+    const bool valid = ended && cursor.offset == m_data.size() && !m_keyframes.empty() && m_fixedStep > 0.0f;
+    if (!valid)
+    {
+        m_data.clear();
+        m_keyframes.clear();
+    }
+    return valid;
+}
+
+ShotLog::Cursor ShotLog::FindKeyframe(std::uint64_t step) const
+{
+    Cursor cursor;
+    cursor.offset = m_data.size();
+    if (m_keyframes.empty())
+        return cursor;
+
+    auto it = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), step,
+        [](std::uint64_t value, const KeyframeEntry& entry) { return value < entry.step; });
+    if (it != m_keyframes.begin())
+        --it;
+    cursor.offset = it->offset;
+    cursor.step = it->step;
+    return cursor;
+}
+
+bool ShotLog::ReadRecord(Cursor& cursor, Record& record) const
+{
+    Reader reader{ m_data, cursor.offset };
+    std::uint8_t type;
+    std::uint64_t step;
+    if (!reader.U8(type) || !reader.Varint(step))
+        return false;
+
+    record.type = static_cast<RecordType>(type);
+    switch (record.type)
+    {
+    case RecordType::Keyframe:
+    {
+        WorldState& state = record.state;
+        state = WorldState();
+        state.stepCount = step;
+        if (!reader.U8(state.ballCount) || state.ballCount > c_BALL_COUNT
+            || !reader.Float(state.time) || !reader.Float(state.accumulator))
+            return false;
+        for (int i = 0; i < state.ballCount; i++)
+        {
+            std::uint8_t packed;
+            if (!reader.U8(packed) || !reader.Float(state.posX[i]) || !reader.Float(state.posY[i]))
+                return false;
+            state.state[i] = static_cast<BallState>(packed & ((1u << c_STATE_BITS) - 1));
+            float* velocities[c_VELOCITY_FIELDS] = { &state.velX[i], &state.velY[i], &state.angX[i], &state.angY[i], &state.angZ[i] };
+            for (int field = 0; field < c_VELOCITY_FIELDS; field++)
+            {
+                if ((packed >> c_STATE_BITS) & (1u << field) && !reader.Float(*velocities[field]))
+                    return false;
+            }
+        }
+        record.step = step;
+        cursor.lastShot = CueShot();
+        break;
+    }
+    case RecordType::Strike:
+    {
+        std::uint8_t ball, mask;
+        if (!reader.U8(ball) || !reader.U8(mask))
+            return false;
+        record.ball = ball;
+        record.shot = cursor.lastShot;
+        for (int field = 0; field < c_SHOT_FIELDS; field++)
+        {
+            if (mask & (1u << field) && !reader.Float(*ShotField(record.shot, field)))
+                return false;
+        }
+        record.step = cursor.step + step;
+        cursor.lastShot = record.shot;
+        break;
+    }
+    case RecordType::End:
+        record.step = cursor.step + step;
+        break;
+    default:
+        return false;
+    }
+
+    cursor.step = record.step;
+    cursor.offset = reader.offset;
+    return true;
+}
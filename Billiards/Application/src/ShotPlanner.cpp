@@ -0,0 +1,411 @@
+#include "ShotPlanner.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+    constexpr float c_PI = 3.14159265358979f;
+
+    // scoring, a potted ball always outweighs the best position
+    constexpr float c_POT_REWARD = 1.0f;
+    constexpr float c_POSITION_WEIGHT = 0.5f;
+    constexpr float c_SCRATCH_PENALTY = -1.0f;
+    constexpr float c_MIN_CUT = 0.2f; // cosine of the steepest cut the position score still counts
+
+    constexpr float c_MIN_SPEED = 0.3f;    // m/s, anything slower barely reaches another ball
+    constexpr float c_MAX_SHOT_TIME = 30.0f; // s
+    constexpr float c_AIM_JITTER = 0.01f;  // rad around the ghost ball angles of the first round
+
+    // refinement starts this wide around a candidate and never narrows below the floor
+    constexpr float c_INITIAL_SIGMA[4] = { 0.02f, 0.4f, 0.25f, 0.25f };
+    constexpr float c_MIN_SIGMA[4] = { 0.0005f, 0.02f, 0.02f, 0.02f };
+    // candidates closer than this in angle and speed are the same shot
+    constexpr float c_DISTINCT_ANGLE = 0.02f;
+    constexpr float c_DISTINCT_SPEED = 0.5f;
+
+    // how far off a played shot is expected to be
+    constexpr float c_NOISE_ANGLE = 0.002f;  // rad
+    constexpr float c_NOISE_SPEED = 0.03f;   // relative
+    constexpr float c_NOISE_SPIN = 0.05f;    // radii
+
+    float WrapAngle(float angle)
+    {
+        return std::remainder(angle, 2.0f * c_PI);
+    }
+
+    bool IsOnTable(const TableState& table, int ball)
+    {
+        return table.state[ball] != BallState::Pocketed;
+    }
+
+    // whether a ball other than the two skipped ones is in the way of a ball rolling from 0 to 1
+    bool PathBlocked(const TableState& table, int skipA, int skipB, float x0, float y0, float x1, float y1)
+    {
+        const float dx = x1 - x0;
+        const float dy = y1 - y0;
+        const float lengthSq = dx * dx + dy * dy;
+        if (lengthSq <= 0.0f)
+            return false;
+
+        for (int i = 0; i < table.ballCount; i++)
+        {
+            if (i == skipA || i == skipB || !IsOnTable(table, i))
+                continue;
+            const float t = std::clamp(((table.posX[i] - x0) * dx + (table.posY[i] - y0) * dy) / lengthSq, 0.0f, 1.0f);
+            const float ox = x0 + dx * t - table.posX[i];
+            const float oy = y0 + dy * t - table.posY[i];
+            if (ox * ox + oy * oy < c_BALL_DIAMETER * c_BALL_DIAMETER)
+                return true;
+        }
+        return false;
+    }
+
+    // where the cue ball has to be to send ball into pocket, false when the cut is too thin
+    bool GhostBall(const TableState& table, int cueBall, int ball, int pocket, float& x, float& y, float& cut)
+    {
+        float pocketX, pocketY;
+        PhysicsWorld::GetPocketPosition(pocket, pocketX, pocketY);
+        const float toPocketX = pocketX - table.posX[ball];
+        const float toPocketY = pocketY - table.posY[ball];
+        const float pocketDistance = std::sqrt(toPocketX * toPocketX + toPocketY * toPocketY);
+        if (pocketDistance <= 0.0f)
+            return false;
+
+        x = table.posX[ball] - toPocketX / pocketDistance * c_BALL_DIAMETER;
+        y = table.posY[ball] - toPocketY / pocketDistance * c_BALL_DIAMETER;
+        const float aimX = x - table.posX[cueBall];
+        const float aimY = y - table.posY[cueBall];
+        const float aimDistance = std::sqrt(aimX * aimX + aimY * aimY);
+        if (aimDistance <= 0.0f)
+            return false;
+        cut = (aimX * toPocketX + aimY * toPocketY) / (aimDistance * pocketDistance);
+        return cut > c_MIN_CUT;
+    }
+}
+
+ShotPlanner::ShotPlanner(unsigned threadCount, const ShotPlannerSettings& settings)
+    : m_settings(settings)
+    , m_simulator(threadCount)
+{
+    // the event-driven solver jumps between collisions, by far the cheapest way through a whole shot
+    m_simulator.SetSolverMode(SolverMode::EventDriven);
+    m_simulator.SetMaxShotTime(c_MAX_SHOT_TIME);
+}
+
+ShotPlanner::~ShotPlanner()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+ShotPlan ShotPlanner::Plan(const TableState& table, int cueBall)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    m_table = table;
+    m_cueBall = cueBall;
+    m_evaluated = 0;
+    m_random.seed(m_settings.seed);
+    {
+        std::lock_guard<std::mutex> lock(m_resultMutex);
+        m_simulator.SetRailGeometry(m_rails);
+    }
+
+    ShotPlan plan;
+    if (cueBall < 0 || cueBall >= table.ballCount || !IsOnTable(table, cueBall))
+        return plan;
+
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+
+    // broad round, half of it aimed at every pot that is open from here
+    std::vector<float> aims;
+    for (int ball = 0; ball < table.ballCount; ball++)
+    {
+        if (ball == cueBall || !IsOnTable(table, ball))
+            continue;
+        for (int pocket = 0; pocket < c_POCKET_COUNT; pocket++)
+        {
+            float x, y, cut;
+            if (GhostBall(table, cueBall, ball, pocket, x, y, cut))
+                aims.push_back(std::atan2(y - table.posY[cueBall], x - table.posX[cueBall]));
+        }
+    }
+
+    std::vector<Params> params(static_cast<size_t>(std::max(m_settings.samples, 1)));
+    for (size_t k = 0; k < params.size(); k++)
+    {
+        Params& p = params[k];
+        p.angle = !aims.empty() && k % 2 == 0 ? aims[(k / 2) % aims.size()] + c_AIM_JITTER * normal(m_random)
+            : c_PI * uniform(m_random);
+        p.speed = c_MIN_SPEED + (m_settings.maxSpeed - c_MIN_SPEED) * 0.5f * (uniform(m_random) + 1.0f);
+        p.sideSpin = m_settings.maxSpin * uniform(m_random);
+        p.topSpin = m_settings.maxSpin * uniform(m_random);
+        p = Clamp(p);
+    }
+    std::vector<float> scores;
+    Evaluate(params, scores);
+
+    // prune to the best shots that are not minor variations of each other
+    std::vector<int> order(params.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return scores[a] > scores[b]; });
+
+    std::vector<Params> best;
+    std::vector<float> bestScores;
+    for (int k : order)
+    {
+        if (static_cast<int>(best.size()) >= std::max(m_settings.candidates, 1))
+            break;
+        const bool duplicate = std::any_of(best.begin(), best.end(), [&](const Params& other)
+        {
+            return std::fabs(WrapAngle(params[k].angle - other.angle)) < c_DISTINCT_ANGLE
+                && std::fabs(params[k].speed - other.speed) < c_DISTINCT_SPEED;
+        });
+        if (!duplicate)
+        {
+            best.push_back(params[k]);
+            bestScores.push_back(scores[k]);
+        }
+    }
+
+    // cross-entropy refinement, every candidate fits a diagonal gaussian to its elite samples
+    const int candidateCount = static_cast<int>(best.size());
+    const int perCandidate = std::max(m_settings.refineSamples, 1);
+    const int eliteCount = std::clamp(m_settings.eliteCount, 1, perCandidate);
+    std::vector<Params> means = best;
+    std::vector<std::array<float, 4>> sigmas(best.size());
+    for (auto& sigma : sigmas)
+        std::copy(std::begin(c_INITIAL_SIGMA), std::end(c_INITIAL_SIGMA), sigma.begin());
+
+    params.resize(static_cast<size_t>(candidateCount * perCandidate));
+    order.resize(static_cast<size_t>(perCandidate));
+    for (int iteration = 0; iteration < m_settings.refineIterations; iteration++)
+    {
+        for (int c = 0; c < candidateCount; c++)
+        {
+            for (int s = 0; s < perCandidate; s++)
+            {
+                Params& p = params[c * perCandidate + s];
+                p.angle = means[c].angle + sigmas[c][0] * normal(m_random);
+                p.speed = means[c].speed + sigmas[c][1] * normal(m_random);
+                p.sideSpin = means[c].sideSpin + sigmas[c][2] * normal(m_random);
+                p.topSpin = means[c].topSpin + sigmas[c][3] * normal(m_random);
+                p = Clamp(p);
+            }
+        }
+        Evaluate(params, scores);
+
+        for (int c = 0; c < candidateCount; c++)
+        {
+            const Params* samples = &params[c * perCandidate];
+            const float* sampleScores = &scores[c * perCandidate];
+            std::iota(order.begin(), order.end(), 0);
+            std::partial_sort(order.begin(), order.begin() + eliteCount, order.end(),
+                [&](int a, int b) { return sampleScores[a] > sampleScores[b]; });
+            if (sampleScores[order[0]] > bestScores[c])
+            {
+                best[c] = samples[order[0]];
+                bestScores[c] = sampleScores[order[0]];
+            }
+
+            // angles are averaged as offsets from the old mean so the wrap at pi does not split them
+            float sum[4] = {}, sumSq[4] = {};
+            for (int e = 0; e < eliteCount; e++)
+            {
+                const Params& p = samples[order[e]];
+                const float values[4] = { WrapAngle(p.angle - means[c].angle), p.speed, p.sideSpin, p.topSpin };
+                for (int d = 0; d < 4; d++)
+                {
+                    sum[d] += values[d];
+                    sumSq[d] += values[d] * values[d];
+                }
+            }
+            float mean[4];
+            for (int d = 0; d < 4; d++)
+            {
+                mean[d] = sum[d] / eliteCount;
+                sigmas[c][d] = std::max(std::sqrt(std::max(sumSq[d] / eliteCount - mean[d] * mean[d], 0.0f)), c_MIN_SIGMA[d]);
+            }
+            means[c] = Clamp({ means[c].angle + mean[0], mean[1], mean[2], mean[3] });
+        }
+    }
+
+    // Monte Carlo over execution noise, the finalist with the best expected outcome is the plan
+    const int noiseSamples = std::max(m_settings.noiseSamples, 1);
+    params.resize(static_cast<size_t>(candidateCount * noiseSamples));
+    for (int c = 0; c < candidateCount; c++)
+    {
+        for (int s = 0; s < noiseSamples; s++)
+        {
+            Params p = best[c];
+            // the first one is the shot as planned
+            if (s > 0)
+            {
+                p.angle += c_NOISE_ANGLE * normal(m_random);
+                p.speed *= 1.0f + c_NOISE_SPEED * normal(m_random);
+                p.sideSpin += c_NOISE_SPIN * normal(m_random);
+                p.topSpin += c_NOISE_SPIN * normal(m_random);
+            }
+            params[c * noiseSamples + s] = Clamp(p);
+        }
+    }
+    Evaluate(params, scores);
+
+    const std::uint16_t pocketedBefore = table.GetPocketedMask();
+    const std::uint16_t cueMask = static_cast<std::uint16_t>(1u << cueBall);
+    float bestExpected = -std::numeric_limits<float>::infinity();
+    for (int c = 0; c < candidateCount; c++)
+    {
+        float total = 0.0f;
+        int pots = 0;
+        for (int s = 0; s < noiseSamples; s++)
+        {
+            const int k = c * noiseSamples + s;
+            total += scores[k];
+            const std::uint16_t potted = m_results[k].finalState.GetPocketedMask() & ~pocketedBefore;
+            if (potted != 0 && !(potted & cueMask))
+                pots++;
+        }
+        const float expected = total / noiseSamples;
+        if (expected > bestExpected)
+        {
+            bestExpected = expected;
+            plan.shot = ToShot(best[c]);
+            plan.score = expected;
+            plan.potChance = static_cast<float>(pots) / noiseSamples;
+        }
+    }
+
+    plan.evaluated = m_evaluated;
+    plan.searchTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+    return plan;
+}
+
+void ShotPlanner::Start(const TableState& table, int cueBall)
+{
+    if (m_searching)
+        return;
+    if (m_thread.joinable())
+        m_thread.join();
+
+    m_searching = true;
+    m_thread = std::thread([this, table, cueBall]()
+    {
+        const ShotPlan plan = Plan(table, cueBall);
+        {
+            std::lock_guard<std::mutex> lock(m_resultMutex);
+            m_result = plan;
+            m_hasResult = true;
+        }
+        m_searching = false;
+    });
+}
+
+void ShotPlanner::SetRailGeometry(std::shared_ptr<const RailGeometry> rails)
+{
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    m_rails = std::move(rails);
+}
+
+bool ShotPlanner::Poll(ShotPlan& plan)
+{
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    if (!m_hasResult)
+        return false;
+    plan = m_result;
+    m_hasResult = false;
+    return true;
+}
+
+float ShotPlanner::Score(const TableState& before, const TableState& after, int cueBall)
+{
+    const std::uint16_t potted = after.GetPocketedMask() & ~before.GetPocketedMask();
+    if (potted & (1u << cueBall))
+        return c_SCRATCH_PENALTY;
+
+    int pottedCount = 0;
+    int remaining = 0;
+    for (int i = 0; i < after.ballCount; i++)
+    {
+        if (potted & (1u << i))
+            pottedCount++;
+        else if (i != cueBall && IsOnTable(after, i))
+            remaining++;
+    }
+    // a cleared table leaves nothing to position for, which is the best position there is
+    const float position = remaining == 0 ? 1.0f : PositionScore(after, cueBall);
+    return c_POT_REWARD * static_cast<float>(pottedCount) + c_POSITION_WEIGHT * position;
+}
+
+void ShotPlanner::Evaluate(const std::vector<Params>& params, std::vector<float>& scores)
+{
+    const int count = static_cast<int>(params.size());
+    m_requests.resize(params.size());
+    m_results.resize(params.size());
+    scores.resize(params.size());
+    for (int k = 0; k < count; k++)
+    {
+        m_requests[k].table = 0;
+        m_requests[k].ball = m_cueBall;
+        m_requests[k].shot = ToShot(params[k]);
+    }
+
+    m_simulator.Simulate(&m_table, m_requests.data(), count, m_results.data());
+    for (int k = 0; k < count; k++)
+        scores[k] = Score(m_table, m_results[k].finalState, m_cueBall);
+    m_evaluated += count;
+}
+
+ShotPlanner::Params ShotPlanner::Clamp(Params params) const
+{
+    params.angle = WrapAngle(params.angle);
+    params.speed = std::clamp(params.speed, c_MIN_SPEED, m_settings.maxSpeed);
+    params.sideSpin = std::clamp(params.sideSpin, -m_settings.maxSpin, m_settings.maxSpin);
+    params.topSpin = std::clamp(params.topSpin, -m_settings.maxSpin, m_settings.maxSpin);
+    return params;
+}
+
+CueShot ShotPlanner::ToShot(const Params& params)
+{
+    CueShot shot;
+    shot.angle = params.angle;
+    shot.speed = params.speed;
+    shot.sideSpin = params.sideSpin;
+    shot.topSpin = params.topSpin;
+    return shot;
+}
+
+float ShotPlanner::PositionScore(const TableState& table, int cueBall)
+{
+    // a straight, short, unobstructed pot scores close to 1
+    float best = 0.0f;
+    for (int ball = 0; ball < table.ballCount; ball++)
+    {
+        if (ball == cueBall || !IsOnTable(table, ball))
+            continue;
+        for (int pocket = 0; pocket < c_POCKET_COUNT; pocket++)
+        {
+            float ghostX, ghostY, cut;
+            if (!GhostBall(table, cueBall, ball, pocket, ghostX, ghostY, cut))
+                continue;
+
+            float pocketX, pocketY;
+            PhysicsWorld::GetPocketPosition(pocket, pocketX, pocketY);
+            const float aimDistance = std::hypot(ghostX - table.posX[cueBall], ghostY - table.posY[cueBall]);
+            const float pocketDistance = std::hypot(pocketX - table.posX[ball], pocketY - table.posY[ball]);
+            const float quality = cut / (1.0f + aimDistance + pocketDistance);
+            if (quality <= best)
+                continue;
+            if (PathBlocked(table, cueBall, ball, table.posX[cueBall], table.posY[cueBall], ghostX, ghostY)
+                || PathBlocked(table, cueBall, ball, table.posX[ball], table.posY[ball], pocketX, pocketY))
+                continue;
+            best = quality;
+        }
+    }
+    return best;
+}
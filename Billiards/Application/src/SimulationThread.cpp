@@ -0,0 +1,138 @@
+#include "SimulationThread.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr int c_MAX_CATCH_UP_TICKS = 4; // further behind than this and the schedule restarts
+    constexpr float c_CLOCK_CORRECTION = 0.1f; // share of the render clock's error removed per frame
+}
+
+SimulationThread::SimulationThread(PhysicsWorld& world, double tickRate)
+    : m_world(world), m_tickRate(tickRate > 0.0 ? tickRate : 120.0)
+{
+}
+
+SimulationThread::~SimulationThread()
+{
+    Stop();
+}
+
+void SimulationThread::Start()
+{
+    if (IsRunning())
+        return;
+
+    // the current state goes out before the thread exists, so the first frame already has a snapshot
+    m_world.SaveSnapshot(m_snapshots.GetWriteBuffer());
+    m_snapshots.Publish();
+    m_snapshots.Acquire();
+    m_latest = m_snapshots.GetReadBuffer();
+    m_previous = m_latest;
+    m_renderTime = m_latest.time;
+
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&SimulationThread::Loop, this);
+}
+
+void SimulationThread::Stop()
+{
+    if (!IsRunning())
+        return;
+
+    m_running.store(false, std::memory_order_release);
+    m_thread.join();
+    RunCommands();
+}
+
+void SimulationThread::Submit(Command command)
+{
+    std::lock_guard<std::mutex> lock(m_commandMutex);
+    m_commands.push_back(std::move(command));
+}
+
+void SimulationThread::RunCommands()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_executing.swap(m_commands);
+    }
+    for (Command& command : m_executing)
+        command(m_world);
+    m_commandCount += m_executing.size();
+    m_executing.clear();
+}
+
+void SimulationThread::Loop()
+{
+    const float tickLength = static_cast<float>(1.0 / m_tickRate);
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_tickRate));
+    Clock::time_point deadline = Clock::now();
+    std::uint64_t tick = 0;
+
+    while (m_running.load(std::memory_order_acquire))
+    {
+        RunCommands();
+
+        const Clock::time_point start = Clock::now();
+        m_world.Update(tickLength);
+        if (m_tickHook)
+            m_tickHook(m_world);
+
+        PhysicsSnapshot& snapshot = m_snapshots.GetWriteBuffer();
+        m_world.SaveSnapshot(snapshot);
+        snapshot.tick = ++tick;
+        snapshot.commandCount = m_commandCount;
+        snapshot.stepTime = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+        m_snapshots.Publish();
+
+        // a stall, e.g. a breakpoint, starts a new schedule instead of running every missed tick at once
+        deadline += period;
+        const Clock::time_point now = Clock::now();
+        if (now > deadline + c_MAX_CATCH_UP_TICKS * period)
+            deadline = now;
+        // sleep jitter is hidden by the interpolation on the render side, so no spinning here
+        std::this_thread::sleep_until(deadline);
+    }
+}
+
+void SimulationThread::Interpolate(float deltaTime, PhysicsSnapshot& out)
+{
+    if (m_snapshots.Acquire())
+    {
+        m_previous = m_latest;
+        m_latest = m_snapshots.GetReadBuffer();
+        // the world was reset, nothing to blend with
+        if (m_latest.time < m_previous.time)
+        {
+            m_previous = m_latest;
+            m_renderTime = m_latest.time;
+        }
+    }
+
+    // the render clock runs at frame speed and is pulled towards one tick behind the newest snapshot, where
+    // there is always a snapshot on either side of it
+    const float tickLength = static_cast<float>(1.0 / m_tickRate);
+    m_renderTime += deltaTime;
+    const float target = m_latest.time - tickLength;
+    if (std::abs(target - m_renderTime) > c_MAX_CATCH_UP_TICKS * tickLength)
+        m_renderTime = target;
+    else
+        m_renderTime += (target - m_renderTime) * c_CLOCK_CORRECTION;
+    m_renderTime = std::clamp(m_renderTime, m_previous.time, m_latest.time);
+
+    // between collisions the event solver's trajectories give the exact state at any time, unless a command
+    // changed the world after the previous snapshot
+    if (m_previous.analytic && m_previous.commandCount == m_latest.commandCount
+        && m_renderTime <= m_previous.trajectories.GetValidUntil())
+    {
+        out = m_latest;
+        m_previous.trajectories.Evaluate(m_renderTime, out);
+        return;
+    }
+
+    const float span = m_latest.time - m_previous.time;
+    const float alpha = span > 0.0f ? (m_renderTime - m_previous.time) / span : 1.0f;
+    PhysicsSnapshot::Interpolate(m_previous, m_latest, alpha, out);
+}
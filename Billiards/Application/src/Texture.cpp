@@ -0,0 +1,73 @@
+#include "Texture.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <cstring>
+
+Texture::Texture(int width, int height, int channels, const void* pixels)
+    : m_width(width), m_height(height)
+{
+    static const GLenum s_formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    static const GLenum s_internalFormats[4] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+    const int format = channels >= 1 && channels <= 4 ? channels - 1 : 3;
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+
+    // rows of 1 and 3 channel images are not padded to 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, s_internalFormats[format], width, height, 0, s_formats[format], GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+Texture::Texture(Texture&& texture) noexcept
+    : m_texture(texture.m_texture), m_width(texture.m_width), m_height(texture.m_height)
+{
+    texture.m_texture = 0;
+    texture.m_width = texture.m_height = 0;
+}
+
+Texture& Texture::operator=(Texture&& texture) noexcept
+{
+    if (this != &texture)
+    {
+        Cleanup();
+        m_texture = texture.m_texture;
+        m_width = texture.m_width;
+        m_height = texture.m_height;
+
+        texture.m_texture = 0;
+        texture.m_width = texture.m_height = 0;
+    }
+    return *this;
+}
+
+bool Texture::Decode(const std::string& path, TextureData& outData)
+{
+    int width = 0, height = 0, channels = 0;
+    stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+    if (!pixels)
+        return false;
+
+    outData.width = width;
+    outData.height = height;
+    outData.channels = channels;
+    outData.pixels.resize(static_cast<size_t>(width) * height * channels);
+    std::memcpy(outData.pixels.data(), pixels, outData.pixels.size());
+    stbi_image_free(pixels);
+    return true;
+}
+
+void Texture::Bind(unsigned int unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+}
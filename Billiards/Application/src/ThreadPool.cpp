@@ -0,0 +1,171 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace
+{
+    // the pool and worker index of the calling thread, when it is a worker
+    thread_local const ThreadPool* t_pool = nullptr;
+    thread_local int t_worker = -1;
+}
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    m_queues.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; i++)
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+
+    m_threads.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; i++)
+        m_threads.emplace_back(&ThreadPool::WorkerLoop, this, static_cast<int>(i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+void ThreadPool::Submit(Task task)
+{
+    // count the task as pending before any worker can see it, so Wait can never observe zero too early
+    m_pending.fetch_add(1);
+
+    const unsigned index = m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+        m_queued.fetch_add(1);
+    }
+
+    // take the wake mutex so a worker that just found nothing to do can not miss this notification
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wake.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_done.wait(lock, [this] { return m_pending.load() == 0; });
+}
+
+void ThreadPool::ParallelFor(int count, int grain, const std::function<void(int begin, int end, int worker)>& body)
+{
+    grain = std::max(1, grain);
+
+    // counts only this call's chunks, so callers on different threads do not wait for each other's work
+    std::atomic<int> remaining{ (count + grain - 1) / grain };
+    for (int begin = 0; begin < count; begin += grain)
+    {
+        const int end = std::min(count, begin + grain);
+        Submit([this, &body, &remaining, begin, end](int worker) {
+            body(begin, end, worker);
+            if (remaining.fetch_sub(1) == 1)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_wakeMutex);
+                }
+                m_done.notify_all();
+            }
+        });
+    }
+
+    const int worker = t_pool == this ? t_worker : -1;
+    if (worker < 0)
+    {
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_done.wait(lock, [&remaining] { return remaining.load() == 0; });
+        return;
+    }
+
+    // a worker blocking here could hold up its own chunks, so it runs queued tasks until they are done
+    while (remaining.load() > 0)
+    {
+        Task task;
+        if (TryPop(worker, task) || TrySteal(worker, task))
+        {
+            Run(task, worker);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_done.wait(lock, [this, &remaining] { return remaining.load() == 0 || m_queued.load() > 0; });
+    }
+}
+
+void ThreadPool::WorkerLoop(int index)
+{
+    t_pool = this;
+    t_worker = index;
+
+    for (;;)
+    {
+        Task task;
+        if (TryPop(index, task) || TrySteal(index, task))
+        {
+            Run(task, index);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wake.wait(lock, [this] { return m_stopping || m_queued.load() > 0; });
+        if (m_stopping && m_queued.load() == 0)
+            return;
+    }
+}
+
+void ThreadPool::Run(Task& task, int worker)
+{
+    task(worker);
+    if (m_pending.fetch_sub(1) == 1)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+        }
+        m_done.notify_all();
+    }
+}
+
+// newest task first from the worker's own queue, it is the most likely to still be in cache
+bool ThreadPool::TryPop(int index, Task& task)
+{
+    WorkerQueue& queue = *m_queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+        return false;
+
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    m_queued.fetch_sub(1);
+    return true;
+}
+
+// oldest task from the other queues, starting with the neighbour so thieves spread out
+bool ThreadPool::TrySteal(int thief, Task& task)
+{
+    const int count = static_cast<int>(m_queues.size());
+    for (int offset = 1; offset < count; offset++)
+    {
+        WorkerQueue& queue = *m_queues[(thief + offset) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        m_queued.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
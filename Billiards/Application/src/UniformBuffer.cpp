@@ -0,0 +1,33 @@
+#include "UniformBuffer.h"
+
+#include <glad/gl.h>
+
+#include <stdexcept>
+
+UniformBuffer::UniformBuffer(std::size_t size, unsigned int bindingPoint)
+    : m_size(size), m_bindingPoint(bindingPoint)
+{
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // the binding never changes, so it is set once here instead of every frame
+    glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, m_buffer);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    if (m_buffer != 0)
+        glDeleteBuffers(1, &m_buffer);
+}
+
+void UniformBuffer::Update(const void* data, std::size_t size) const
+{
+    if (size > m_size)
+        throw std::runtime_error("Uniform buffer update is larger than the buffer");
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(size), data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,96 @@
+#include "UniformGrid.h"
+#include "PhysicsWorld.h"
+#include "StrictFloat.h"
+
+#include <algorithm>
+#include <cmath>
+
+UniformGrid::UniformGrid(float minX, float minY, float maxX, float maxY, float cellSize)
+    : m_minX(minX), m_minY(minY), m_invCellSize(1.0f / cellSize)
+{
+    m_columns = std::max(1, static_cast<int>(std::ceil((maxX - minX) * m_invCellSize)));
+    m_rows = std::max(1, static_cast<int>(std::ceil((maxY - minY) * m_invCellSize)));
+}
+
+int UniformGrid::CellOf(float x, float y) const
+{
+    // clamp so a ball pushed slightly past the cushion still lands in an edge cell
+    const int column = std::clamp(static_cast<int>((x - m_minX) * m_invCellSize), 0, m_columns - 1);
+    const int row = std::clamp(static_cast<int>((y - m_minY) * m_invCellSize), 0, m_rows - 1);
+    return row * m_columns + column;
+}
+
+void UniformGrid::Build(const float* posX, const float* posY, const BallState* states, int count)
+{
+    m_entries.clear();
+    for (int i = 0; i < count; i++)
+    {
+        if (states[i] == BallState::Pocketed)
+            continue;
+        const auto cell = static_cast<std::uint64_t>(CellOf(posX[i], posY[i]));
+        m_entries.push_back(cell << 32 | static_cast<std::uint32_t>(i));
+    }
+    std::sort(m_entries.begin(), m_entries.end());
+}
+
+void UniformGrid::FindCandidatePairs(std::vector<int>& pairA, std::vector<int>& pairB) const
+{
+    pairA.clear();
+    pairB.clear();
+
+    const auto cellOf = [](std::uint64_t entry) { return static_cast<int>(entry >> 32); };
+    const auto ballOf = [](std::uint64_t entry) { return static_cast<int>(entry & 0xffffffffu); };
+
+    // each ball is paired with the balls after it in its own cell, the cell to its right and the three
+    // cells of the next row. The other half of the neighbourhood is covered when those cells look back.
+    const size_t count = m_entries.size();
+    for (size_t slot = 0; slot < count; slot++)
+    {
+        const int ball = ballOf(m_entries[slot]);
+        const int cell = cellOf(m_entries[slot]);
+        const int column = cell % m_columns;
+        const int row = cell / m_columns;
+
+        const int rowEnd = column + 1 < m_columns ? cell + 1 : cell;
+        for (size_t other = slot + 1; other < count && cellOf(m_entries[other]) <= rowEnd; other++)
+        {
+            pairA.push_back(ball);
+            pairB.push_back(ballOf(m_entries[other]));
+        }
+
+        if (row + 1 >= m_rows)
+            continue;
+
+        const int below = cell + m_columns;
+        const int first = column > 0 ? below - 1 : below;
+        const int last = column + 1 < m_columns ? below + 1 : below;
+        auto it = std::lower_bound(m_entries.begin() + slot + 1, m_entries.end(),
+                                   static_cast<std::uint64_t>(first) << 32);
+        for (; it != m_entries.end() && cellOf(*it) <= last; ++it)
+        {
+            pairA.push_back(ball);
+            pairB.push_back(ballOf(*it));
+        }
+    }
+}
+
+void UniformGrid::FindNear(float x, float y, std::vector<int>& out) const
+{
+    out.clear();
+
+    const int cell = CellOf(x, y);
+    const int column = cell % m_columns;
+    const int row = cell / m_columns;
+    const int firstColumn = column > 0 ? column - 1 : column;
+    const int lastColumn = column + 1 < m_columns ? column + 1 : column;
+
+    // the three cells of a row are one contiguous key range
+    for (int other = std::max(0, row - 1); other <= std::min(m_rows - 1, row + 1); other++)
+    {
+        const int first = other * m_columns + firstColumn;
+        const int last = other * m_columns + lastColumn;
+        auto it = std::lower_bound(m_entries.begin(), m_entries.end(), static_cast<std::uint64_t>(first) << 32);
+        for (; it != m_entries.end() && static_cast<int>(*it >> 32) <= last; ++it)
+            out.push_back(static_cast<int>(*it & 0xffffffffu));
+    }
+}